@@ -6,9 +6,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <time.h>
+#include <signal.h>
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -18,16 +20,46 @@
 #include "scene.h"
 #include "text.h"
 #include "animation.h"
+#include "dice_world.h"
+#include "shader_watcher.h"
+#include "resource.h"
+#include "rng.h"
+#include "session_log.h"
+#include "capture.h"
+#include "gl_state.h"
+#include "gl_counters.h"
+#include "frame_stats.h"
+#include "hud.h"
+#include "allocation.h"
+#include "frame_report.h"
 
 
 const char WINDOW_NAME[] = "D20";
+// Shaders are watched and reloaded where they are edited, not in the build directory
+#ifdef D20_SHADER_SOURCE_DIR
+const char SHADERS_DIR[] = D20_SHADER_SOURCE_DIR;
+#else
+const char SHADERS_DIR[] = "resources/shaders";
+#endif
+const char RESOURCE_PACK_PATH[] = "resources.pak";
 
 
 // Control flags
 bool g_switch_wire_mode = false;
+bool g_switch_gpu_animation = false;
+bool g_switch_hud = false;
 bool g_start_roll = false;
 bool g_is_rolling = false;
 
+// Session recording and replay
+SessionLog g_record_log = { 0 };  // written while file is open
+bool g_is_replaying = false;  // input comes from replayed log, keyboard only closes the window
+double g_session_start_time = 0.0;
+
+// Set by signal handlers, checked once per frame
+volatile sig_atomic_t g_is_report_requested = 0;
+volatile sig_atomic_t g_is_quit_requested = 0;
+
 
 typedef struct {
     int width;
@@ -36,8 +68,55 @@ typedef struct {
 } WindowSettings;
 
 
+// Window size in screen coordinates and framebuffer size in pixels, differ on HiDPI displays
+typedef struct {
+    int window_width;
+    int window_height;
+    int framebuffer_width;
+    int framebuffer_height;
+} WindowSize;
+
+// Kept up to date by resize callbacks, so the render loop does not query the window system
+WindowSize g_window_size = { 0 };
+
+
+typedef struct {
+    size_t capacity;  // max number of dice on the table
+    size_t n_dice;  // dice created at startup, placed on a square grid
+    float spacing;  // distance between neighbouring dice
+    DiceType dice_type;  // type of created dice, DICE_N_TYPES cycles through all types
+} WorldSettings;
+
+
+typedef struct {
+    const char* record_path;
+    const char* replay_path;
+    bool is_headless;  // replay without window as fast as possible
+    const char* capture_path;
+    CaptureFormat capture_format;
+    unsigned capture_fps;
+    uint64_t max_frames;  // 0 for no limit
+    const char* stats_path;
+    const char* report_path;
+    QuatInterpolation interpolation;  // of roll animation, replays use the recorded one
+} CommandLine;
+
+
+// Optional parts of a session, set up from command line
+typedef struct {
+    SessionLog* replay_log;  // frames and keys come from the log when set
+    FrameCapture* capture;  // frames are captured when set
+    float capture_delta;  // fixed frame delta of captured sessions, replays keep recorded deltas
+    uint64_t max_frames;  // 0 for no limit
+    FrameStatsSink* stats;  // per-frame statistics are written when set
+    FrameReport* report;  // frame and stage times are recorded when set
+    const char* report_path;
+} SessionOptions;
+
+
 typedef struct {
     WindowSettings window;
+    WorldSettings world;
     SceneSettings scene;
     AnimationSettings anim;
     TextSettings text;
@@ -51,6 +130,13 @@ Settings getSettings(void) {
         .name = WINDOW_NAME
     };
 
+    WorldSettings world_settings = {
+        .capacity = 1024,
+        .n_dice = 1,
+        .spacing = 2.0f,
+        .dice_type = DICE_D20,
+    };
+
     SceneSettings scene_settings = {
         .scale = 0.7f,
         .fov_deg = 45.0f,
@@ -61,6 +147,8 @@ Settings getSettings(void) {
         .specular_brightness = 0.5f,
         .ambient_brightness = 0.2f,
         .camera_position = { 0.0f, 0.0f, -5.0f },
+        .impostor_size_px = 12.0f,
+        .gpu_animation = true,
     };
 
     AnimationSettings roll_anim_settings = {
@@ -75,11 +163,12 @@ Settings getSettings(void) {
 
     TextSettings text_settings = {
         .text_color = { 0.5f, 0.1f, 0.8f },
-        .text_size = 0.5f,
+        .text_size = 24.0f,
     };
 
     return (Settings) {
         .window = window_settings,
+        .world = world_settings,
         .scene = scene_settings,
         .anim = roll_anim_settings,
         .text = text_settings,
@@ -93,18 +182,55 @@ void errorCallback(int error, const char* descr) {
 }
 
 
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GLFW_TRUE);
-    } else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+// Control keys, pressed live or read from replayed session log
+static void applyKey(int key, int action) {
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
         g_switch_wire_mode = true;
+    } else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        g_switch_gpu_animation = true;
     } else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS && !g_is_rolling) {
         g_start_roll = true;
     }
 }
 
 
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (g_record_log.file && action != GLFW_REPEAT) {
+        writeSessionKey(&g_record_log, key, action, glfwGetTime() - g_session_start_time);
+    }
+
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    } else if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        g_switch_hud = true;  // view only, so it works during replay too
+    } else if (!g_is_replaying) {
+        applyKey(key, action);
+    }
+}
+
+
+// Report is written from render loop, handlers only set flags
+#ifdef SIGUSR1
+static void reportSignalHandler(int signal_number) {
+    g_is_report_requested = 1;
+}
+#endif
+
+
+static void quitSignalHandler(int signal_number) {
+    g_is_quit_requested = 1;
+}
+
+
+static void windowSizeCallback(GLFWwindow* window, int width, int height) {
+    g_window_size.window_width = width;
+    g_window_size.window_height = height;
+}
+
+
 static void resizeCallback(GLFWwindow* window, int width, int height) {
+    g_window_size.framebuffer_width = width;
+    g_window_size.framebuffer_height = height;
     glViewport(0, 0, width, height);
 }
 
@@ -128,11 +254,14 @@ void setUpOpenGL(GLFWwindow* window) {
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(messageCallback, 0);
 
+    // Compile shaders off the render thread when driver supports it
+    initParallelShaderCompile();
+
     // Graphics settings
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    setGlCapability(GL_DEPTH_TEST, true);
+    setGlCapability(GL_CULL_FACE, true);
+    setGlCapability(GL_BLEND, true);
+    setGlBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 
@@ -154,7 +283,10 @@ Status initGLFW(const WindowSettings* settings, GLFWwindow** out_window) {
         return STATUS_ERR;
     }
     glfwSetKeyCallback(window, keyCallback);
+    glfwSetWindowSizeCallback(window, windowSizeCallback);
     glfwSetFramebufferSizeCallback(window, resizeCallback);
+    glfwGetWindowSize(window, &g_window_size.window_width, &g_window_size.window_height);
+    glfwGetFramebufferSize(window, &g_window_size.framebuffer_width, &g_window_size.framebuffer_height);
     glfwMakeContextCurrent(window);
 
     glfwSwapInterval(0);
@@ -171,39 +303,123 @@ void freeGLFW(GLFWwindow* window) {
 }
 
 
-/* Rendering */
+/* Simulation */
+
+// Start requested roll and advance dice by one frame. Shared by live, replayed and headless sessions,
+// so it must depend only on control flags, RNG and frame delta
+static void stepDice(DiceWorld* world, const AnimationSettings* anim_settings, Rng* rng, float delta) {
+    // Whether to start a new roll
+    if (g_start_roll) {
+        g_start_roll = false;
+        g_is_rolling = true;
 
-void showFpsInWindowTitle(GLFWwindow* window) {
-    static double last_time = 0.0;
-    static size_t n_frames = 0;
+        for (size_t i = 0; i < world->n_dice; ++i) {
+            int dice_value = nextRngBounded(rng, getDiceFaceCount(world->type[i])) + 1;
+            rollDice(world, i, dice_value, anim_settings);
+        }
+    }
 
-    double current_time = glfwGetTime();
-    double delta = current_time - last_time;
-    ++n_frames;
-    if (delta > 0.5) {
-        double fps = n_frames / delta;
-        char buf[200];
-        sprintf(buf, "%s | %.2f FPS", WINDOW_NAME, fps);
-        glfwSetWindowTitle(window, buf);
+    // Animation
+    // advance every die to current frame, orientations are evaluated only where they are needed
+    size_t n_rolling = updateDiceWorld(world, delta, anim_settings);
 
-        n_frames = 0;
-        last_time = current_time;
+    // After a roll, enable rolling
+    if (g_is_rolling && n_rolling == 0) {
+        g_is_rolling = false;
     }
 }
 
 
-// Main render loop
-void renderLoop(GLFWwindow* window, Settings settings, SceneRenderer* scene_renderer_ptr,
-                TextRenderer* text_renderer_ptr) {
+// Apply logged key events up to the next frame. Returns false at the end of log
+static bool readReplayFrame(SessionLog* log, SessionRecord* frame) {
+    SessionRecord record;
+    while (readSessionRecord(log, &record)) {
+        if (record.type == SESSION_RECORD_FRAME) {
+            *frame = record;
+            return true;
+        }
+        applyKey(record.key, record.action);
+    }
+    return false;
+}
+
+
+// Checksum of orientations of all dice, which are otherwise evaluated only for dice animated on CPU
+static uint32_t getSessionChecksum(DiceWorld* world, const AnimationSettings* anim_settings) {
+    updateDiceOrientations(world, anim_settings, NULL, world->n_dice);
+    return getDiceWorldChecksum(world);
+}
+
+
+// Compare orientations after replayed frame with the recorded ones
+static void checkReplayFrame(const SessionLog* log, const SessionRecord* frame, DiceWorld* world,
+                             const AnimationSettings* anim_settings, uint64_t* n_mismatches) {
+    if (getSessionChecksum(world, anim_settings) != frame->checksum && (*n_mismatches)++ == 0) {
+        printf("Replay diverged from recorded session at frame %llu\n", (unsigned long long)log->n_frames);
+    }
+}
+
+
+static void reportReplay(const SessionLog* log, double session_time, double wall_time, uint64_t n_mismatches) {
+    printf("Replayed %llu frames (%.2f s of session) in %.2f s: %s\n", (unsigned long long)log->n_frames,
+           session_time, wall_time, n_mismatches == 0 ? "all frames match" : "FAILED");
+    if (n_mismatches > 0) {
+        printf("%llu frames differ from recorded session\n", (unsigned long long)n_mismatches);
+    }
+}
+
+
+/* Rendering */
+
+// Driver calls saved by GL state cache over the session
+static void reportGlStateCounters(void) {
+    const GlStateCounters* counters = getGlStateCounters();
+    uint64_t n_requested = 0, n_skipped = 0;
+    for (int kind = 0; kind < STATE_N_KINDS; ++kind) {
+        n_requested += counters->n_requested[kind];
+        n_skipped += counters->n_skipped[kind];
+    }
+    printf("GL state changes: %llu requested, %llu skipped as redundant\n", (unsigned long long)n_requested,
+           (unsigned long long)n_skipped);
+    for (int kind = 0; kind < STATE_N_KINDS; ++kind) {
+        if (counters->n_requested[kind] > 0) {
+            printf("  %-13s %llu of %llu skipped\n", getGlStateKindName(kind),
+                   (unsigned long long)counters->n_skipped[kind], (unsigned long long)counters->n_requested[kind]);
+        }
+    }
+}
+
+
+static const char* HELP_LINES[] = {
+    "Press Esc to exit", "Press L for wire mode", "Press G for GPU animation", "Press H for HUD", "Press Space to roll"
+};
+
+
+// Main render loop. With replay log, frames and keys come from the log at recorded pace
+void renderLoop(GLFWwindow* window, Settings settings, DiceWorld* world_ptr, SceneRenderer* scene_renderer_ptr,
+                TextRenderer* text_renderer_ptr, Hud* hud_ptr, ShaderWatcher* shader_watcher_ptr, Rng* rng_ptr,
+                const SessionOptions* session) {
+    SessionLog* replay_log = session->replay_log;
+    FrameCapture* capture = session->capture;
     double prev_time = glfwGetTime();
+    g_session_start_time = prev_time;
+    double replay_time = 0.0;  // session time reached by replayed frames
+    uint64_t n_mismatches = 0;
+    uint64_t n_frames = 0;
 
     bool is_in_wire_mode = false;
-    bool is_in_idle_animation = true;
-
-    versor rot_quat;  // dice rotation quaternion for each frame
-    RollAnimationState roll_anim_state = initRollAnimationState(settings.anim.n_points);
+    bool is_hud_visible = false;
+    takeGlCallCounters();  // start counting with the first frame
+    uint64_t n_allocations = getAllocationCount();
+
+    while (!glfwWindowShouldClose(window) && !g_is_quit_requested
+           && (session->max_frames == 0 || n_frames < session->max_frames)) {
+        ++n_frames;
+        beginHudFrame(hud_ptr, glfwGetTime());
+        if (capture) {
+            beginFrameCapture(capture);
+        }
 
-    while (!glfwWindowShouldClose(window)) {
         // Clear buffers
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -211,94 +427,421 @@ void renderLoop(GLFWwindow* window, Settings settings, SceneRenderer* scene_rend
             g_switch_wire_mode = false;
             is_in_wire_mode = !is_in_wire_mode;
         }
+        if (g_switch_gpu_animation) {
+            g_switch_gpu_animation = false;
+            settings.scene.gpu_animation = !settings.scene.gpu_animation;
+        }
+        if (g_switch_hud) {
+            g_switch_hud = false;
+            is_hud_visible = !is_hud_visible;
+            installGlCallCounters();  // HUD shows GL calls per frame
+        }
 
-        showFpsInWindowTitle(window);
+        // Recompile shaders edited on disk, old programs are used until new ones are ready
+        const char* changed_file;
+        while ((changed_file = pollShaderWatcher(shader_watcher_ptr)) != NULL) {
+            requestSceneShaderReload(scene_renderer_ptr, changed_file);
+            requestTextShaderReload(text_renderer_ptr, changed_file);
+            requestHudShaderReload(hud_ptr, changed_file);
+        }
+        updateSceneShaderReload(scene_renderer_ptr);
+        updateTextShaderReload(text_renderer_ptr);
+        updateHudShaderReload(hud_ptr);
 
         // Advance time counter
         double cur_time = glfwGetTime();
-        double delta = cur_time - prev_time;
+        double frame_time = cur_time - prev_time;
+        float delta = (float)frame_time;
         prev_time = cur_time;
+        if (capture) {
+            // Captured clips play at capture frame rate however long frames take to render
+            delta = session->capture_delta;
+        }
+
+        SessionRecord frame;
+        if (replay_log) {
+            if (!readReplayFrame(replay_log, &frame)) {
+                break;
+            }
+            // Wait until recorded frame is due, window stays responsive
+            delta = frame.time_delta;
+            replay_time += delta;
+            double wait_time;
+            while ((wait_time = replay_time - (glfwGetTime() - g_session_start_time)) > 0.0
+                   && !glfwWindowShouldClose(window)) {
+                glfwWaitEventsTimeout(wait_time);
+            }
+        }
 
-        // Whether to start a new roll
-        if (g_start_roll) {
-            is_in_idle_animation = false;
-            g_start_roll = false;
-            g_is_rolling = true;
+        double update_start_time = glfwGetTime();
+        stepDice(world_ptr, &settings.anim, rng_ptr, delta);
 
-            size_t dice_value = (size_t)(rand() % 20 + 1);
-            // printf("Rolled number: %zu\n", dice_value);
-            fillRollAnimationQueue(&roll_anim_state, rot_quat, &settings.anim, dice_value);
+        if (replay_log) {
+            checkReplayFrame(replay_log, &frame, world_ptr, &settings.anim, &n_mismatches);
+        } else if (g_record_log.file) {
+            writeSessionFrame(&g_record_log, delta, getSessionChecksum(world_ptr, &settings.anim));
         }
 
-        // Animation
-        // get rotation quaternion for current frame
-        if (is_in_idle_animation) {
-            // Idle animation
-            getIdleAnimationQuaternion(delta, settings.anim.idle_rot_speed, rot_quat);
-        } else {
-            getRollAnimationQuaternion(delta, &settings.anim, &roll_anim_state, rot_quat);
+        // Rendering. Scene is drawn in framebuffer pixels, text and overlay are laid out in window coordinates
+        double render_start_time = glfwGetTime();
+        int fb_width = g_window_size.framebuffer_width, fb_height = g_window_size.framebuffer_height;
+        int win_width = g_window_size.window_width, win_height = g_window_size.window_height;
+        if (capture) {
+            fb_width = win_width = capture->width;
+            fb_height = win_height = capture->height;
+        }
 
-            // After a roll, enable rolling
-            if (g_is_rolling && roll_anim_state.hasFinished) {
-                g_is_rolling = false;
-            }
+        renderScene(scene_renderer_ptr, &settings.scene, &settings.anim, world_ptr, fb_width, fb_height,
+                    is_in_wire_mode);
+        size_t n_text_characters = 0;
+        for (size_t i = 0; i < sizeof(HELP_LINES) / sizeof(HELP_LINES[0]); ++i) {
+            renderText(text_renderer_ptr, HELP_LINES[i], &settings.text, 10.0f, 10.0f + 27.0f * i, win_width,
+                       win_height);
+            n_text_characters += strlen(HELP_LINES[i]);
         }
 
-        // Rendering
-        int win_width, win_height;
-        glfwGetWindowSize(window, &win_width, &win_height);
-        float aspect_ratio = (float)win_width / (float)win_height;
+        endHudFrame(hud_ptr, glfwGetTime(), frame_time);
+        if (is_hud_visible) {
+            renderHud(hud_ptr, win_width, win_height);
+        }
 
-        renderScene(scene_renderer_ptr, &settings.scene, rot_quat, aspect_ratio, is_in_wire_mode);
-        renderText(text_renderer_ptr, "Press Esc to exit", &settings.text,
-                   10.0f, 10.0f, win_width, win_height);
-        renderText(text_renderer_ptr, "Press L for wire mode", &settings.text, 
-                   10.0f, 37.0f, win_width, win_height);
-        renderText(text_renderer_ptr, "Press Space to roll", &settings.text, 
-                   10.0f, 64.0f, win_width, win_height);
+        if (capture) {
+            endFrameCapture(capture, g_window_size.framebuffer_width, g_window_size.framebuffer_height);
+        }
+
+        // Counters of whole frame, the overlay shows them next frame
+        GlCallCounters gl_calls = takeGlCallCounters();
+        uint64_t prev_n_allocations = n_allocations;
+        n_allocations = getAllocationCount();
+        setHudFrameCounters(hud_ptr, &gl_calls, n_allocations - prev_n_allocations);
+        if (session->stats) {
+            FrameStats stats = {
+                .frame_time = frame_time,
+                .n_dice = world_ptr->n_dice,
+                .n_text_characters = n_text_characters,
+                .gl_calls = gl_calls,
+                .n_allocations = n_allocations - prev_n_allocations,
+            };
+            writeFrameStats(session->stats, &stats);
+        }
 
         // Swap front buffer (display) with back buffer (where we render to)
+        double present_start_time = glfwGetTime();
         glfwSwapBuffers(window);
 
         // Communicate with the window system to received events and show that applications hasn't locked up 
         glfwPollEvents();
+
+        if (session->report) {
+            recordFrameStage(session->report, FRAME_STAGE_FRAME, frame_time);
+            recordFrameStage(session->report, FRAME_STAGE_UPDATE, render_start_time - update_start_time);
+            recordFrameStage(session->report, FRAME_STAGE_RENDER, present_start_time - render_start_time);
+            recordFrameStage(session->report, FRAME_STAGE_PRESENT, glfwGetTime() - present_start_time);
+            if (g_is_report_requested) {
+                g_is_report_requested = 0;
+                writeFrameReport(session->report, session->report_path);
+            }
+        }
+    }
+
+    if (replay_log) {
+        reportReplay(replay_log, replay_time, glfwGetTime() - g_session_start_time, n_mismatches);
+    }
+}
+
+
+// Place dice on a square grid centered at the origin
+static Status populateDiceWorld(DiceWorld* world, const WorldSettings* world_settings,
+                                const SceneSettings* scene_settings) {
+    size_t n_columns = (size_t)ceil(sqrt((double)world_settings->n_dice));
+    float offset = 0.5f * (n_columns - 1) * world_settings->spacing;
+
+    for (size_t i = 0; i < world_settings->n_dice; ++i) {
+        vec3 position = {
+            (i % n_columns) * world_settings->spacing - offset,
+            (i / n_columns) * world_settings->spacing - offset,
+            0.0f
+        };
+        DiceType type = world_settings->dice_type;
+        if (type == DICE_N_TYPES) {
+            type = i % DICE_N_TYPES;
+        }
+        DiceHandle handle;
+        if (createDice(world, type, position, scene_settings->scale, 0, &handle) != STATUS_OK) {
+            return STATUS_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+
+static double getWallTime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Re-run session log without window and rendering, as fast as possible.
+// Fails if any frame differs from the recorded one
+static Status replayHeadless(const Settings* settings, SessionLog* replay_log, Rng* rng) {
+    initDiceMeshes();
+
+    DiceWorld world;
+    if (initDiceWorld(&world, settings->world.capacity, &settings->anim) != STATUS_OK) {
+        return STATUS_ERR;
+    }
+    if (populateDiceWorld(&world, &settings->world, &settings->scene) != STATUS_OK) {
+        freeDiceWorld(&world);
+        return STATUS_ERR;
+    }
+
+    double start_time = getWallTime();
+    double session_time = 0.0;
+    uint64_t n_mismatches = 0;
+    SessionRecord frame;
+    while (readReplayFrame(replay_log, &frame)) {
+        stepDice(&world, &settings->anim, rng, frame.time_delta);
+        session_time += frame.time_delta;
+        checkReplayFrame(replay_log, &frame, &world, &settings->anim, &n_mismatches);
     }
+    reportReplay(replay_log, session_time, getWallTime() - start_time, n_mismatches);
+
+    freeDiceWorld(&world);
+    return n_mismatches == 0 ? STATUS_OK : STATUS_ERR;
+}
 
-    // Cleanup
-    deleteRollAnimationState(&roll_anim_state);
+
+static Status parseCommandLine(int argc, char** argv, CommandLine* args) {
+    *args = (CommandLine) { .capture_fps = 60 };
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--record") == 0 && arg + 1 < argc) {
+            args->record_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--replay") == 0 && arg + 1 < argc) {
+            args->replay_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--headless") == 0) {
+            args->is_headless = true;
+        } else if (strcmp(argv[arg], "--capture") == 0 && arg + 1 < argc) {
+            args->capture_path = argv[++arg];
+            args->capture_format = CAPTURE_PNG_SEQUENCE;
+        } else if (strcmp(argv[arg], "--capture-raw") == 0 && arg + 1 < argc) {
+            args->capture_path = argv[++arg];
+            args->capture_format = CAPTURE_RAW_VIDEO;
+        } else if (strcmp(argv[arg], "--capture-y4m") == 0 && arg + 1 < argc) {
+            args->capture_path = argv[++arg];
+            args->capture_format = CAPTURE_Y4M_VIDEO;
+        } else if (strcmp(argv[arg], "--capture-fps") == 0 && arg + 1 < argc) {
+            args->capture_fps = (unsigned)strtoul(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--stats") == 0 && arg + 1 < argc) {
+            args->stats_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--report") == 0 && arg + 1 < argc) {
+            args->report_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--frames") == 0 && arg + 1 < argc) {
+            args->max_frames = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--interpolation") == 0 && arg + 1 < argc) {
+            const char* name = argv[++arg];
+            args->interpolation = QUAT_N_INTERPOLATIONS;
+            for (int method = 0; method < QUAT_N_INTERPOLATIONS; ++method) {
+                if (strcmp(name, getQuatInterpolationName((QuatInterpolation)method)) == 0) {
+                    args->interpolation = (QuatInterpolation)method;
+                }
+            }
+            if (args->interpolation == QUAT_N_INTERPOLATIONS) {
+                return STATUS_ERR;
+            }
+        } else {
+            return STATUS_ERR;
+        }
+    }
+    if ((args->record_path && args->replay_path) || (args->is_headless && !args->replay_path)
+        || (args->is_headless && args->capture_path) || args->capture_fps == 0) {
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
 }
 
 
-int main(void) {
+int main(int argc, char** argv) {
     Settings settings = getSettings();
 
-    srand(time(NULL));  // for dice rolls
+    CommandLine args;
+    if (parseCommandLine(argc, argv, &args) != STATUS_OK) {
+        puts("Usage: d20 [--record FILE] [--replay FILE [--headless]]\n"
+             "           [--capture DIR | --capture-raw FILE | --capture-y4m FILE] [--capture-fps N] [--frames N]\n"
+             "           [--stats FILE] [--report FILE] [--interpolation slerp|nlerp|fast-slerp]\n"
+             "Video captures are written to stdout when FILE is " CAPTURE_STDOUT_PATH);
+        return 1;
+    }
+    if (args.capture_path && args.capture_format != CAPTURE_PNG_SEQUENCE
+        && strcmp(args.capture_path, CAPTURE_STDOUT_PATH) == 0) {
+        reserveStdoutForCapture();
+    }
+
+    // Replayed session brings its own seed and dice
+    uint64_t seed = (uint64_t)time(NULL);
+    SessionLog replay_log = { 0 };
+    if (args.replay_path) {
+        SessionLogHeader header;
+        if (openSessionLogForReading(&replay_log, args.replay_path, &header) != STATUS_OK) {
+            return 1;
+        }
+        if (header.dice_type > DICE_N_TYPES || header.n_dice > settings.world.capacity
+            || header.interpolation >= QUAT_N_INTERPOLATIONS) {
+            puts("Session log does not fit world settings");
+            closeSessionLog(&replay_log);
+            return 1;
+        }
+        seed = header.seed;
+        settings.world.n_dice = header.n_dice;
+        settings.world.dice_type = header.dice_type;
+        args.interpolation = (QuatInterpolation)header.interpolation;
+        g_is_replaying = true;
+    }
+    settings.anim.interpolation = args.interpolation;
+
+    Rng rng;  // for dice rolls
+    initRng(&rng, seed, 0);
+
+    if (args.is_headless) {
+        Status status = replayHeadless(&settings, &replay_log, &rng);
+        closeSessionLog(&replay_log);
+        return status == STATUS_OK ? 0 : 1;
+    }
+
+    // Embedded resources take priority, then the pack file, then loose files
+    bool is_embedded = openEmbeddedResourcePack() == STATUS_OK;
+    if (!is_embedded && openResourcePack(RESOURCE_PACK_PATH) != STATUS_OK) {
+        puts("Resource pack is not available, using resource files");
+    }
 
     GLFWwindow* window;
     if (initGLFW(&settings.window, &window) != STATUS_OK) {
+        closeResourcePack();
+        closeSessionLog(&replay_log);
         return 1;
     }
 
     setUpOpenGL(window);
+    if (args.stats_path) {
+        installGlCallCounters();
+    }
+
+    DiceWorld world;
+    if (initDiceWorld(&world, settings.world.capacity, &settings.anim) != STATUS_OK) {
+        freeGLFW(window);
+        closeResourcePack();
+        closeSessionLog(&replay_log);
+        return 1;
+    }
+    if (populateDiceWorld(&world, &settings.world, &settings.scene) != STATUS_OK) {
+        freeDiceWorld(&world);
+        freeGLFW(window);
+        closeResourcePack();
+        closeSessionLog(&replay_log);
+        return 1;
+    }
 
     SceneRenderer scene_renderer;
-    if (initSceneRenderer(&scene_renderer) != STATUS_OK) {
+    if (initSceneRenderer(&scene_renderer, &world) != STATUS_OK) {
+        freeDiceWorld(&world);
         freeGLFW(window);
+        closeResourcePack();
+        closeSessionLog(&replay_log);
         return 1;
     }
 
     TextRenderer text_renderer;
     if (initTextRenderer(&text_renderer) != STATUS_OK) {
         freeSceneRenderer(&scene_renderer);
+        freeDiceWorld(&world);
+        freeGLFW(window);
+        closeResourcePack();
+        closeSessionLog(&replay_log);
+        return 1;
+    }
+
+    Hud hud;
+    if (initHud(&hud, &text_renderer) != STATUS_OK) {
+        freeTextRenderer(&text_renderer);
+        freeSceneRenderer(&scene_renderer);
+        freeDiceWorld(&world);
         freeGLFW(window);
+        closeResourcePack();
+        closeSessionLog(&replay_log);
         return 1;
     }
 
-    renderLoop(window, settings, &scene_renderer, &text_renderer);
+    // Hot-reload is optional, watcher reports no changes if it failed to start.
+    // Embedded builds do not touch the resources directory at all
+    ShaderWatcher shader_watcher = { .fd = -1 };
+    if (!is_embedded) {
+        setShaderSourceDir(SHADERS_DIR);
+        initShaderWatcher(&shader_watcher, SHADERS_DIR);
+    }
+
+    SessionOptions session = {
+        .replay_log = args.replay_path ? &replay_log : NULL,
+        .capture_delta = 1.0f / args.capture_fps,
+        .max_frames = args.max_frames,
+    };
+    Status status = STATUS_OK;
+    FrameStatsSink stats;
+    if (args.stats_path) {
+        status = openFrameStatsSink(&stats, args.stats_path);
+        session.stats = status == STATUS_OK ? &stats : NULL;
+    }
+    if (status == STATUS_OK && args.record_path) {
+        status = openSessionLogForWriting(&g_record_log, args.record_path, seed, (uint32_t)settings.world.n_dice,
+                                          (uint32_t)settings.world.dice_type,
+                                          (uint32_t)settings.anim.interpolation);
+    }
+
+    // Report is written on exit and on SIGUSR1, SIGINT and SIGTERM end the session normally so it is written
+    FrameReport report;
+    if (args.report_path) {
+        initFrameReport(&report);
+        session.report = &report;
+        session.report_path = args.report_path;
+        signal(SIGINT, quitSignalHandler);
+        signal(SIGTERM, quitSignalHandler);
+#ifdef SIGUSR1
+        signal(SIGUSR1, reportSignalHandler);
+#endif
+    }
+
+    // Frames are captured at the initial window size
+    FrameCapture capture;
+    if (status == STATUS_OK && args.capture_path) {
+        status = initFrameCapture(&capture, args.capture_path, args.capture_format,
+                                  g_window_size.framebuffer_width, g_window_size.framebuffer_height, args.capture_fps);
+        session.capture = status == STATUS_OK ? &capture : NULL;
+    }
+
+    if (status == STATUS_OK) {
+        renderLoop(window, settings, &world, &scene_renderer, &text_renderer, &hud, &shader_watcher, &rng,
+                   &session);
+        reportGlStateCounters();
+        if (session.report && writeFrameReport(&report, args.report_path) == STATUS_OK) {
+            printf("Frame report written to %s\n", args.report_path);
+        }
+    }
+
+    if (session.capture) {
+        freeFrameCapture(&capture);
+    }
+    if (session.stats) {
+        closeFrameStatsSink(&stats);
+    }
+    closeSessionLog(&g_record_log);
+    closeSessionLog(&replay_log);
 
+    freeShaderWatcher(&shader_watcher);
+    freeHud(&hud);
     freeTextRenderer(&text_renderer);
     freeSceneRenderer(&scene_renderer);
+    freeDiceWorld(&world);
     freeGLFW(window);
+    closeResourcePack();
 
-    return 0;
+    return status == STATUS_OK ? 0 : 1;
 }
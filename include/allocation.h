@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Heap allocation with counting, so frames that allocate show up in the performance HUD.
+// Modules allocate through these instead of malloc, calloc and realloc, memory is released with free
+void* allocateMemory(size_t size);
+void* allocateZeroedMemory(size_t count, size_t size);
+void* reallocateMemory(void* memory, size_t size);
+
+// Allocations made by all threads since start
+uint64_t getAllocationCount(void);
@@ -1,6 +1,9 @@
 #pragma once
 #include <cglm/cglm.h>
 
+#include "polyhedron.h"
+#include "quat_batch.h"
+
 
 typedef struct {
     float idle_rot_speed;  // deg/sec
@@ -13,30 +16,57 @@ typedef struct {
     float max_rot_speed;  // deg/sec
     float min_rot_speed;  // deg/sec
     float deaceleration;  // deg/sec
+    QuatInterpolation interpolation;  // between roll keyframes and along the path filling the queue
 } AnimationSettings;
 
 
 typedef struct {
-    size_t cur_n;
-    versor* q_arr;
-    double t;
-    versor q_prev;
-    float cur_speed_rad_per_sec;
+    versor* q_arr;  // keyframes, the last one shows the rolled value
+    double t;  // seconds since roll start
+    versor q_start;  // orientation at roll start
     bool hasFinished;
 } RollAnimationState;
 
+
+// Roll speed in keyframes per second: constant maximum speed for the first half of keyframes,
+// then linear deceleration down to minimum speed
+typedef struct {
+    float max_speed;
+    float min_speed;
+    float deceleration;  // keyframes/sec^2
+    float deceleration_start;  // keyframe position
+} RollSpeedProfile;
+
 // Initialize animation state.
 //     roll_points_num - number of steps approximating animation
 RollAnimationState initRollAnimationState(size_t roll_points_num);
 void deleteRollAnimationState(RollAnimationState* state);
+// Rewind animation state, keeping its queue
+void resetRollAnimationState(RollAnimationState* state);
+
+// Single-axis rotations making up idle rotation, which is their product q[0] * q[1] * q[2]
+void getIdleRotationFactors(float rot_angle_deg, versor q_out[3]);
 
-// Get current rotation quaternion for idle animation
-void getIdleAnimationQuaternion(float time_delta, float rot_speed_deg, versor q_out);
+// Orientation showing dice_value on top (face towards +Z) with the number upright (towards +Y)
+void getDiceRollQuaternion(DiceType type, int dice_value, versor q_out);
 
 // Fill roll animation queue in current animation state using target dice value
 void fillRollAnimationQueue(RollAnimationState* state, versor initial_rot_quat,
-                            const AnimationSettings* settings, size_t dice_value);
+                            const AnimationSettings* settings, DiceType type, size_t dice_value);
+
+RollSpeedProfile getRollSpeedProfile(const AnimationSettings* settings);
+// Keyframe position reached time_elapsed seconds after roll start. Closed form, so that
+// any moment of a roll can be evaluated independently (also done in roll compute shader)
+float getRollAnimationPosition(const RollSpeedProfile* profile, float time_elapsed);
 
-// Get current rotation quaternion for idle animation
+// Keyframes around position reached at current roll time and weight of the second one.
+// Returns false once the roll has reached its last keyframe
+bool getRollAnimationKeyframes(const AnimationSettings* settings, RollAnimationState* state,
+                               float** q_from, float** q_to, float* weight);
+// Advance roll animation by time_delta. While rolling, returns true with keyframes around current
+// position and weight of the second one, so that many dice can be interpolated in one batch
+bool advanceRollAnimation(float time_delta, const AnimationSettings* settings, RollAnimationState* state,
+                          float** q_from, float** q_to, float* weight);
+// Advance roll animation by time_delta and get its current rotation quaternion
 void getRollAnimationQuaternion(float time_delta, const AnimationSettings* settings,
                                 RollAnimationState* state, versor q_out);
\ No newline at end of file
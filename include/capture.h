@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <glad/gl.h>
+
+#include "status.h"
+#include "thread.h"
+
+
+/*
+* Frame capture without pipeline stalls. Frames are rendered into an offscreen framebuffer and read back
+* asynchronously into a ring of pixel buffer objects. Each buffer is mapped a frame or two later, once
+* its fence has signaled. Mapped pixels are copied into a queue drained by a writer thread, which writes
+* a PNG sequence or a single video file. Video files can go to stdout to feed an encoder through a pipe.
+*/
+
+enum {
+    CAPTURE_RING_SIZE = 3,  // readbacks in flight on GPU
+    CAPTURE_QUEUE_SIZE = 8  // frames waiting for writer thread
+};
+
+
+typedef enum {
+    CAPTURE_PNG_SEQUENCE,  // frame_000000.png, ... in a directory
+    CAPTURE_RAW_VIDEO,  // rgb24 frames one after another, top row first
+    CAPTURE_Y4M_VIDEO  // YUV4MPEG2 stream of 4:2:0 frames
+} CaptureFormat;
+
+
+// Path that sends video to stdout
+#define CAPTURE_STDOUT_PATH "-"
+
+
+typedef struct {
+    const char* path;  // directory of PNG sequence or video file
+    CaptureFormat format;
+    int width;
+    int height;
+    unsigned fps;  // frame rate written to Y4M header
+    size_t frame_size;  // bytes of RGBA frame
+
+    // Offscreen render target
+    GLuint framebuffer;
+    GLuint color_buffer;
+    GLuint depth_buffer;
+
+    // Readback ring, frames in flight are ring_first, ring_first + 1, ...
+    GLuint pixel_buffers[CAPTURE_RING_SIZE];
+    GLsync fences[CAPTURE_RING_SIZE];
+    size_t ring_first;
+    size_t n_in_flight;
+
+    // Writer queue, guarded by mutex. Frames are RGBA with rows bottom to top as read from OpenGL
+    unsigned char* queue_pixels;
+    size_t queue_first;
+    size_t n_queued;
+    bool is_finishing;
+    Mutex mutex;
+    ConditionVariable condition;
+
+    // Owned by writer thread
+    Thread writer;
+    unsigned char* output_pixels;  // frame converted to RGB or YUV planes, rows top to bottom
+    FILE* video_file;
+    uint64_t n_written;
+    bool has_write_error;
+
+    uint64_t n_captured;  // frames handed to writer
+} FrameCapture;
+
+
+// Keep stdout for video and send later console output to stderr. Call before anything is printed
+// when capturing video to stdout
+void reserveStdoutForCapture(void);
+
+// Start writer thread and create render target of given size
+Status initFrameCapture(FrameCapture* capture, const char* path, CaptureFormat format, int width, int height,
+                        unsigned fps);
+// Finish readbacks in flight and wait until writer has written all frames
+void freeFrameCapture(FrameCapture* capture);
+
+// Bind offscreen framebuffer, the frame is rendered into it
+void beginFrameCapture(FrameCapture* capture);
+// Start readback of rendered frame, pass finished readbacks to writer and show the frame in the window
+void endFrameCapture(FrameCapture* capture, int window_width, int window_height);
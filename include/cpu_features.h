@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h>
+
+
+/*
+* Instruction set extensions of the running CPU, for kernels built in several versions with the
+* wider ones in their own files. An extension counts as available only if the CPU reports it
+* and the OS saves its registers. Detected once, always false on non-x86 targets.
+*/
+
+bool hasCpuAvx2(void);
+// AVX-512 Foundation
+bool hasCpuAvx512(void);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <cglm/cglm.h>
+
+#include "status.h"
+#include "dice_world.h"
+
+
+// View-frustum culling of dice bounding spheres.
+// Bounds are kept as separate x/y/z/radius arrays so that several dice
+// are tested against a plane with one SIMD instruction
+typedef struct {
+    size_t capacity;  // rounded up to the widest SIMD width
+    float* center_x;
+    float* center_y;
+    float* center_z;
+    float* radius;
+
+    uint32_t* visible;  // dense indices of dice that passed the test
+    size_t n_visible;
+} DiceCuller;
+
+
+Status initDiceCuller(DiceCuller* culler, size_t capacity);
+void freeDiceCuller(DiceCuller* culler);
+
+// Fill visible list with dice whose bounding sphere (die scale * mesh radius of its type) intersects
+// the frustum of view_projection matrix. Returns number of visible dice
+size_t cullDice(DiceCuller* culler, const DiceWorld* world, const float* type_radius, mat4 view_projection);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <cglm/cglm.h>
+
+
+/*
+* Kernel tables of culling, one per instruction set. Kernels take a multiple of width spheres, the
+* culler pads its bounds to CULL_MAX_WIDTH. Tables of instruction sets not enabled for their
+* translation unit have width 0. Every kernel computes plane distances with the same operations
+* in the same order, so visibility does not depend on the CPU.
+*/
+
+enum {
+    CULL_N_PLANES = 6,
+    CULL_MAX_WIDTH = 16
+};
+
+
+typedef struct {
+    size_t width;
+    // Write dense indices of spheres not entirely behind any plane, returns their number
+    size_t (*cull)(const float* x, const float* y, const float* z, const float* radius, size_t n,
+                   const vec4* planes, uint32_t* visible);
+} CullKernels;
+
+
+// Built into culling.c: SSE2 where the build targets it, scalar otherwise
+extern const CullKernels CULL_KERNELS_BASELINE;
+extern const CullKernels CULL_KERNELS_AVX2;
+extern const CullKernels CULL_KERNELS_AVX512;
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <cglm/cglm.h>
+
+#include "status.h"
+#include "animation.h"
+
+
+/*
+* All dice on the table. Components are stored as separate dense arrays
+* (structure of arrays) so passes over many dice touch only the data they need.
+* Dense arrays are kept packed: destroying a die moves the last one into its place.
+* Dice are referenced by generational handles, which stay valid while dice move
+* inside the dense arrays and become invalid once a die is destroyed.
+*/
+
+typedef struct {
+    uint32_t index;  // slot index
+    uint32_t generation;
+} DiceHandle;
+
+
+typedef enum {
+    DICE_STATE_IDLE,  // spinning in place
+    DICE_STATE_ROLLING,
+    DICE_STATE_SETTLED  // showing the result
+} DiceState;
+
+
+typedef struct {
+    uint32_t dense_index;  // position in dense arrays, or next free slot if unused
+    uint32_t generation;  // incremented every time the slot is freed
+} DiceSlot;
+
+
+typedef struct {
+    size_t capacity;
+    size_t n_dice;
+    size_t n_roll_points;  // size of each roll animation queue
+    double time;  // seconds advanced by updateDiceWorld()
+
+    // Dense components, indexed by [0, n_dice)
+    vec3* position;
+    versor* orientation;  // of idle and rolling dice only as of last updateDiceOrientations()
+    float* scale;
+    DiceType* type;
+    uint32_t* skin;
+    DiceState* state;
+    float* idle_angle_deg;
+    double* event_time;  // world time when die was created or last rolled
+    RollAnimationState* roll_anim;
+    int* target_value;  // value the die is rolling to
+    int* result;  // value on top once the die settles, 0 before
+    uint32_t* slot_index;  // back reference from dense position to slot
+
+    // Sparse handle table
+    DiceSlot* slots;
+    uint32_t free_slot;  // head of the free slot list
+    versor* roll_queues;  // roll animation queues, one per slot
+
+    // Slots of dice created or rolled since last clearDiceChanges(), for mirroring dice on GPU
+    uint32_t* changed_slots;
+    size_t n_changed_slots;
+    bool* is_slot_changed;
+} DiceWorld;
+
+
+Status initDiceWorld(DiceWorld* world, size_t capacity, const AnimationSettings* anim_settings);
+void freeDiceWorld(DiceWorld* world);
+
+// Add die in idle state. Fails if world is full
+Status createDice(DiceWorld* world, DiceType type, const vec3 position, float scale, uint32_t skin,
+                  DiceHandle* out_handle);
+void destroyDice(DiceWorld* world, DiceHandle handle);
+bool isDiceAlive(const DiceWorld* world, DiceHandle handle);
+// Position of a live die in dense arrays
+size_t getDiceDenseIndex(const DiceWorld* world, DiceHandle handle);
+
+// Start rolling die to the given value (1 to number of faces)
+void rollDice(DiceWorld* world, size_t dense_index, int dice_value, const AnimationSettings* settings);
+// Advance animation of all dice and settle finished rolls, returns number of dice still rolling.
+// Orientations of idle and rolling dice are left for updateDiceOrientations()
+size_t updateDiceWorld(DiceWorld* world, float time_delta, const AnimationSettings* settings);
+// Evaluate current orientations of dice at given dense indices, or of dice [0, n) if indices are NULL.
+// Done on demand, so that dice animated on GPU cost nothing here
+void updateDiceOrientations(DiceWorld* world, const AnimationSettings* settings, const uint32_t* dense_indices,
+                            size_t n);
+
+// Forget changed slots once they are consumed
+void clearDiceChanges(DiceWorld* world);
+
+// FNV-1a hash of orientations of all dice, for checking that replayed sessions match.
+// Orientations have to be evaluated by updateDiceOrientations() first
+uint32_t getDiceWorldChecksum(const DiceWorld* world);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "status.h"
+#include "histogram.h"
+
+
+/*
+* Frame time report of long sessions. Frame times and times of frame stages are recorded into fixed-size
+* histograms, so recording allocates nothing and costs the same however long the session runs. The JSON
+* report has percentiles, max and hitch counts for dashboards next to the raw buckets, so reports of many
+* instances merge into one without losing precision.
+*/
+
+typedef enum {
+    FRAME_STAGE_FRAME,  // full interval between frames
+    FRAME_STAGE_UPDATE,  // simulation
+    FRAME_STAGE_RENDER,  // draw submission, capture and statistics
+    FRAME_STAGE_PRESENT,  // buffer swap and window events
+    FRAME_N_STAGES
+} FrameStage;
+
+
+enum {
+    FRAME_REPORT_N_HITCH_LEVELS = 3  // frames over 33, 50 and 100 ms
+};
+
+
+typedef struct {
+    Histogram stages[FRAME_N_STAGES];  // microseconds
+    uint64_t n_hitches[FRAME_REPORT_N_HITCH_LEVELS];
+    uint64_t n_instances;  // sessions merged into report
+} FrameReport;
+
+
+void initFrameReport(FrameReport* report);
+// Recording the frame stage also counts hitches
+void recordFrameStage(FrameReport* report, FrameStage stage, double seconds);
+void mergeFrameReport(FrameReport* report, const FrameReport* other);
+
+// File is replaced in one step, readers never see a partially written report
+Status writeFrameReport(const FrameReport* report, const char* path);
+// Read report written by writeFrameReport
+Status readFrameReport(FrameReport* report, const char* path);
+
+const char* getFrameStageName(FrameStage stage);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "status.h"
+#include "gl_counters.h"
+
+
+/*
+* Per-frame statistics sink. Every frame is one CSV row with the frame time, the amount of work in the
+* frame (dice and text characters) and the GL calls it made, so scaling of driver overhead with scene
+* size can be plotted directly.
+*/
+
+typedef struct {
+    double frame_time;  // seconds from previous frame
+    size_t n_dice;
+    size_t n_text_characters;
+    GlCallCounters gl_calls;
+    uint64_t n_allocations;  // heap allocations made during the frame
+} FrameStats;
+
+
+typedef struct {
+    FILE* file;
+    uint64_t n_frames;
+} FrameStatsSink;
+
+
+Status openFrameStatsSink(FrameStatsSink* sink, const char* path);
+void closeFrameStatsSink(FrameStatsSink* sink);
+void writeFrameStats(FrameStatsSink* sink, const FrameStats* stats);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+* Optional accounting of GL calls. Installing replaces the glad function pointers of the entry points
+* the renderers use per frame with wrappers that count the call and forward it, so without installing
+* there is no overhead. Counts cover calls reaching the driver, after the state cache.
+*/
+
+typedef struct {
+    uint64_t n_draw_calls;  // draw commands, a multi-draw counts once
+    uint64_t n_dispatches;  // compute dispatches
+    uint64_t n_state_changes;  // program, vertex array, buffer and framebuffer binds, enables, blend, viewport
+    uint64_t n_texture_binds;
+    uint64_t n_uniform_updates;
+    uint64_t n_upload_bytes;  // buffer data uploaded from client memory
+} GlCallCounters;
+
+
+// Wrap entry points, call once after GL functions are loaded
+void installGlCallCounters(void);
+bool areGlCallCountersInstalled(void);
+// Counts since previous call, counting starts anew
+GlCallCounters takeGlCallCounters(void);
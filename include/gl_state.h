@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <glad/gl.h>
+
+
+/*
+* Cache of the GL state the renderers change every frame. Changes to state already in effect are not
+* passed to the driver and are counted as skipped. State starts unknown, so the first change of each
+* kind always reaches the driver. Code that changes cached state must go through this module.
+*/
+
+enum {
+    GL_STATE_N_TEXTURE_UNITS = 8  // cached units, higher units are always bound
+};
+
+
+typedef enum {
+    STATE_PROGRAM,
+    STATE_VERTEX_ARRAY,
+    STATE_TEXTURE_UNIT,
+    STATE_CAPABILITY,  // blend, depth test, cull face
+    STATE_BLEND_FUNC,
+    STATE_POLYGON_MODE,
+    STATE_N_KINDS
+} GlStateKind;
+
+
+typedef struct {
+    uint64_t n_requested[STATE_N_KINDS];
+    uint64_t n_skipped[STATE_N_KINDS];  // requested changes that were already in effect
+} GlStateCounters;
+
+
+void useGlProgram(GLuint program);
+void bindGlVertexArray(GLuint vao);
+void bindGlTextureUnit(GLuint unit, GLuint texture);
+// GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are cached, other capabilities are always set
+void setGlCapability(GLenum capability, bool is_enabled);
+void setGlBlendFunc(GLenum source_factor, GLenum destination_factor);
+void setGlPolygonMode(GLenum mode);
+
+// Deleted objects release their names for reuse, so bindings to them must be forgotten before deletion
+void forgetGlTexture(GLuint texture);
+void forgetGlVertexArray(GLuint vao);
+
+const GlStateCounters* getGlStateCounters(void);
+const char* getGlStateKindName(GlStateKind kind);
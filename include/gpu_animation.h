@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+
+#include "status.h"
+#include "shader.h"
+#include "animation.h"
+#include "dice_world.h"
+
+
+/*
+* Evaluation of dice orientations in a compute shader. Dice records and roll keyframes are mirrored
+* on GPU once per event (die created or rolled), indexed by slot. Every frame only the slots of drawn
+* dice are uploaded, and the compute shader writes their model and normal matrices into instance buffer.
+*/
+
+// Dice record layout shared with roll compute shader (std430)
+typedef struct {
+    vec4 position_scale;
+    GLfloat event_time;
+    GLfloat idle_angle_deg;
+    GLuint is_rolling;
+    GLuint padding;
+} GpuDiceRecord;
+
+
+typedef struct {
+    GLuint instance_count_id;
+    GLuint time_id;
+    GLuint view_id;
+    GLuint idle_speed_id;
+    GLuint keyframe_count_id;
+    GLuint max_speed_id;
+    GLuint min_speed_id;
+    GLuint deceleration_id;
+    GLuint deceleration_start_id;
+    GLuint interpolation_id;
+} GpuAnimatorUniformVariables;
+
+
+typedef struct {
+    ShaderProgram shader;
+    GpuAnimatorUniformVariables uvars;
+
+    size_t capacity;  // dice slots
+    size_t n_keyframes;  // per slot: start orientation followed by roll keyframes
+    GLuint record_buffer;
+    GLuint keyframe_buffer;
+    GLuint draw_slot_buffer;  // slot of die drawn by every instance
+} GpuAnimator;
+
+
+// capacity and n_roll_points should match dice world
+Status initGpuAnimator(GpuAnimator* animator, size_t capacity, size_t n_roll_points);
+void freeGpuAnimator(GpuAnimator* animator);
+
+void requestGpuAnimatorShaderReload(GpuAnimator* animator, const char* file_name);
+void updateGpuAnimatorShaderReload(GpuAnimator* animator);
+
+// Upload dice created or rolled since last sync
+void syncGpuAnimator(GpuAnimator* animator, DiceWorld* world);
+
+// Write matrices of n_instances dice with given slots at current world time into instance_buffer.
+// Caller issues memory barrier before instances are read
+void dispatchGpuAnimator(GpuAnimator* animator, const DiceWorld* world, const AnimationSettings* settings,
+                         const uint32_t* draw_slots, size_t n_instances, mat4 view, GLuint instance_buffer);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+* Log-bucketed histogram of integer values in the layout of HDR histograms: values below
+* 2 * HISTOGRAM_N_SUB_BUCKETS have a bucket each, every power of two range above that is split into
+* HISTOGRAM_N_SUB_BUCKETS linear buckets. Values keep about 3% precision over the whole range, memory is
+* fixed and recording is constant time. Histograms merge by adding bucket counts.
+*/
+
+enum {
+    HISTOGRAM_SUB_BUCKET_BITS = 5,
+    HISTOGRAM_N_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS,
+    HISTOGRAM_VALUE_BITS = 36,  // larger values are clamped
+    HISTOGRAM_N_BUCKETS = (HISTOGRAM_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_N_SUB_BUCKETS
+};
+
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_N_BUCKETS];
+    uint64_t n_values;
+    uint64_t sum;
+    uint64_t min;  // exact, UINT64_MAX while empty
+    uint64_t max;  // exact
+} Histogram;
+
+
+void clearHistogram(Histogram* histogram);
+void recordHistogramValue(Histogram* histogram, uint64_t value);
+void mergeHistogram(Histogram* histogram, const Histogram* other);
+
+// Value that percentile (0-100) of recorded values do not exceed, rounded up to its bucket
+uint64_t getHistogramPercentile(const Histogram* histogram, double percentile);
+
+size_t getHistogramBucketIndex(uint64_t value);
+// Largest value that falls into bucket
+uint64_t getHistogramBucketHighestValue(size_t index);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <glad/gl.h>
+
+#include "status.h"
+#include "shader.h"
+#include "text.h"
+#include "gl_counters.h"
+
+
+/*
+* Performance overlay: rolling frame time graph, frame time percentiles, CPU and GPU time of the last
+* frame, and its GL calls and heap allocations. GPU time comes from timer queries read a few frames
+* later, so the render thread never waits for them. Panel, graph and glyphs are one vertex batch drawn
+* with a single call.
+*/
+
+enum {
+    HUD_N_FRAMES = 240,  // frames in graph and percentiles
+    HUD_N_TIMERS = 4,  // GPU timer queries in flight
+    HUD_MAX_QUADS = 640  // panel, graph bars and glyphs
+};
+
+
+typedef struct {
+    GLfloat position[2];
+    GLfloat tex_coords[2];  // negative for solid fill
+    GLubyte color[4];
+} HudVertex;
+
+
+typedef struct {
+    GLuint projection_id;
+} HudUniformVariables;
+
+
+typedef struct {
+    GLuint vao;
+    GLuint vbo;
+    ShaderProgram shader;
+    HudUniformVariables uvars;
+    const TextRenderer* text;  // glyph atlas is shared with text renderer
+    HudVertex* vertices;
+    size_t n_vertices;
+
+    // Frame times in milliseconds, oldest at history_first
+    float frame_ms[HUD_N_FRAMES];
+    size_t history_first;
+    size_t n_history;
+
+    // Timer queries in flight, oldest at timer_first
+    GLuint timers[HUD_N_TIMERS];
+    size_t timer_first;
+    size_t n_timers;
+    bool is_timing;  // query of current frame was started
+
+    // Last frame
+    double cpu_start_time;
+    float cpu_ms;  // from beginHudFrame to endHudFrame
+    float gpu_ms;  // negative until first timer query finished
+    GlCallCounters gl_calls;
+    uint64_t n_allocations;
+} Hud;
+
+
+Status initHud(Hud* hud, const TextRenderer* text);
+void freeHud(Hud* hud);
+
+// Start recompiling HUD shaders in background if file_name is one of their sources
+void requestHudShaderReload(Hud* hud, const char* file_name);
+// Swap in recompiled shaders once they are ready. Should be run every frame
+void updateHudShaderReload(Hud* hud);
+
+// Start CPU and GPU timing of frame work
+void beginHudFrame(Hud* hud, double time);
+// Stop timing and record frame. Frame time is the full interval between frames
+void endHudFrame(Hud* hud, double time, double frame_time);
+// GL calls and allocations of previous frame, taken after the overlay was drawn
+void setHudFrameCounters(Hud* hud, const GlCallCounters* gl_calls, uint64_t n_allocations);
+
+void renderHud(Hud* hud, float window_width, float window_height);
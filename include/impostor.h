@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+
+#include "status.h"
+#include "shader.h"
+
+
+/*
+* Impostors of distant dice. Every dice type is pre-rendered from a grid of view directions
+* into its own layer of an atlas array. View directions are mapped to the grid with octahedral encoding, so
+* cells cover the sphere of directions evenly. Far dice are drawn as camera-facing quads
+* sampling the cell nearest to their current view direction, rolled in screen space.
+*/
+
+enum {
+    IMPOSTOR_GRID_SIZE = 8,  // cells per atlas side
+    IMPOSTOR_CELL_SIZE = 128  // pixels
+};
+
+
+// Instance data layout shared with impostor vertex shader (std430)
+typedef struct {
+    vec4 center_radius;  // view space center and bounding radius
+    vec4 cell_up;  // atlas cell and screen up direction in cell image coordinates
+    GLfloat layer;  // atlas layer of dice type
+    GLfloat padding[3];
+} ImpostorInstance;
+
+
+typedef struct {
+    GLuint projection_id;
+    GLuint grid_size_id;
+} ImpostorUniformVariables;
+
+
+typedef struct {
+    GLuint atlas_texture;  // array texture, one layer per dice type
+    size_t n_layers;
+    GLuint depth_buffer;
+    GLuint framebuffer;
+
+    ShaderProgram shader;
+    ImpostorUniformVariables uvars;
+
+    GLuint vao;  // quads are generated from vertex id, no attributes
+    GLuint instance_buffer;
+    size_t instance_capacity;
+    ImpostorInstance* instances;  // staging copy of instance_buffer
+    size_t n_instances;
+} ImpostorRenderer;
+
+
+Status initImpostorRenderer(ImpostorRenderer* impostor, size_t n_layers, size_t max_dice);
+void freeImpostorRenderer(ImpostorRenderer* impostor);
+
+void requestImpostorShaderReload(ImpostorRenderer* impostor, const char* file_name);
+void updateImpostorShaderReload(ImpostorRenderer* impostor);
+
+// Capture basis of atlas cell: model space directions of image right and up axes,
+// and view direction (from die towards camera)
+void getImpostorCellBasis(int cell_x, int cell_y, vec3 right, vec3 up, vec3 dir);
+
+// Bind atlas framebuffer to cleared layer. Caller restores previous framebuffer and viewport
+void beginImpostorLayerCapture(ImpostorRenderer* impostor, int layer);
+// Set viewport to the cell of current layer
+void beginImpostorCellCapture(ImpostorRenderer* impostor, int cell_x, int cell_y);
+// Build atlas mip levels once all cells are captured
+void finishImpostorAtlas(ImpostorRenderer* impostor);
+
+// Append impostor of a die: atlas layer, center in view space, rotation of view * model and bounding radius
+void addImpostorInstance(ImpostorRenderer* impostor, int layer, vec3 view_center, versor view_rotation,
+                         float radius);
+void renderImpostors(ImpostorRenderer* impostor, mat4 projection);
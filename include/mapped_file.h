@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "status.h"
+
+
+// Read-only memory mapping of a whole file
+typedef struct {
+    const void* data;
+    size_t size;
+    void* handle;  // platform specific mapping handle
+} MappedFile;
+
+
+Status mapFile(const char* path, MappedFile* file);
+void unmapFile(MappedFile* file);
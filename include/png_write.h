@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "status.h"
+
+
+/*
+* Minimal PNG writer for tools and captures. Image data is stored uncompressed (deflate stored blocks),
+* which keeps writing fast and free of dependencies at the cost of file size.
+*/
+
+// Write 8-bit image with 1 (gray), 3 (RGB) or 4 (RGBA) channels, rows top to bottom
+Status writePng(const char* path, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t n_channels);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+
+#include "icosahedron.h"
+
+
+typedef enum {
+    DICE_D4,
+    DICE_D6,
+    DICE_D8,
+    DICE_D10,
+    DICE_D12,
+    DICE_D20,
+    DICE_N_TYPES
+} DiceType;
+
+
+enum {
+    DICE_MAX_FACES = 20,
+    DICE_MAX_VERTICES = 512,
+    DICE_MAX_INDICES = 512,
+    DICE_FACE_TABLE_SIZE = 32  // DICE_MAX_FACES rounded up to a multiple of every SIMD width
+};
+
+
+typedef struct {
+    size_t n_faces;
+
+    // Draw range in shared vertex and index buffers
+    GLuint first_index;
+    GLuint n_indices;
+    GLint base_vertex;
+
+    float radius;  // bounding sphere radius
+
+    // Face tables, indexed by face
+    int face_value[DICE_MAX_FACES];
+    vec3 face_normal[DICE_MAX_FACES];  // outward
+    vec3 face_up[DICE_MAX_FACES];  // direction in face plane to the top of the number
+
+    // Face normals as separate coordinate arrays for SIMD dot products. Padding faces
+    // have zero normal and -INFINITY bias, so their dot product never wins
+    float normal_x[DICE_FACE_TABLE_SIZE];
+    float normal_y[DICE_FACE_TABLE_SIZE];
+    float normal_z[DICE_FACE_TABLE_SIZE];
+    float normal_bias[DICE_FACE_TABLE_SIZE];
+} DiceMesh;
+
+
+// Meshes of all dice types packed into one vertex and one index buffer.
+// Calculated during runtime using initDiceMeshes()
+extern DiceMesh gDiceMeshes[DICE_N_TYPES];
+extern Vertex gDiceVertices[DICE_MAX_VERTICES];
+extern GLuint gDiceIndices[DICE_MAX_INDICES];
+extern size_t gDiceVertexCount;
+extern size_t gDiceIndexCount;
+
+// Initialize meshes of all dice types. Should be run once
+void initDiceMeshes(void);
+
+size_t getDiceFaceCount(DiceType type);
+size_t getDiceFaceIndex(DiceType type, int dice_value);
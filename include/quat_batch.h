@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <cglm/cglm.h>
+
+
+/*
+* Quaternion kernels over batches stored as separate component arrays (structure of arrays).
+* Every kernel has a scalar reference and SSE2, AVX2, AVX-512 and NEON versions, the widest one
+* supported by the CPU is picked at runtime. All versions do the same operations in the same order,
+* without fused multiply-add, and approximate acos and sin by the same polynomials, so results are
+* bit-identical on every machine and recorded sessions replay anywhere. Quaternions are (x, y, z, w)
+* like cglm versors. Output arrays may be the same as input arrays.
+*/
+
+enum {
+    QUAT_BATCH_CHUNK = 64  // batch size for callers gathering components into stack arrays
+};
+
+
+typedef enum {
+    QUAT_ISA_SCALAR,
+    QUAT_ISA_SSE2,
+    QUAT_ISA_NEON,
+    QUAT_ISA_AVX2,
+    QUAT_ISA_AVX512,
+    QUAT_N_ISAS
+} QuatIsa;
+
+
+// Interpolation between two orientations
+typedef enum {
+    QUAT_SLERP,  // constant angular speed
+    QUAT_NLERP,  // cheapest, angular speed peaks halfway and error grows with angle
+    QUAT_FAST_SLERP,  // nlerp with weight corrected by polynomial of weight and cosine of angle
+    QUAT_N_INTERPOLATIONS
+} QuatInterpolation;
+
+
+typedef struct {
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+} QuatArrays;
+
+
+typedef struct {
+    float* x;
+    float* y;
+    float* z;
+} Vec3Arrays;
+
+
+typedef struct {
+    float* m[3][3];  // [column][row], like cglm matrices
+} Mat3Arrays;
+
+
+// Widest instruction set supported by both the build and the CPU
+QuatIsa getBestQuatIsa(void);
+bool isQuatIsaSupported(QuatIsa isa);
+// Instruction set used by kernels, best one unless overridden by setQuatIsa()
+QuatIsa getQuatIsa(void);
+// Force kernels to one instruction set, for comparing them. Ignored if unsupported
+void setQuatIsa(QuatIsa isa);
+const char* getQuatIsaName(QuatIsa isa);
+
+// Unit quaternions, identity for zero ones
+void normalizeQuats(QuatArrays q, QuatArrays out, size_t n);
+// Hamilton product a * b, rotating by b first
+void multiplyQuats(QuatArrays a, QuatArrays b, QuatArrays out, size_t n);
+// Normalized linear interpolation along the shorter arc
+void nlerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+// Spherical linear interpolation along the shorter arc, falls back to nlerp for nearly equal quaternions
+void slerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+// Nlerp with weight corrected to approximate slerp (Kapoulkine's fit), no acos or sin
+void fastSlerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+void interpolateQuats(QuatInterpolation method, QuatArrays a, QuatArrays b, const float* t, QuatArrays out,
+                      size_t n);
+void quatsToMat3(QuatArrays q, Mat3Arrays out, size_t n);
+void quatsToMat4(QuatArrays q, mat4* out, size_t n);
+void rotateVec3s(QuatArrays q, Vec3Arrays v, Vec3Arrays out, size_t n);
+
+// Single quaternion versions, same results as the batch kernels
+void nlerpQuat(versor a, versor b, float t, versor out);
+void slerpQuat(versor a, versor b, float t, versor out);
+void interpolateQuat(QuatInterpolation method, versor a, versor b, float t, versor out);
+const char* getQuatInterpolationName(QuatInterpolation method);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "quat_batch.h"
+
+
+/*
+* Kernel tables of quat_batch, one per instruction set. Kernels take a multiple of width
+* quaternions, the rest is done by the scalar table. Tables of instruction sets not enabled
+* for their translation unit have width 0.
+*/
+
+typedef struct {
+    size_t width;
+    void (*normalize)(QuatArrays q, QuatArrays out, size_t n);
+    void (*multiply)(QuatArrays a, QuatArrays b, QuatArrays out, size_t n);
+    void (*nlerp)(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+    void (*slerp)(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+    void (*fastSlerp)(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n);
+    void (*toMat3)(QuatArrays q, Mat3Arrays out, size_t n);
+    void (*toMat4)(QuatArrays q, mat4* out, size_t n);
+    void (*rotate)(QuatArrays q, Vec3Arrays v, Vec3Arrays out, size_t n);
+} QuatKernels;
+
+
+extern const QuatKernels QUAT_KERNELS_AVX2;
+extern const QuatKernels QUAT_KERNELS_AVX512;
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "status.h"
+#include "mapped_file.h"
+
+
+/*
+* Resource pack (.pak) produced by d20_pack at build time.
+* Header, index of entries sorted by name, then blobs each starting
+* at RESOURCE_PACK_ALIGNMENT boundary. All values are little-endian.
+*/
+
+#define RESOURCE_PACK_MAGIC 0x4B503244u  // "D2PK"
+
+enum {
+    RESOURCE_PACK_VERSION = 1,
+    RESOURCE_NAME_LENGTH = 64,  // including terminating null
+    RESOURCE_PACK_ALIGNMENT = 64
+};
+
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_entries;
+    uint32_t reserved;
+} ResourcePackHeader;
+
+
+typedef struct {
+    char name[RESOURCE_NAME_LENGTH];  // resource path, e.g. "resources/fonts/arial.ttf"
+    uint64_t offset;  // from the start of the pack
+    uint64_t size;
+} ResourcePackEntry;
+
+
+// Read-only view of resource data, either inside the pack or a separately mapped file
+typedef struct {
+    const void* data;
+    size_t size;
+    bool is_mapped;
+    MappedFile file;
+} Resource;
+
+
+// Map resource pack once, all following loadResource() calls are served from it
+Status openResourcePack(const char* path);
+// Use resource pack compiled into the executable (D20_EMBED_RESOURCES build option).
+// Fails if the executable was built without it
+Status openEmbeddedResourcePack(void);
+void closeResourcePack(void);
+bool isResourcePackOpen(void);
+
+// Get resource by path: zero-copy view into the pack or mapped file as a fallback
+Status loadResource(const char* path, Resource* resource);
+// Get resource from the filesystem, bypassing the pack
+Status loadResourceFile(const char* path, Resource* resource);
+void freeResource(Resource* resource);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+
+// PCG32 random number generator (O'Neill). Small state, so every thread or replay
+// can own its generator, and the sequence depends only on seed and stream
+typedef struct {
+    uint64_t state;
+    uint64_t increment;  // selects one of 2^63 independent streams, always odd
+} Rng;
+
+
+void initRng(Rng* rng, uint64_t seed, uint64_t stream);
+uint32_t nextRngU32(Rng* rng);
+// Uniform in [0, bound) without modulo bias
+uint32_t nextRngBounded(Rng* rng, uint32_t bound);
+// Uniform in [0, 1)
+float nextRngFloat(Rng* rng);
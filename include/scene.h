@@ -5,31 +5,72 @@
 
 #include "status.h"
 #include "shader.h"
+#include "dice_world.h"
+#include "culling.h"
+#include "impostor.h"
+#include "polyhedron.h"
+#include "gpu_animation.h"
+#include "transform.h"
 
 
 typedef struct {
-    GLuint model_id;
-    GLuint normal_matrix_id;
     GLuint view_id;
     GLuint projection_id;
     GLuint light_dir_id;
     GLuint ambient_brightness_id;
     GLuint direct_brightness_id;
     GLuint specular_brightness_id;
+    GLint instance_offset_id;  // -1 when shader takes base instance from draw parameters
 } SceneUniformVariables;
 
 
+// Command layout read by glMultiDrawElementsIndirect
+typedef struct {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;  // first instance of the draw in instance buffer
+} DrawElementsIndirectCommand;
+
+
 typedef struct {
     GLuint vao;
     GLuint vbo;
+    GLuint ibo;  // meshes of all dice types, see gDiceMeshes for draw ranges
     GLuint texture;
     ShaderProgram shader;
     SceneUniformVariables uvars;
+
+    // Per-die transforms of visible dice for instanced draw
+    GLuint instance_buffer;
+    size_t instance_capacity;
+    DiceInstance* instances;  // staging copy of instance_buffer, grouped by dice type
+    uint32_t* near_dice;  // dense indices of visible dice drawn as meshes
+    uint32_t* far_dice;  // dense indices of visible dice drawn as impostors
+    uint32_t* draw_dice;  // near dice grouped by type, instance k belongs to die draw_dice[k]
+    uint32_t* draw_slots;  // slots of instances, when instances are written by GPU animation
+
+    // One draw per dice type, all submitted with a single multi-draw call. Without shader draw parameters
+    // the vertex shader cannot see base instance of a command, and types are drawn one by one
+    bool has_draw_parameters;
+    GLuint command_buffer;
+    DrawElementsIndirectCommand commands[DICE_N_TYPES];
+
+    DiceCuller culler;
+    float type_radius[DICE_N_TYPES];  // bounding sphere radius of unscaled die of each type
+
+    // Distant dice are drawn as impostors
+    ImpostorRenderer impostor;
+    bool is_impostor_atlas_valid;  // atlas is captured on first frame and after shader reload
+
+    GpuAnimator animator;
+    CameraTransform camera;
 } SceneRenderer;
 
 
 typedef struct {
-    float scale;
+    float scale;  // of newly created dice
     float fov_deg;
     float camera_near_z;
     float camera_far_z;
@@ -40,11 +81,23 @@ typedef struct {
     GLfloat ambient_brightness;
 
     vec3 camera_position;
+
+    float impostor_size_px;  // dice with smaller projected radius are drawn as impostors
+    bool gpu_animation;  // evaluate orientations of near dice in compute shader
 } SceneSettings;
 
 
-Status initSceneRenderer(SceneRenderer* renderer);
+// Buffers are sized for capacity of the world
+Status initSceneRenderer(SceneRenderer* renderer, const DiceWorld* world);
 void freeSceneRenderer(SceneRenderer* renderer);
 
-void renderScene(SceneRenderer* renderer, SceneSettings* settings, versor rot_quat,
-                 float aspect_ratio, bool wireMode);
+// Start recompiling scene shaders in background if file_name is one of their sources
+void requestSceneShaderReload(SceneRenderer* renderer, const char* file_name);
+// Swap in recompiled shaders once they are ready. Should be run every frame
+void updateSceneShaderReload(SceneRenderer* renderer);
+
+// Draw all dice of the world inside view frustum: near ones with one multi-draw call when supported,
+// distant ones as impostors in another. With GPU animation, changes of the world are consumed.
+// Width and height are framebuffer pixels
+void renderScene(SceneRenderer* renderer, SceneSettings* settings, const AnimationSettings* anim_settings,
+                 DiceWorld* world, int width, int height, bool wireMode);
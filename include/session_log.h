@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "status.h"
+
+
+/*
+* Session log: everything needed to re-run a session deterministically. Header with RNG seed and
+* world setup, then records in the order they happened: key events and frames. Frame record holds
+* the frame delta fed to the dice world and checksum of dice orientations after the update,
+* so replays find the first frame that diverged. Records are packed without padding,
+* all values are little-endian.
+*/
+
+#define SESSION_LOG_MAGIC 0x53303244u  // "D20S"
+
+enum {
+    SESSION_LOG_VERSION = 2
+};
+
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t seed;
+    uint32_t n_dice;
+    uint32_t dice_type;
+    uint32_t interpolation;  // QuatInterpolation of roll animation
+    uint32_t reserved;  // zero, keeps header free of padding
+} SessionLogHeader;
+
+
+typedef enum {
+    SESSION_RECORD_FRAME = 1,  // float delta, uint32 checksum
+    SESSION_RECORD_KEY = 2  // int16 key, uint8 action, double time
+} SessionRecordType;
+
+
+typedef struct {
+    SessionRecordType type;
+
+    // Frame
+    float time_delta;
+    uint32_t checksum;
+
+    // Key event
+    int key;
+    int action;
+    double time;  // seconds since the session started
+} SessionRecord;
+
+
+typedef struct {
+    FILE* file;
+    bool is_writing;
+    uint64_t n_frames;  // frame records written or read so far
+} SessionLog;
+
+
+// Create log file and write its header
+Status openSessionLogForWriting(SessionLog* log, const char* path, uint64_t seed, uint32_t n_dice,
+                                uint32_t dice_type, uint32_t interpolation);
+// Open log file and read its header
+Status openSessionLogForReading(SessionLog* log, const char* path, SessionLogHeader* out_header);
+void closeSessionLog(SessionLog* log);
+
+void writeSessionFrame(SessionLog* log, float time_delta, uint32_t checksum);
+void writeSessionKey(SessionLog* log, int key, int action, double time);
+// Next record, false at the end of log
+bool readSessionRecord(SessionLog* log, SessionRecord* record);
@@ -1,18 +1,53 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include <glad/gl.h>
 #include "status.h"
 
 
 typedef struct {
     GLuint id;  // OpenGL program id
+    GLuint pending_id;  // program being rebuilt in background, 0 if none
+    const char* vertex_shader_path;
+    const char* fragment_shader_path;
+    const char* compute_shader_path;  // NULL unless program is a compute program
 } ShaderProgram;
 
 
-// Initialize shader program
+typedef enum {
+    PROGRAM_RELOAD_NONE,     // no reload in progress
+    PROGRAM_RELOAD_PENDING,  // driver is still compiling
+    PROGRAM_RELOAD_LINKED,   // new program linked as pending_id, its uniforms must be resolved before the swap
+    PROGRAM_RELOAD_DONE,     // new program replaced the old one
+    PROGRAM_RELOAD_FAILED    // new program was discarded, old one is still in use
+} ProgramReloadStatus;
+
+
+// Let the driver compile shaders on its own threads (GL_KHR_parallel_shader_compile).
+// Should be run once after OpenGL is loaded
+void initParallelShaderCompile(void);
+
+// Initialize shader program, sources are looked up in the resource pack first
 Status initProgram(const char* vertex_shader_path, const char* fragment_shader_path,
                    ShaderProgram* shader_program);
+// Initialize compute program, which has only a compute shader
+Status initComputeProgram(const char* compute_shader_path, ShaderProgram* shader_program);
 void freeProgram(ShaderProgram* shader_program);
 
-// Initialize uniform variable for OpenGL program
-GLuint initUniformVariable(GLuint program, const char* name);
+// Whether file name (without directory) is one of the program sources
+bool isProgramSource(const ShaderProgram* shader_program, const char* file_name);
+
+// Directory that reloaded shader sources are read from, "resources/shaders" by default
+void setShaderSourceDir(const char* dir_path);
+// Start rebuilding program from its source files on disk. Current program stays in use until
+// the new one has linked and all its uniforms are found
+Status beginProgramReload(ShaderProgram* shader_program);
+ProgramReloadStatus pollProgramReload(ShaderProgram* shader_program);
+// Swap in linked program if its uniforms were resolved, otherwise discard it and keep the old one.
+// Returns PROGRAM_RELOAD_DONE or PROGRAM_RELOAD_FAILED
+ProgramReloadStatus finishProgramReload(ShaderProgram* shader_program, Status uniform_status);
+
+// Location of uniform variable of OpenGL program. A missing uniform, e.g. one removed by the
+// compiler as unused, is reported and sets status to STATUS_ERR
+GLuint initUniformVariable(GLuint program, const char* name, Status* status);
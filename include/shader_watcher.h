@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "status.h"
+
+
+enum {
+    SHADER_WATCHER_BUFFER_SIZE = 4096
+};
+
+
+// Watches a directory for modified shader files (inotify on Linux)
+typedef struct {
+    int fd;  // -1 if watching is unavailable
+    int watch_id;
+    char buf[SHADER_WATCHER_BUFFER_SIZE];
+    size_t buf_len;  // number of bytes read into buffer
+    size_t buf_pos;  // next event to report
+} ShaderWatcher;
+
+
+// Start watching directory. On failure watcher stays valid and reports no changes
+Status initShaderWatcher(ShaderWatcher* watcher, const char* dir_path);
+void freeShaderWatcher(ShaderWatcher* watcher);
+
+// Get name of the next modified file in the directory or NULL if there are no more changes.
+// Never blocks. Returned name is valid until the next call
+const char* pollShaderWatcher(ShaderWatcher* watcher);
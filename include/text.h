@@ -1,18 +1,13 @@
 #pragma once
 
+#include <stddef.h>
+
 #include <glad/gl.h>
 #include <cglm/cglm.h>
 
 #include "status.h"
 #include "shader.h"
-
-
-typedef struct {
-    GLuint texture_id;
-    ivec2 size;
-    ivec2 bearing;
-    GLuint advance;
-} Character;
+#include "text_atlas.h"
 
 
 typedef struct {
@@ -27,17 +22,36 @@ typedef struct {
     ShaderProgram shader;
     TextUniformVariables uvars;
     Character* char_array_ptr;
+    GLuint atlas_texture;  // signed distance field of all characters
+    ivec2 atlas_size;
 } TextRenderer;
 
 
+// Glyph quad in window pixels, y up, with its atlas texture coordinates
+typedef struct {
+    float x0, y0, x1, y1;  // bottom-left and top-right corners
+    float u0, v0, u1, v1;  // atlas coordinates of top-left and bottom-right corners
+} TextQuad;
+
+
 typedef struct {
     vec3 text_color;
-    float text_size;
+    float text_size;  // pixels
 } TextSettings;
 
 
 Status initTextRenderer(TextRenderer* renderer);
 void freeTextRenderer(TextRenderer* renderer);
 
+// Start recompiling text shaders in background if file_name is one of their sources
+void requestTextShaderReload(TextRenderer* renderer, const char* file_name);
+// Swap in recompiled shaders once they are ready. Should be run every frame
+void updateTextShaderReload(TextRenderer* renderer);
+
+// Glyph quads of text with baseline starting at (pos_x, pos_y), for drawing text batched with other geometry.
+// Writes at most max_quads quads, returns number written
+size_t layoutText(const TextRenderer* renderer, const char* text, float text_size, float pos_x, float pos_y,
+                  TextQuad* quads, size_t max_quads);
+
 void renderText(TextRenderer* renderer, const char* text, TextSettings* settings,
                 float pos_x, float pos_y, float window_width, float window_height);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+
+#include "status.h"
+
+
+/*
+* Signed distance field atlas of printable ASCII glyphs, rendered by FreeType.
+* Generated at build time by d20_atlas into the resource pack; the application renders
+* it itself only when no atlas matching its font is available. Stored as a header
+* followed by width * height single-channel pixels, top row first.
+*/
+
+#define TEXT_ATLAS_MAGIC 0x46445344u  // "DSDF"
+
+enum {
+    TEXT_ATLAS_VERSION = 1,
+    TEXT_N_CHARACTERS = 128,
+    TEXT_FIRST_PRINTABLE = 32,
+
+    // Distance field is rendered once at this size and scaled to any text size
+    TEXT_SDF_PIXEL_SIZE = 32,
+    TEXT_SDF_SPREAD = 4,  // distance range in pixels on each side of the outline
+    TEXT_ATLAS_WIDTH = 512,
+    TEXT_ATLAS_PADDING = 1
+};
+
+
+// Glyph metrics in pixels of the distance field atlas
+typedef struct {
+    ivec2 atlas_offset;  // top-left corner in atlas
+    ivec2 size;
+    ivec2 bearing;
+    GLuint advance;
+} Character;
+
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t font_hash;  // identifies the font the atlas was generated from
+    uint32_t pixel_size;
+    uint32_t spread;
+    uint32_t width;
+    uint32_t height;
+    Character characters[TEXT_N_CHARACTERS];
+} TextAtlasHeader;
+
+
+uint32_t hashTextFont(const void* font_data, size_t font_size);
+
+// Render atlas of the font. Pixels are allocated and should be freed by caller
+Status generateTextAtlas(const void* font_data, size_t font_size, TextAtlasHeader* header, unsigned char** pixels);
+
+// Copy header of atlas data if it was generated from the font with current parameters.
+// Pixels follow the header in data
+Status readTextAtlasHeader(const void* data, size_t size, uint32_t font_hash, TextAtlasHeader* header);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glad/gl.h>
+#include "status.h"
+
+
+/*
+* Texture container (.d20tex) produced offline by d20_texconv.
+* Fixed-size header followed by the full mip chain, largest level first,
+* each level starting at TEXTURE_CONTAINER_ALIGNMENT boundary.
+* All values are little-endian.
+*/
+
+#define TEXTURE_CONTAINER_MAGIC 0x58543244u  // "D2TX"
+
+enum {
+    TEXTURE_CONTAINER_VERSION = 1,
+    TEXTURE_CONTAINER_MAX_LEVELS = 16,
+    TEXTURE_CONTAINER_ALIGNMENT = 16,
+    TEXTURE_CONTAINER_MAX_SIZE = 1 << (TEXTURE_CONTAINER_MAX_LEVELS - 1)
+};
+
+
+typedef enum {
+    TEXTURE_FORMAT_RGB8 = 0,
+    TEXTURE_FORMAT_BC1 = 1  // S3TC DXT1, 8 bytes per 4x4 block
+} TextureContainerFormat;
+
+
+typedef struct {
+    uint32_t offset;  // from the start of the file
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+} TextureContainerLevel;
+
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_levels;
+    TextureContainerLevel levels[TEXTURE_CONTAINER_MAX_LEVELS];
+} TextureContainerHeader;
+
+
+// Number of levels in full mip chain down to 1x1
+uint32_t getTextureMipLevelCount(uint32_t width, uint32_t height);
+// Bytes of one level of given dimensions
+uint64_t getTextureLevelSize(TextureContainerFormat format, uint32_t width, uint32_t height);
+
+// Create texture and upload every level directly from container data (e.g. a mapped file)
+Status initTextureFromContainer(const void* data, size_t size, GLuint* texture_id);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "status.h"
+
+
+typedef void (*ThreadFunction)(void* arg);
+
+
+// Native thread: Win32 threads on Windows, pthreads elsewhere
+typedef struct {
+    void* handle;
+} Thread;
+
+
+Status startThread(Thread* thread, ThreadFunction function, void* arg);
+// Wait until thread function returns and release the thread
+void joinThread(Thread* thread);
+
+// Number of logical processors, at least 1
+size_t getProcessorCount(void);
+
+
+// Mutex and condition variable on the same native backends
+typedef struct {
+    void* handle;
+} Mutex;
+
+
+typedef struct {
+    void* handle;
+} ConditionVariable;
+
+
+Status initMutex(Mutex* mutex);
+void freeMutex(Mutex* mutex);
+void lockMutex(Mutex* mutex);
+void unlockMutex(Mutex* mutex);
+
+Status initConditionVariable(ConditionVariable* condition);
+void freeConditionVariable(ConditionVariable* condition);
+// Unlock mutex, sleep until woken up and lock it again. Wakeups may be spurious, so check state in a loop
+void waitConditionVariable(ConditionVariable* condition, Mutex* mutex);
+void wakeAllConditionVariable(ConditionVariable* condition);
+
+
+// Counter that threads update without a lock
+typedef struct {
+    volatile int64_t value;
+} AtomicCounter;
+
+
+void addAtomicCounter(AtomicCounter* counter, int64_t n);
+void storeAtomicCounter(AtomicCounter* counter, int64_t value);
+int64_t loadAtomicCounter(AtomicCounter* counter);
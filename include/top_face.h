@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <cglm/cglm.h>
+
+#include "polyhedron.h"
+
+
+/*
+* Top face detection for arbitrary orientations. Showing direction (+Z, towards the camera) is brought
+* into model space and compared with face normals of the dice type: the face with the largest dot
+* product is on top, no trigonometry. Batches run one die per SIMD lane with the widest kernel the
+* CPU supports and give the same faces as the single die search. Requires initDiceMeshes()
+*/
+
+// Index of top face of a die, orientation does not have to be normalized
+size_t getDiceTopFace(DiceType type, const versor orientation);
+// Value shown on top of a die
+int getDiceTopValue(DiceType type, const versor orientation);
+
+// Top faces and values of n dice, either output may be NULL
+void getDiceTopFaces(const DiceType* types, versor* orientations, size_t n, uint8_t* faces, int* values);
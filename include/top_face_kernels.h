@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "polyhedron.h"
+
+
+/*
+* Kernel tables of top face detection, one per instruction set. Kernels find top faces of a multiple
+* of width dice, each lane taking a die and reading face normals of its type. Tables of instruction
+* sets not enabled for their translation unit have width 0. Every kernel does the same operations in
+* the same order as getDiceTopFace(), so all give the same faces.
+*/
+
+typedef struct {
+    size_t width;
+    // Orientations are x, y, z, w of each die one after another
+    void (*findTopFaces)(const DiceType* types, const float* orientations, size_t n, uint8_t* faces);
+} TopFaceKernels;
+
+
+// Built into top_face.c: SSE2 where the build targets it, width 0 otherwise
+extern const TopFaceKernels TOP_FACE_KERNELS_BASELINE;
+extern const TopFaceKernels TOP_FACE_KERNELS_AVX2;
+extern const TopFaceKernels TOP_FACE_KERNELS_AVX512;
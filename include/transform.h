@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <cglm/cglm.h>
+
+#include "dice_world.h"
+
+
+/*
+* Camera, light and dice transforms of the scene. Camera and light inputs are set every frame, but their
+* derived matrices are recomputed only after an input changed. Model and normal matrices of dice are built
+* in closed form: a die is a rotation R with uniform scale s, so under a rigid camera its normal matrix is
+* view * R / s and needs no inverse. Batches of dice are transformed several at a time with SIMD.
+*/
+
+// Instance data layout shared with vertex shader (std430)
+typedef struct {
+    mat4 model;
+    mat4 normal_matrix;  // upper 3x3 is normal matrix of view * model
+} DiceInstance;
+
+
+enum {
+    CAMERA_DIRTY_VIEW = 1 << 0,
+    CAMERA_DIRTY_PROJECTION = 1 << 1,
+    CAMERA_DIRTY_LIGHT = 1 << 2
+};
+
+
+typedef struct {
+    // Inputs
+    vec3 position;
+    float fov_deg;
+    float near_z;
+    float far_z;
+    float aspect_ratio;
+    vec3 light_direction;  // world space, any length
+
+    // Derived from inputs
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec3 view_light_direction;  // unit length, view space
+    unsigned dirty;  // CAMERA_DIRTY_* flags of derived state to recompute
+} CameraTransform;
+
+
+void initCameraTransform(CameraTransform* camera);
+
+// Setters mark derived state dirty only when the value changes
+void setCameraPosition(CameraTransform* camera, vec3 position);
+void setCameraLens(CameraTransform* camera, float fov_deg, float near_z, float far_z);
+// A minimized window has no size, the last aspect ratio is kept then
+void setCameraViewport(CameraTransform* camera, int width, int height);
+void setCameraLightDirection(CameraTransform* camera, vec3 direction);
+// Recompute derived state marked dirty
+void updateCameraTransform(CameraTransform* camera);
+
+// Normalized light direction in view space
+void computeViewLightDirection(mat4 view, vec3 direction, vec3 out_direction);
+// Upper 3x3 of normal matrix of view * model, for model made of rotation and uniform scale and rigid view
+void computeNormalMatrix(mat4 view, mat4 model, float scale, mat4 normal_matrix);
+
+// Model and normal matrices of dice seen by rigid view, instance k is written for die dice[k]
+void computeDiceInstances(mat4 view, const DiceWorld* world, const uint32_t* dice, size_t n,
+                          DiceInstance* instances);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+
+
+/*
+* RGBA to planar YUV 4:2:0 conversion for video output. Uses BT.601 limited range coefficients in 8-bit
+* fixed point, chroma is the average of each 2x2 pixel block. SIMD kernels give the same bytes as the
+* scalar code.
+*/
+
+// Convert RGBA frame, rows bottom to top when is_bottom_up, into Y, U and V planes with rows top to bottom.
+// Chroma planes are (width + 1) / 2 by (height + 1) / 2, odd edges repeat the last row or column
+void convertRgbaToYuv420(const unsigned char* rgba, int width, int height, bool is_bottom_up,
+                         unsigned char* y_plane, unsigned char* u_plane, unsigned char* v_plane);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+
+
+/*
+* Kernel tables of RGBA to YUV 4:2:0 conversion, one per instruction set. Kernels convert blocks of
+* width pixels of a row pair and leave the rest of the row to scalar code. Tables of instruction sets
+* not enabled for their translation unit have width 0. All kernels give the same bytes as the scalar code.
+*/
+
+typedef struct {
+    size_t width;
+    // Second luma row is NULL for the last row of odd height, returns column where scalar conversion continues
+    int (*convertRowPair)(const unsigned char* row0, const unsigned char* row1, int width,
+                          unsigned char* luma0, unsigned char* luma1, unsigned char* u, unsigned char* v);
+} YuvKernels;
+
+
+// Built into yuv.c: SSE2 where the build targets it, width 0 otherwise
+extern const YuvKernels YUV_KERNELS_BASELINE;
+extern const YuvKernels YUV_KERNELS_AVX2;
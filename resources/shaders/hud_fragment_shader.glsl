@@ -0,0 +1,20 @@
+#version 450
+
+in vec2 fTexCoords;
+in vec4 fColor;
+
+uniform sampler2D text;
+
+out vec4 diffuseColor;
+
+void main() {
+	// Panels and graph bars have negative texture coordinates and are filled solid,
+	// glyphs are distance fields like in the text shader
+	float alpha = 1.0;
+	if (fTexCoords.x >= 0.0) {
+		float distance = texture(text, fTexCoords).r;
+		float width = fwidth(distance);
+		alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+	}
+	diffuseColor = vec4(fColor.rgb, fColor.a * alpha);
+}
@@ -0,0 +1,15 @@
+#version 450
+
+layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+layout (location = 1) in vec4 color;
+
+uniform mat4 projection;
+
+out vec2 fTexCoords;
+out vec4 fColor;
+
+void main() {
+	gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+	fTexCoords = vertex.zw;
+	fColor = color;
+}
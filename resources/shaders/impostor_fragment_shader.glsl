@@ -0,0 +1,19 @@
+#version 450
+
+in vec2 fImageCoord;
+flat in vec3 fCell;
+
+uniform sampler2DArray atlas;
+uniform float gridSize;
+
+out vec4 diffuseColor;
+
+void main() {
+	// Corners of rotated quad fall outside the cell, die silhouette never reaches them
+	vec2 cellCoord = clamp(fImageCoord * 0.5 + 0.5, 0.0, 1.0);
+	vec4 color = texture(atlas, vec3((fCell.xy + cellCoord) / gridSize, fCell.z));
+	if (color.a < 0.5) {
+		discard;
+	}
+	diffuseColor = vec4(color.rgb, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 450
+
+struct ImpostorInstance {
+	vec4 centerRadius;  // view space center, bounding radius
+	vec4 cellUp;  // atlas cell, screen up in cell image
+	float layer;  // dice type
+};
+
+layout (std430, binding = 1) readonly buffer ImpostorInstances {
+	ImpostorInstance instances[];
+};
+
+uniform mat4 projection;
+
+out vec2 fImageCoord;  // [-1, 1] covers the cell image
+flat out vec3 fCell;  // cell and atlas layer
+
+void main() {
+	ImpostorInstance instance = instances[gl_InstanceID];
+
+	// Camera-facing quad drawn as triangle strip
+	vec2 corner = vec2((gl_VertexID & 1) * 2 - 1, (gl_VertexID >> 1) * 2 - 1);
+
+	// Rotate image so that captured orientation matches die roll on screen
+	vec2 up = instance.cellUp.zw;
+	vec2 right = vec2(up.y, -up.x);
+	fImageCoord = corner.x * right + corner.y * up;
+	fCell = vec3(instance.cellUp.xy, instance.layer);
+
+	vec3 position = instance.centerRadius.xyz + vec3(corner, 0.0) * instance.centerRadius.w;
+	gl_Position = projection * vec4(position, 1.0);
+}
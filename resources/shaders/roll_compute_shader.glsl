@@ -0,0 +1,174 @@
+#version 450
+
+// Evaluates orientation of every drawn die for current time and writes its matrices
+// into instance buffer. Mirrors updateDiceOrientations() on CPU
+
+layout (local_size_x = 64) in;
+
+struct DiceInstance {
+	mat4 model;
+	mat4 normalMatrix;
+};
+
+struct DiceRecord {
+	vec4 positionScale;
+	float eventTime;  // world time of creation or roll start
+	float idleAngle;  // degrees, at event time
+	uint isRolling;
+	uint padding;
+};
+
+layout (std430, binding = 0) writeonly buffer DiceInstances {
+	DiceInstance instances[];
+};
+
+// Indexed by slot
+layout (std430, binding = 3) readonly buffer DiceRecords {
+	DiceRecord records[];
+};
+
+// Per slot: orientation at roll start followed by roll keyframes
+layout (std430, binding = 4) readonly buffer RollKeyframes {
+	vec4 keyframes[];
+};
+
+// Slot of die drawn by every instance
+layout (std430, binding = 5) readonly buffer DrawSlots {
+	uint drawSlots[];
+};
+
+uniform uint instanceCount;
+uniform float time;
+uniform mat4 view;
+
+uniform float idleSpeed;  // deg/sec
+uniform uint keyframeCount;  // keyframes per roll, without start orientation
+uniform float maxSpeed;  // keyframes/sec
+uniform float minSpeed;
+uniform float deceleration;
+uniform float decelerationStart;  // keyframe position
+uniform uint interpolation;  // QuatInterpolation: 0 slerp, 1 nlerp, 2 fast slerp
+
+
+vec4 quatFromAxisAngle(float angle, vec3 axis) {
+	return vec4(axis * sin(0.5 * angle), cos(0.5 * angle));
+}
+
+
+vec4 quatMul(vec4 p, vec4 q) {
+	return vec4(p.w * q.xyz + q.w * p.xyz + cross(p.xyz, q.xyz), p.w * q.w - dot(p.xyz, q.xyz));
+}
+
+
+// Same as slerpQuats(): shorter arc, linear weights when too close to divide by sine of angle
+vec4 quatSlerp(vec4 from, vec4 to, float t) {
+	float cosTheta = dot(from, to);
+	float s = cosTheta < 0.0 ? -1.0 : 1.0;
+	cosTheta = min(cosTheta * s, 1.0);
+	float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+	float wFrom = 1.0 - t;
+	float wTo = t;
+	if (sinTheta >= 0.001) {
+		float angle = acos(cosTheta);
+		wFrom = sin(wFrom * angle) / sinTheta;
+		wTo = sin(wTo * angle) / sinTheta;
+	}
+	vec4 q = from * (wFrom * s) + to * wTo;
+	float len = length(q);
+	return len > 0.0 ? q / len : vec4(0.0, 0.0, 0.0, 1.0);
+}
+
+
+// Same as nlerpQuats() and fastSlerpQuats(): shorter arc, weight corrected by polynomial for fast slerp
+vec4 quatNlerp(vec4 from, vec4 to, float t, bool isCorrected) {
+	float cosTheta = dot(from, to);
+	float s = cosTheta < 0.0 ? -1.0 : 1.0;
+	if (isCorrected) {
+		float d = cosTheta * s;
+		float a = 1.0904 + d * (-3.2452 + d * (3.55645 - d * 1.43519));
+		float b = 0.848013 + d * (-1.06021 + d * 0.215638);
+		float h = t - 0.5;
+		t += t * h * (t - 1.0) * (a * h * h + b);
+	}
+	vec4 q = from * ((1.0 - t) * s) + to * t;
+	float len = length(q);
+	return len > 0.0 ? q / len : vec4(0.0, 0.0, 0.0, 1.0);
+}
+
+
+vec4 interpolateQuat(vec4 from, vec4 to, float t) {
+	if (interpolation == 0u) {
+		return quatSlerp(from, to, t);
+	}
+	return quatNlerp(from, to, t, interpolation == 2u);
+}
+
+
+mat3 quatToMat3(vec4 q) {
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	return mat3(
+		1.0 - 2.0 * (yy + zz), 2.0 * (xy + wz), 2.0 * (xz - wy),
+		2.0 * (xy - wz), 1.0 - 2.0 * (xx + zz), 2.0 * (yz + wx),
+		2.0 * (xz + wy), 2.0 * (yz - wx), 1.0 - 2.0 * (xx + yy)
+	);
+}
+
+
+vec4 getIdleRotation(float angleDeg) {
+	float angle = radians(angleDeg);
+	vec4 q1 = quatFromAxisAngle(angle, vec3(0.0, 1.0, 0.0));
+	vec4 q2 = quatFromAxisAngle(angle * 1.5, vec3(0.0, 0.0, 1.0));
+	vec4 q3 = quatFromAxisAngle(angle * 1.75, vec3(1.0, 0.0, 0.0));
+	return quatMul(q1, quatMul(q2, q3));
+}
+
+
+// Closed form of roll speed profile, see getRollAnimationPosition()
+float getRollPosition(float timeElapsed) {
+	float tStart = decelerationStart / maxSpeed;
+	if (timeElapsed <= tStart) {
+		return maxSpeed * timeElapsed;
+	}
+	float t = timeElapsed - tStart;
+	float tDecelerate = deceleration > 0.0 ? (maxSpeed - minSpeed) / deceleration : 0.0;
+	if (t <= tDecelerate) {
+		return decelerationStart + t * (maxSpeed - 0.5 * deceleration * t);
+	}
+	return decelerationStart + 0.5 * (maxSpeed + minSpeed) * tDecelerate + minSpeed * (t - tDecelerate);
+}
+
+
+vec4 getRollRotation(uint slot, float timeElapsed) {
+	uint first = slot * (keyframeCount + 1);
+	float position = getRollPosition(timeElapsed);
+	if (position >= float(keyframeCount)) {
+		return keyframes[first + keyframeCount];
+	}
+	uint n = uint(position);
+	return interpolateQuat(keyframes[first + n], keyframes[first + n + 1], position - float(n));
+}
+
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= instanceCount) {
+		return;
+	}
+
+	uint slot = drawSlots[i];
+	DiceRecord record = records[slot];
+	float timeElapsed = time - record.eventTime;
+	vec4 q = record.isRolling != 0
+		? getRollRotation(slot, timeElapsed)
+		: getIdleRotation(record.idleAngle + idleSpeed * timeElapsed);
+
+	mat3 rotation = quatToMat3(q);
+	float scale = record.positionScale.w;
+	mat4 model = mat4(rotation * scale);
+	model[3] = vec4(record.positionScale.xyz, 1.0);
+	instances[i].model = model;
+	// Inverse transpose of rotation with uniform scale under rigid view
+	instances[i].normalMatrix = mat4(mat3(view) * rotation / scale);
+}
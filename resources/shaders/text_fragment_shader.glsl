@@ -9,6 +9,9 @@ out vec4 diffuseColor;
 
 void main()
 {    
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    diffuseColor = vec4(textColor, 1.0) * sampled;
-} 
\ No newline at end of file
+    // Glyph outline is at distance 0.5, smooth edge over about one screen pixel
+    float distance = texture(text, TexCoords).r;
+    float width = fwidth(distance);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    diffuseColor = vec4(textColor, alpha);
+}
@@ -1,14 +1,27 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : enable
 
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec3 vColor;
 layout (location = 2) in vec3 vNormal;
 layout (location = 3) in vec2 vTextureCoord;
 
-uniform mat4 model;
-uniform mat3 normalMatrix;
+struct DiceInstance {
+	mat4 model;
+	mat4 normalMatrix;  // upper 3x3 is used
+};
+
+// Per-die transforms, grouped by dice type
+layout (std430, binding = 0) readonly buffer DiceInstances {
+	DiceInstance instances[];
+};
+
 uniform mat4 view;
 uniform mat4 projection;
+#ifndef GL_ARB_shader_draw_parameters
+// First instance of the draw, types are then drawn one by one
+uniform int instanceOffset;
+#endif
 
 out vec3 fColor;
 out vec3 vNormalModelView;
@@ -16,6 +29,14 @@ out vec3 fPos;
 out vec2 fTextureCoord;
 
 void main() {
+#ifdef GL_ARB_shader_draw_parameters
+	// Base instance of each command of the multi-draw
+	DiceInstance instance = instances[gl_BaseInstanceARB + gl_InstanceID];
+#else
+	DiceInstance instance = instances[instanceOffset + gl_InstanceID];
+#endif
+	mat4 model = instance.model;
+	mat3 normalMatrix = mat3(instance.normalMatrix);
 	vNormalModelView = normalize(normalMatrix * vNormal);
 
 	// Calculate position for fragment shader in after Model->View transformation
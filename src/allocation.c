@@ -0,0 +1,30 @@
+#include <stdlib.h>
+
+#include "allocation.h"
+#include "thread.h"
+
+
+static AtomicCounter g_n_allocations = { 0 };
+
+
+void* allocateMemory(size_t size) {
+    addAtomicCounter(&g_n_allocations, 1);
+    return malloc(size);
+}
+
+
+void* allocateZeroedMemory(size_t count, size_t size) {
+    addAtomicCounter(&g_n_allocations, 1);
+    return calloc(count, size);
+}
+
+
+void* reallocateMemory(void* memory, size_t size) {
+    addAtomicCounter(&g_n_allocations, 1);
+    return realloc(memory, size);
+}
+
+
+uint64_t getAllocationCount(void) {
+    return (uint64_t)loadAtomicCounter(&g_n_allocations);
+}
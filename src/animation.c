@@ -1,28 +1,27 @@
 #include <glad/gl.h>
 
 #include "animation.h"
-#include "icosahedron.h"
+#include "allocation.h"
+#include "polyhedron.h"
+#include "quat_batch.h"
 
 
-void getDiceRollQuaternion(int dice_value, versor q_out) {
-    int face_idx = getIcosahedronFaceIndex(dice_value);
-
-    size_t face_vertex_idx = face_idx * 3;
-    size_t orientation_vertex_idx = face_vertex_idx + getOrientationVertexIndex(face_idx);
+void getDiceRollQuaternion(DiceType type, int dice_value, versor q_out) {
+    const DiceMesh* mesh = &gDiceMeshes[type];
+    size_t face_idx = getDiceFaceIndex(type, dice_value);
 
     // Rotate face to positive Z direction
     vec3 positive_z_vec = { 0.0f, 0.0f, 1.0f };
-    Vertex first_vertex = gIcosahedronMesh[face_vertex_idx];
-    vec3 face_normal = { first_vertex.n[0], first_vertex.n[1], first_vertex.n[2] };
+    vec3 face_normal;
+    glm_vec3_copy((float*)mesh->face_normal[face_idx], face_normal);
 
     versor q_rot;
     glm_quat_from_vecs(face_normal, positive_z_vec, q_rot);
 
-    // Correct orientation
+    // Correct orientation so that top of the number faces positive Y
     vec3 positive_y_vec = { 0.0f, 1.0f, 0.0f };
-    Vertex orientation_vertex = gIcosahedronMesh[orientation_vertex_idx];
-    vec3 orient_vec = { orientation_vertex.x, orientation_vertex.y, orientation_vertex.z };
-    glm_quat_rotatev(q_rot, orient_vec, orient_vec);
+    vec3 orient_vec;
+    glm_quat_rotatev(q_rot, (float*)mesh->face_up[face_idx], orient_vec);
     orient_vec[2] = 0.0f;
     GLfloat orientation_angle = glm_vec3_angle(orient_vec, positive_y_vec);
     if (orient_vec[0] < 0.0f) {
@@ -38,26 +37,10 @@ void getDiceRollQuaternion(int dice_value, versor q_out) {
 }
 
 
-void getRandomRollQuaternion(versor q_out) {
-    q_out[0] = (float)rand() / (float)rand();
-    q_out[1] = (float)rand() / (float)rand();
-    q_out[2] = (float)rand() / (float)rand();
-    q_out[3] = 0.0f;
-    glm_quat_normalize(q_out);
-}
-
-
-void getIdleAnimationQuaternion(float time_delta, float rot_speed_deg, versor q_out) {
-    static float rot_angle_deg = 0.0f;
-    rot_angle_deg += rot_speed_deg * time_delta;
-
-    versor q1, q2, q3;
-    glm_quatv(q1, glm_rad(rot_angle_deg), (vec3) { 0.0f, 1.0f, 0.0f });
-    glm_quatv(q2, glm_rad(rot_angle_deg * 1.5), (vec3) { 0.0f, 0.0f, 1.0f });
-    glm_quatv(q3, glm_rad(rot_angle_deg * 1.75), (vec3) { 1.0f, 0.0f, 0.0f });
-
-    glm_quat_mul(q2, q3, q2);
-    glm_quat_mul(q1, q2, q_out);
+void getIdleRotationFactors(float rot_angle_deg, versor q_out[3]) {
+    glm_quatv(q_out[0], glm_rad(rot_angle_deg), (vec3) { 0.0f, 1.0f, 0.0f });
+    glm_quatv(q_out[1], glm_rad(rot_angle_deg * 1.5), (vec3) { 0.0f, 0.0f, 1.0f });
+    glm_quatv(q_out[2], glm_rad(rot_angle_deg * 1.75), (vec3) { 1.0f, 0.0f, 0.0f });
 }
 
 
@@ -67,16 +50,15 @@ float getRollAngleDeltaRad(const AnimationSettings* settings_ptr) {
 
 
 void resetRollAnimationState(RollAnimationState* state_ptr) {
-    state_ptr->cur_n = 0;
     state_ptr->t = 0.0;
-    glm_quatv(state_ptr->q_prev, 0.0f, (vec3) { 0.0f, 1.0f, 0.0f });
+    glm_quatv(state_ptr->q_start, 0.0f, (vec3) { 0.0f, 1.0f, 0.0f });
     state_ptr->hasFinished = false;
 }
 
 
 RollAnimationState initRollAnimationState(size_t roll_points_num) {
     RollAnimationState state;    
-    state.q_arr = malloc(sizeof(versor) * roll_points_num);
+    state.q_arr = allocateMemory(sizeof(versor) * roll_points_num);
     resetRollAnimationState(&state);
     return state;
 }
@@ -88,66 +70,118 @@ void deleteRollAnimationState(RollAnimationState* state_ptr) {
 
 
 void fillRollAnimationQueue(RollAnimationState* state_ptr, versor initial_rot_quat,
-                            const AnimationSettings* anim_settings_ptr, size_t dice_value) {
+                            const AnimationSettings* anim_settings_ptr, DiceType type, size_t dice_value) {
     resetRollAnimationState(state_ptr);
-    glm_quat_copy(initial_rot_quat, state_ptr->q_prev);
+    glm_quat_copy(initial_rot_quat, state_ptr->q_start);
 
     const size_t n_rotations = anim_settings_ptr->n_rotations;
     const size_t n_points = anim_settings_ptr->n_points;
     const float roll_angle_delta_rad = getRollAngleDeltaRad(anim_settings_ptr);
 
-    getDiceRollQuaternion(dice_value, state_ptr->q_arr[n_points - 1]);
+    getDiceRollQuaternion(type, dice_value, state_ptr->q_arr[n_points - 1]);
+
+    // Path from start to final orientation is interpolated in batches
+    float from[4][QUAT_BATCH_CHUNK], to[4][QUAT_BATCH_CHUNK], t[QUAT_BATCH_CHUNK], path[4][QUAT_BATCH_CHUNK];
+    for (size_t k = 0; k < QUAT_BATCH_CHUNK; ++k) {
+        for (int c = 0; c < 4; ++c) {
+            from[c][k] = state_ptr->q_start[c];
+            to[c][k] = state_ptr->q_arr[n_points - 1][c];
+        }
+    }
+    QuatArrays from_arrays = { from[0], from[1], from[2], from[3] };
+    QuatArrays to_arrays = { to[0], to[1], to[2], to[3] };
+    QuatArrays path_arrays = { path[0], path[1], path[2], path[3] };
 
-    versor q;
     vec3 axis;
     float angle, added_angle = 0.0f;
 
-    for (size_t n = 0; n < n_points - 1; ++n) {
-        float t = (float)n / (n_points - 1);
-        glm_quat_slerp(state_ptr->q_prev, state_ptr->q_arr[n_points - 1], t, q);
+    for (size_t first = 0; first < n_points - 1; first += QUAT_BATCH_CHUNK) {
+        size_t n_chunk = n_points - 1 - first < QUAT_BATCH_CHUNK ? n_points - 1 - first : QUAT_BATCH_CHUNK;
+        for (size_t k = 0; k < n_chunk; ++k) {
+            t[k] = (float)(first + k) / (n_points - 1);
+        }
+        interpolateQuats(anim_settings_ptr->interpolation, from_arrays, to_arrays, t, path_arrays, n_chunk);
 
-        added_angle += roll_angle_delta_rad;
+        for (size_t k = 0; k < n_chunk; ++k) {
+            versor q = { path[0][k], path[1][k], path[2][k], path[3][k] };
+            added_angle += roll_angle_delta_rad;
 
-        angle = glm_quat_angle(q) + added_angle;
-        glm_quat_axis(q, axis);
+            angle = glm_quat_angle(q) + added_angle;
+            glm_quat_axis(q, axis);
 
-        glm_quatv(state_ptr->q_arr[n], angle, axis);
+            glm_quatv(state_ptr->q_arr[first + k], angle, axis);
+        }
     }
 }
 
 
-void getRollAnimationQuaternion(float time_delta, const AnimationSettings* settings_ptr,
-    RollAnimationState* state_ptr, versor q_out) {
-    const size_t n_points = settings_ptr->n_points;
+RollSpeedProfile getRollSpeedProfile(const AnimationSettings* settings_ptr) {
     const float roll_angle_delta_rad = getRollAngleDeltaRad(settings_ptr);
 
-    // Determine speed
-    if (state_ptr->cur_n <= n_points / 2) {
-        state_ptr->cur_speed_rad_per_sec = glm_rad(settings_ptr->max_rot_speed);
-    } else {
-        state_ptr->cur_speed_rad_per_sec = glm_max(
-            glm_rad(settings_ptr->min_rot_speed),
-            state_ptr->cur_speed_rad_per_sec - glm_rad(settings_ptr->deaceleration) * time_delta
-        );
+    RollSpeedProfile profile;
+    profile.max_speed = glm_rad(settings_ptr->max_rot_speed) / roll_angle_delta_rad;
+    profile.deceleration = glm_rad(settings_ptr->deaceleration) / roll_angle_delta_rad;
+    profile.min_speed = profile.deceleration > 0.0f
+        ? glm_min(glm_rad(settings_ptr->min_rot_speed) / roll_angle_delta_rad, profile.max_speed)
+        : profile.max_speed;
+    profile.deceleration_start = settings_ptr->n_points / 2 + 1;
+    return profile;
+}
+
+
+float getRollAnimationPosition(const RollSpeedProfile* profile, float time_elapsed) {
+    // Constant speed up to the middle
+    float t_start = profile->deceleration_start / profile->max_speed;
+    if (time_elapsed <= t_start) {
+        return profile->max_speed * time_elapsed;
     }
 
+    // Then decelerate until minimum speed is reached
+    float t = time_elapsed - t_start;
+    float t_decelerate = profile->deceleration > 0.0f
+        ? (profile->max_speed - profile->min_speed) / profile->deceleration
+        : 0.0f;
+    if (t <= t_decelerate) {
+        return profile->deceleration_start + t * (profile->max_speed - 0.5f * profile->deceleration * t);
+    }
+    return profile->deceleration_start + 0.5f * (profile->max_speed + profile->min_speed) * t_decelerate
+        + profile->min_speed * (t - t_decelerate);
+}
+
+
+bool getRollAnimationKeyframes(const AnimationSettings* settings_ptr, RollAnimationState* state_ptr,
+                               float** q_from, float** q_to, float* weight) {
+    const size_t n_points = settings_ptr->n_points;
+    RollSpeedProfile profile = getRollSpeedProfile(settings_ptr);
+    float position = getRollAnimationPosition(&profile, state_ptr->t);
+
     // Perform n rotations before moving to final position
-    if (state_ptr->cur_n < n_points) {
-        // ROLL_ANGLE_DELTA_RAD - rotaion angle per one position
-        state_ptr->t += time_delta * state_ptr->cur_speed_rad_per_sec / roll_angle_delta_rad;
-
-        // Interpolate frame rotation from previous position to desired position
-        glm_quat_slerp(state_ptr->q_prev, state_ptr->q_arr[state_ptr->cur_n],
-                       glm_min(state_ptr->t, 1.0), q_out);
-
-        if (state_ptr->t >= 1.0) {
-            state_ptr->cur_n += 1;
-            state_ptr->t = 0.0f;
-            glm_quat_copy(q_out, state_ptr->q_prev);
-        }
-        state_ptr->hasFinished = false;
+    if (position >= n_points) {
+        return false;
+    }
+    // Keyframes around current position
+    size_t n = (size_t)position;
+    *q_from = n == 0 ? state_ptr->q_start : state_ptr->q_arr[n - 1];
+    *q_to = state_ptr->q_arr[n];
+    *weight = position - n;
+    return true;
+}
+
+
+bool advanceRollAnimation(float time_delta, const AnimationSettings* settings_ptr, RollAnimationState* state_ptr,
+                          float** q_from, float** q_to, float* weight) {
+    state_ptr->t += time_delta;
+    state_ptr->hasFinished = !getRollAnimationKeyframes(settings_ptr, state_ptr, q_from, q_to, weight);
+    return !state_ptr->hasFinished;
+}
+
+
+void getRollAnimationQuaternion(float time_delta, const AnimationSettings* settings_ptr,
+    RollAnimationState* state_ptr, versor q_out) {
+    float *q_from, *q_to, weight;
+    if (advanceRollAnimation(time_delta, settings_ptr, state_ptr, &q_from, &q_to, &weight)) {
+        interpolateQuat(settings_ptr->interpolation, q_from, q_to, weight, q_out);
     } else {
-        glm_quat_copy(state_ptr->q_arr[state_ptr->cur_n - 1], q_out);
-        state_ptr->hasFinished = true;
+        glm_quat_copy(state_ptr->q_arr[settings_ptr->n_points - 1], q_out);
     }
-}
\ No newline at end of file
+}
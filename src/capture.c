@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "capture.h"
+#include "allocation.h"
+#include "png_write.h"
+#include "yuv.h"
+
+
+enum {
+    N_OUTPUT_CHANNELS = 3,
+    MAX_PATH_LENGTH = 512
+};
+
+static const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+static FILE* g_stdout_video = NULL;  // original stdout once reserved for video
+
+
+/* Writer thread */
+
+// RGBA rows bottom to top -> RGB rows top to bottom
+static void convertFrame(const FrameCapture* capture, const unsigned char* src, unsigned char* dst) {
+    for (int y = 0; y < capture->height; ++y) {
+        const unsigned char* src_row = src + (size_t)(capture->height - 1 - y) * capture->width * 4;
+        unsigned char* dst_row = dst + (size_t)y * capture->width * N_OUTPUT_CHANNELS;
+        for (int x = 0; x < capture->width; ++x) {
+            dst_row[x * 3 + 0] = src_row[x * 4 + 0];
+            dst_row[x * 3 + 1] = src_row[x * 4 + 1];
+            dst_row[x * 3 + 2] = src_row[x * 4 + 2];
+        }
+    }
+}
+
+
+static Status writeFrame(FrameCapture* capture, const unsigned char* frame) {
+    if (capture->format == CAPTURE_Y4M_VIDEO) {
+        size_t luma_size = (size_t)capture->width * capture->height;
+        size_t chroma_size = (size_t)((capture->width + 1) / 2) * ((capture->height + 1) / 2);
+        unsigned char* y_plane = capture->output_pixels;
+        convertRgbaToYuv420(frame, capture->width, capture->height, true, y_plane, y_plane + luma_size,
+                            y_plane + luma_size + chroma_size);
+        if (fputs("FRAME\n", capture->video_file) == EOF) {
+            return STATUS_ERR;
+        }
+        return fwrite(y_plane, luma_size + 2 * chroma_size, 1, capture->video_file) == 1 ? STATUS_OK : STATUS_ERR;
+    }
+
+    convertFrame(capture, frame, capture->output_pixels);
+    if (capture->format == CAPTURE_RAW_VIDEO) {
+        size_t size = (size_t)capture->width * capture->height * N_OUTPUT_CHANNELS;
+        return fwrite(capture->output_pixels, size, 1, capture->video_file) == 1 ? STATUS_OK : STATUS_ERR;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/frame_%06llu.png", capture->path, (unsigned long long)capture->n_written);
+    return writePng(path, capture->output_pixels, capture->width, capture->height, N_OUTPUT_CHANNELS);
+}
+
+
+static void runWriter(void* arg) {
+    FrameCapture* capture = arg;
+    lockMutex(&capture->mutex);
+    while (true) {
+        while (capture->n_queued == 0 && !capture->is_finishing) {
+            waitConditionVariable(&capture->condition, &capture->mutex);
+        }
+        if (capture->n_queued == 0) {
+            break;
+        }
+
+        // Queued frame is not touched by render thread until it is released below
+        const unsigned char* frame = capture->queue_pixels + capture->queue_first * capture->frame_size;
+        unlockMutex(&capture->mutex);
+        // Frames are still consumed after an error, so rendering never blocks on a broken writer
+        if (!capture->has_write_error && writeFrame(capture, frame) != STATUS_OK) {
+            printf("Unable to write captured frame to %s, capture stopped\n", capture->path);
+            capture->has_write_error = true;
+        }
+        capture->n_written++;
+        lockMutex(&capture->mutex);
+
+        capture->queue_first = (capture->queue_first + 1) % CAPTURE_QUEUE_SIZE;
+        capture->n_queued--;
+        wakeAllConditionVariable(&capture->condition);
+    }
+    unlockMutex(&capture->mutex);
+}
+
+
+// Copy frame into writer queue, waits while the queue is full
+static void queueFrame(FrameCapture* capture, const void* pixels) {
+    lockMutex(&capture->mutex);
+    while (capture->n_queued == CAPTURE_QUEUE_SIZE) {
+        waitConditionVariable(&capture->condition, &capture->mutex);
+    }
+    size_t slot = (capture->queue_first + capture->n_queued) % CAPTURE_QUEUE_SIZE;
+    unlockMutex(&capture->mutex);
+
+    memcpy(capture->queue_pixels + slot * capture->frame_size, pixels, capture->frame_size);
+
+    lockMutex(&capture->mutex);
+    capture->n_queued++;
+    wakeAllConditionVariable(&capture->condition);
+    unlockMutex(&capture->mutex);
+}
+
+
+/* Readback */
+
+// Pass oldest readback in flight to writer. Without wait only if its fence has already signaled
+static bool collectFrame(FrameCapture* capture, bool wait) {
+    size_t slot = capture->ring_first;
+    GLenum result;
+    do {
+        result = glClientWaitSync(capture->fences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                  wait ? FENCE_TIMEOUT_NS : 0);
+    } while (wait && result == GL_TIMEOUT_EXPIRED);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(capture->fences[slot]);
+    capture->fences[slot] = NULL;
+
+    const void* pixels = glMapNamedBufferRange(capture->pixel_buffers[slot], 0, capture->frame_size,
+                                               GL_MAP_READ_BIT);
+    if (pixels) {
+        queueFrame(capture, pixels);
+        capture->n_captured++;
+    }
+    glUnmapNamedBuffer(capture->pixel_buffers[slot]);
+
+    capture->ring_first = (capture->ring_first + 1) % CAPTURE_RING_SIZE;
+    capture->n_in_flight--;
+    return true;
+}
+
+
+static Status initRenderTarget(FrameCapture* capture) {
+    glCreateRenderbuffers(1, &capture->color_buffer);
+    glNamedRenderbufferStorage(capture->color_buffer, GL_RGBA8, capture->width, capture->height);
+    glCreateRenderbuffers(1, &capture->depth_buffer);
+    glNamedRenderbufferStorage(capture->depth_buffer, GL_DEPTH_COMPONENT24, capture->width, capture->height);
+
+    glCreateFramebuffers(1, &capture->framebuffer);
+    glNamedFramebufferRenderbuffer(capture->framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                   capture->color_buffer);
+    glNamedFramebufferRenderbuffer(capture->framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                   capture->depth_buffer);
+    if (glCheckNamedFramebufferStatus(capture->framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        puts("Capture framebuffer is incomplete");
+        return STATUS_ERR;
+    }
+
+    // Client storage hint keeps buffers in memory that is fast to map for reading
+    glCreateBuffers(CAPTURE_RING_SIZE, capture->pixel_buffers);
+    for (size_t i = 0; i < CAPTURE_RING_SIZE; ++i) {
+        glNamedBufferStorage(capture->pixel_buffers[i], capture->frame_size, NULL,
+                             GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+    }
+    return STATUS_OK;
+}
+
+
+static void freeRenderTarget(FrameCapture* capture) {
+    glDeleteBuffers(CAPTURE_RING_SIZE, capture->pixel_buffers);
+    glDeleteFramebuffers(1, &capture->framebuffer);
+    glDeleteRenderbuffers(1, &capture->color_buffer);
+    glDeleteRenderbuffers(1, &capture->depth_buffer);
+}
+
+
+void reserveStdoutForCapture(void) {
+    if (g_stdout_video) {
+        return;
+    }
+    fflush(stdout);
+#ifdef _WIN32
+    int video_fd = _dup(_fileno(stdout));
+    _setmode(video_fd, _O_BINARY);
+    _dup2(_fileno(stderr), _fileno(stdout));
+    g_stdout_video = video_fd >= 0 ? _fdopen(video_fd, "wb") : NULL;
+#else
+    int video_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    g_stdout_video = video_fd >= 0 ? fdopen(video_fd, "wb") : NULL;
+#endif
+}
+
+
+static Status openVideoFile(FrameCapture* capture) {
+    if (strcmp(capture->path, CAPTURE_STDOUT_PATH) == 0) {
+        reserveStdoutForCapture();
+        capture->video_file = g_stdout_video;
+    } else {
+        capture->video_file = fopen(capture->path, "wb");
+    }
+    if (!capture->video_file) {
+        printf("Unable to create capture file %s\n", capture->path);
+        return STATUS_ERR;
+    }
+
+    // Limited range BT.601 with chroma centered between 2x2 pixels, as written by convertRgbaToYuv420
+    if (capture->format == CAPTURE_Y4M_VIDEO
+        && fprintf(capture->video_file, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+                   capture->width, capture->height, capture->fps) < 0) {
+        printf("Unable to write capture file %s\n", capture->path);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+Status initFrameCapture(FrameCapture* capture, const char* path, CaptureFormat format, int width, int height,
+                        unsigned fps) {
+    *capture = (FrameCapture) { .path = path, .format = format, .width = width, .height = height, .fps = fps };
+    capture->frame_size = (size_t)width * height * 4;
+
+    if (format != CAPTURE_PNG_SEQUENCE && openVideoFile(capture) != STATUS_OK) {
+        freeFrameCapture(capture);
+        return STATUS_ERR;
+    }
+
+    capture->queue_pixels = allocateMemory(CAPTURE_QUEUE_SIZE * capture->frame_size);
+    // RGB output is larger than YUV 4:2:0 planes of any size
+    capture->output_pixels = allocateMemory((size_t)width * height * N_OUTPUT_CHANNELS);
+    if (!capture->queue_pixels || !capture->output_pixels || initMutex(&capture->mutex) != STATUS_OK
+        || initConditionVariable(&capture->condition) != STATUS_OK) {
+        puts("Unable to allocate frame capture");
+        freeFrameCapture(capture);
+        return STATUS_ERR;
+    }
+
+    if (initRenderTarget(capture) != STATUS_OK || startThread(&capture->writer, runWriter, capture) != STATUS_OK) {
+        freeFrameCapture(capture);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+void freeFrameCapture(FrameCapture* capture) {
+    if (capture->writer.handle) {
+        while (capture->n_in_flight > 0) {
+            collectFrame(capture, true);
+        }
+
+        lockMutex(&capture->mutex);
+        capture->is_finishing = true;
+        wakeAllConditionVariable(&capture->condition);
+        unlockMutex(&capture->mutex);
+        joinThread(&capture->writer);
+        printf("Captured %llu frames of %dx%d to %s\n", (unsigned long long)capture->n_written, capture->width,
+               capture->height, capture->path);
+    }
+
+    freeRenderTarget(capture);
+    if (capture->video_file) {
+        // Reserved stdout stays open, so output is only flushed
+        if (capture->video_file == g_stdout_video) {
+            fflush(capture->video_file);
+        } else {
+            fclose(capture->video_file);
+        }
+        capture->video_file = NULL;
+    }
+    freeConditionVariable(&capture->condition);
+    freeMutex(&capture->mutex);
+    free(capture->queue_pixels);
+    free(capture->output_pixels);
+    capture->queue_pixels = capture->output_pixels = NULL;
+}
+
+
+void beginFrameCapture(FrameCapture* capture) {
+    glBindFramebuffer(GL_FRAMEBUFFER, capture->framebuffer);
+    glViewport(0, 0, capture->width, capture->height);
+}
+
+
+void endFrameCapture(FrameCapture* capture, int window_width, int window_height) {
+    // Buffer of the oldest frame is reused, its readback has had CAPTURE_RING_SIZE - 1 frames to finish
+    if (capture->n_in_flight == CAPTURE_RING_SIZE) {
+        collectFrame(capture, true);
+    }
+
+    size_t slot = (capture->ring_first + capture->n_in_flight) % CAPTURE_RING_SIZE;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pixel_buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    capture->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    capture->n_in_flight++;
+
+    // Pick up readbacks that are done without waiting
+    while (capture->n_in_flight > 0 && collectFrame(capture, false)) {
+    }
+
+    // Show the frame
+    glBlitNamedFramebuffer(capture->framebuffer, 0, 0, 0, capture->width, capture->height,
+                           0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width, window_height);
+}
@@ -0,0 +1,104 @@
+#include <stdint.h>
+
+#include "cpu_features.h"
+#include "thread.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_FEATURES_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+enum {
+    CPU_FEATURES_DETECTED = 1,
+    CPU_FEATURE_AVX2 = 2,
+    CPU_FEATURE_AVX512 = 4
+};
+
+
+// Feature bits, 0 until first use
+static AtomicCounter g_cpu_features = { 0 };
+
+
+#ifdef CPU_FEATURES_X86
+static void getCpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subleaf);
+    for (int k = 0; k < 4; ++k) {
+        regs[k] = (unsigned)info[k];
+    }
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3])) {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    }
+#endif
+}
+
+
+// Register state enabled by the OS, only valid if CPUID reports OSXSAVE
+static uint64_t getXcr0(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+
+// YMM state for AVX2, also opmask and ZMM state for AVX-512
+static int64_t detectCpuFeatures(void) {
+    int64_t features = CPU_FEATURES_DETECTED;
+    unsigned regs[4];
+    getCpuid(0, 0, regs);
+    if (regs[0] < 7) {
+        return features;
+    }
+    getCpuid(1, 0, regs);
+    bool has_osxsave = regs[2] & (1u << 27);
+    bool has_avx = regs[2] & (1u << 28);
+    if (!has_osxsave || !has_avx) {
+        return features;
+    }
+    uint64_t xcr0 = getXcr0();
+    getCpuid(7, 0, regs);
+    if ((xcr0 & 0x6) == 0x6 && (regs[1] & (1u << 5))) {
+        features |= CPU_FEATURE_AVX2;
+    }
+    if ((xcr0 & 0xe6) == 0xe6 && (regs[1] & (1u << 16))) {
+        features |= CPU_FEATURE_AVX512;
+    }
+    return features;
+}
+#else
+static int64_t detectCpuFeatures(void) {
+    return CPU_FEATURES_DETECTED;
+}
+#endif
+
+
+static int64_t getCpuFeatures(void) {
+    int64_t features = loadAtomicCounter(&g_cpu_features);
+    if (features == 0) {
+        // Threads racing here all detect the same features
+        features = detectCpuFeatures();
+        storeAtomicCounter(&g_cpu_features, features);
+    }
+    return features;
+}
+
+
+bool hasCpuAvx2(void) {
+    return getCpuFeatures() & CPU_FEATURE_AVX2;
+}
+
+
+bool hasCpuAvx512(void) {
+    return getCpuFeatures() & CPU_FEATURE_AVX512;
+}
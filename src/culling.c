@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "culling.h"
+#include "culling_kernels.h"
+#include "cpu_features.h"
+#include "allocation.h"
+
+
+// Baseline kernel built into this file, wider ones have their own files compiled with extra flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE2
+#endif
+
+
+Status initDiceCuller(DiceCuller* culler, size_t capacity) {
+    // Round up so the last iteration never reads past the arrays
+    culler->capacity = (capacity + CULL_MAX_WIDTH - 1) / CULL_MAX_WIDTH * CULL_MAX_WIDTH;
+    culler->center_x = allocateMemory(culler->capacity * sizeof(float));
+    culler->center_y = allocateMemory(culler->capacity * sizeof(float));
+    culler->center_z = allocateMemory(culler->capacity * sizeof(float));
+    culler->radius = allocateMemory(culler->capacity * sizeof(float));
+    culler->visible = allocateMemory(culler->capacity * sizeof(uint32_t));
+    culler->n_visible = 0;
+
+    if (!culler->center_x || !culler->center_y || !culler->center_z || !culler->radius || !culler->visible) {
+        puts("Unable to allocate dice culler");
+        freeDiceCuller(culler);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+void freeDiceCuller(DiceCuller* culler) {
+    free(culler->center_x);
+    free(culler->center_y);
+    free(culler->center_z);
+    free(culler->radius);
+    free(culler->visible);
+    culler->center_x = culler->center_y = culler->center_z = culler->radius = NULL;
+    culler->visible = NULL;
+}
+
+
+// Transpose world positions into bounds arrays, padding up to the widest kernel
+static size_t updateBounds(DiceCuller* culler, const DiceWorld* world, const float* type_radius) {
+    size_t n = world->n_dice < culler->capacity ? world->n_dice : culler->capacity;
+    for (size_t i = 0; i < n; ++i) {
+        culler->center_x[i] = world->position[i][0];
+        culler->center_y[i] = world->position[i][1];
+        culler->center_z[i] = world->position[i][2];
+        culler->radius[i] = world->scale[i] * type_radius[world->type[i]];
+    }
+
+    // Padding spheres have negative infinite radius and are always outside
+    size_t n_padded = (n + CULL_MAX_WIDTH - 1) / CULL_MAX_WIDTH * CULL_MAX_WIDTH;
+    for (size_t i = n; i < n_padded; ++i) {
+        culler->center_x[i] = culler->center_y[i] = culler->center_z[i] = 0.0f;
+        culler->radius[i] = -INFINITY;
+    }
+    return n_padded;
+}
+
+
+#ifdef CULLING_SSE2
+static size_t cullSpheresSse2(const float* cx, const float* cy, const float* cz, const float* cr, size_t n,
+                              const vec4* planes, uint32_t* visible) {
+    const __m128i lane_index = _mm_setr_epi32(0, 1, 2, 3);
+    size_t n_visible = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+        __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(cr + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < CULL_N_PLANES; ++p) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p][0])), _mm_set1_ps(planes[p][3]));
+            d = _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(planes[p][1])), d);
+            d = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p][2])), d);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+        }
+        // Same compaction as the AVX2 kernel
+        int mask = _mm_movemask_ps(inside);
+        if (mask == 0xF) {
+            _mm_storeu_si128((__m128i*)(visible + n_visible), _mm_add_epi32(_mm_set1_epi32((int)i), lane_index));
+            n_visible += 4;
+        } else if (mask != 0) {
+            for (int lane = 0; lane < 4; ++lane) {
+                visible[n_visible] = (uint32_t)(i + lane);
+                n_visible += (mask >> lane) & 1;
+            }
+        }
+    }
+    return n_visible;
+}
+
+
+const CullKernels CULL_KERNELS_BASELINE = { 4, cullSpheresSse2 };
+#else
+static size_t cullSpheresScalar(const float* cx, const float* cy, const float* cz, const float* cr, size_t n,
+                                const vec4* planes, uint32_t* visible) {
+    size_t n_visible = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int inside = 1;
+        for (int p = 0; p < CULL_N_PLANES; ++p) {
+            float d = cx[i] * planes[p][0] + planes[p][3];
+            d = cy[i] * planes[p][1] + d;
+            d = cz[i] * planes[p][2] + d;
+            inside &= d >= -cr[i];
+        }
+        visible[n_visible] = (uint32_t)i;
+        n_visible += inside;
+    }
+    return n_visible;
+}
+
+
+const CullKernels CULL_KERNELS_BASELINE = { 1, cullSpheresScalar };
+#endif
+
+
+// Widest kernel supported by both the build and the CPU
+static const CullKernels* getCullKernels(void) {
+    if (CULL_KERNELS_AVX512.width > 0 && hasCpuAvx512()) {
+        return &CULL_KERNELS_AVX512;
+    }
+    if (CULL_KERNELS_AVX2.width > 0 && hasCpuAvx2()) {
+        return &CULL_KERNELS_AVX2;
+    }
+    return &CULL_KERNELS_BASELINE;
+}
+
+
+// Sphere is visible unless it lies entirely behind one of the planes:
+// dot(plane.xyz, center) + plane.w >= -radius for all planes
+size_t cullDice(DiceCuller* culler, const DiceWorld* world, const float* type_radius, mat4 view_projection) {
+    vec4 planes[CULL_N_PLANES];
+    glm_frustum_planes(view_projection, planes);  // normalized, so distances are in world units
+
+    size_t n_padded = updateBounds(culler, world, type_radius);
+    culler->n_visible = getCullKernels()->cull(culler->center_x, culler->center_y, culler->center_z, culler->radius,
+                                               n_padded, planes, culler->visible);
+    return culler->n_visible;
+}
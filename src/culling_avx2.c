@@ -0,0 +1,44 @@
+#include "culling_kernels.h"
+
+
+// Compiled with AVX2 enabled on x86 and only called after CPUID reports it
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static size_t cullSpheresAvx2(const float* cx, const float* cy, const float* cz, const float* cr, size_t n,
+                              const vec4* planes, uint32_t* visible) {
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t n_visible = 0;
+    for (size_t i = 0; i < n; i += 8) {
+        __m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+        __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(cr + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < CULL_N_PLANES; ++p) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(planes[p][0])), _mm256_set1_ps(planes[p][3]));
+            d = _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(planes[p][1])), d);
+            d = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(planes[p][2])), d);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+        }
+        // Neighbouring dice are mostly all in or all out. Mixed groups are compacted without branches:
+        // every lane is written, only visible ones advance the cursor
+        int mask = _mm256_movemask_ps(inside);
+        if (mask == 0xFF) {
+            __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int)i), lane_index);
+            _mm256_storeu_si256((__m256i*)(visible + n_visible), index);
+            n_visible += 8;
+        } else if (mask != 0) {
+            for (int lane = 0; lane < 8; ++lane) {
+                visible[n_visible] = (uint32_t)(i + lane);
+                n_visible += (mask >> lane) & 1;
+            }
+        }
+    }
+    return n_visible;
+}
+
+
+const CullKernels CULL_KERNELS_AVX2 = { 8, cullSpheresAvx2 };
+
+#else
+const CullKernels CULL_KERNELS_AVX2 = { 0 };
+#endif
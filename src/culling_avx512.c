@@ -0,0 +1,40 @@
+#include "culling_kernels.h"
+
+
+// Compiled with AVX-512F enabled on x86 and only called after CPUID reports it
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define countBits(x) __popcnt(x)
+#else
+#define countBits(x) __builtin_popcount(x)
+#endif
+
+static size_t cullSpheresAvx512(const float* cx, const float* cy, const float* cz, const float* cr, size_t n,
+                                const vec4* planes, uint32_t* visible) {
+    const __m512i lane_index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t n_visible = 0;
+    for (size_t i = 0; i < n; i += 16) {
+        __m512 x = _mm512_loadu_ps(cx + i), y = _mm512_loadu_ps(cy + i), z = _mm512_loadu_ps(cz + i);
+        __m512 neg_r = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_loadu_ps(cr + i));
+        __mmask16 mask = 0xFFFF;
+        for (int p = 0; p < CULL_N_PLANES; ++p) {
+            __m512 d = _mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(planes[p][0])), _mm512_set1_ps(planes[p][3]));
+            d = _mm512_add_ps(_mm512_mul_ps(y, _mm512_set1_ps(planes[p][1])), d);
+            d = _mm512_add_ps(_mm512_mul_ps(z, _mm512_set1_ps(planes[p][2])), d);
+            mask &= _mm512_cmp_ps_mask(d, neg_r, _CMP_GE_OQ);
+        }
+        __m512i index = _mm512_add_epi32(_mm512_set1_epi32((int)i), lane_index);
+        _mm512_mask_compressstoreu_epi32(visible + n_visible, mask, index);
+        n_visible += countBits(mask);
+    }
+    return n_visible;
+}
+
+
+const CullKernels CULL_KERNELS_AVX512 = { 16, cullSpheresAvx512 };
+
+#else
+const CullKernels CULL_KERNELS_AVX512 = { 0 };
+#endif
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dice_world.h"
+#include "allocation.h"
+#include "top_face.h"
+#include "quat_batch.h"
+
+
+static const uint32_t NO_FREE_SLOT = UINT32_MAX;
+
+
+Status initDiceWorld(DiceWorld* world, size_t capacity, const AnimationSettings* anim_settings) {
+    memset(world, 0, sizeof(*world));
+    world->capacity = capacity;
+    world->n_roll_points = anim_settings->n_points;
+
+    world->position = allocateMemory(capacity * sizeof(vec3));
+    world->orientation = allocateMemory(capacity * sizeof(versor));
+    world->scale = allocateMemory(capacity * sizeof(float));
+    world->type = allocateMemory(capacity * sizeof(DiceType));
+    world->skin = allocateMemory(capacity * sizeof(uint32_t));
+    world->state = allocateMemory(capacity * sizeof(DiceState));
+    world->idle_angle_deg = allocateMemory(capacity * sizeof(float));
+    world->event_time = allocateMemory(capacity * sizeof(double));
+    world->roll_anim = allocateMemory(capacity * sizeof(RollAnimationState));
+    world->target_value = allocateMemory(capacity * sizeof(int));
+    world->result = allocateMemory(capacity * sizeof(int));
+    world->slot_index = allocateMemory(capacity * sizeof(uint32_t));
+    world->slots = allocateMemory(capacity * sizeof(DiceSlot));
+    world->roll_queues = allocateMemory(capacity * world->n_roll_points * sizeof(versor));
+    world->changed_slots = allocateMemory(capacity * sizeof(uint32_t));
+    world->is_slot_changed = allocateZeroedMemory(capacity, sizeof(bool));
+
+    if (!world->position || !world->orientation || !world->scale || !world->type || !world->skin || !world->state
+        || !world->idle_angle_deg || !world->event_time || !world->roll_anim || !world->target_value
+        || !world->result || !world->slot_index || !world->slots || !world->roll_queues || !world->changed_slots
+        || !world->is_slot_changed) {
+        puts("Unable to allocate dice world");
+        freeDiceWorld(world);
+        return STATUS_ERR;
+    }
+
+    // Chain all slots into the free list
+    for (size_t i = 0; i < capacity; ++i) {
+        world->slots[i].dense_index = i + 1 < capacity ? (uint32_t)(i + 1) : NO_FREE_SLOT;
+        world->slots[i].generation = 0;
+    }
+    world->free_slot = capacity > 0 ? 0 : NO_FREE_SLOT;
+
+    return STATUS_OK;
+}
+
+
+void freeDiceWorld(DiceWorld* world) {
+    free(world->position);
+    free(world->orientation);
+    free(world->scale);
+    free(world->type);
+    free(world->skin);
+    free(world->state);
+    free(world->idle_angle_deg);
+    free(world->event_time);
+    free(world->roll_anim);
+    free(world->target_value);
+    free(world->result);
+    free(world->slot_index);
+    free(world->slots);
+    free(world->roll_queues);
+    free(world->changed_slots);
+    free(world->is_slot_changed);
+    memset(world, 0, sizeof(*world));
+}
+
+
+static void markSlotChanged(DiceWorld* world, uint32_t slot) {
+    if (!world->is_slot_changed[slot]) {
+        world->is_slot_changed[slot] = true;
+        world->changed_slots[world->n_changed_slots++] = slot;
+    }
+}
+
+
+static void forgetSlotChange(DiceWorld* world, uint32_t slot) {
+    if (!world->is_slot_changed[slot]) {
+        return;
+    }
+    world->is_slot_changed[slot] = false;
+    for (size_t k = 0; k < world->n_changed_slots; ++k) {
+        if (world->changed_slots[k] == slot) {
+            world->changed_slots[k] = world->changed_slots[--world->n_changed_slots];
+            break;
+        }
+    }
+}
+
+
+Status createDice(DiceWorld* world, DiceType type, const vec3 position, float scale, uint32_t skin,
+                  DiceHandle* out_handle) {
+    if (world->free_slot == NO_FREE_SLOT) {
+        puts("Dice world is full");
+        return STATUS_ERR;
+    }
+
+    uint32_t slot = world->free_slot;
+    world->free_slot = world->slots[slot].dense_index;
+
+    size_t i = world->n_dice++;
+    world->slots[slot].dense_index = (uint32_t)i;
+    world->slot_index[i] = slot;
+
+    glm_vec3_copy((float*)position, world->position[i]);
+    glm_quat_identity(world->orientation[i]);
+    world->scale[i] = scale;
+    world->type[i] = type;
+    world->skin[i] = skin;
+    world->state[i] = DICE_STATE_IDLE;
+    world->idle_angle_deg[i] = 0.0f;
+    world->event_time[i] = world->time;
+    world->target_value[i] = 0;
+    world->result[i] = 0;
+
+    // Queue belongs to the slot, so it follows the die when dense arrays are compacted
+    world->roll_anim[i].q_arr = &world->roll_queues[slot * world->n_roll_points];
+    resetRollAnimationState(&world->roll_anim[i]);
+    markSlotChanged(world, slot);
+
+    out_handle->index = slot;
+    out_handle->generation = world->slots[slot].generation;
+    return STATUS_OK;
+}
+
+
+void destroyDice(DiceWorld* world, DiceHandle handle) {
+    if (!isDiceAlive(world, handle)) {
+        return;
+    }
+
+    // Move last die into the hole to keep dense arrays packed
+    size_t i = world->slots[handle.index].dense_index;
+    size_t last = --world->n_dice;
+    if (i != last) {
+        glm_vec3_copy(world->position[last], world->position[i]);
+        glm_quat_copy(world->orientation[last], world->orientation[i]);
+        world->scale[i] = world->scale[last];
+        world->type[i] = world->type[last];
+        world->skin[i] = world->skin[last];
+        world->state[i] = world->state[last];
+        world->idle_angle_deg[i] = world->idle_angle_deg[last];
+        world->event_time[i] = world->event_time[last];
+        world->roll_anim[i] = world->roll_anim[last];
+        world->target_value[i] = world->target_value[last];
+        world->result[i] = world->result[last];
+        world->slot_index[i] = world->slot_index[last];
+        world->slots[world->slot_index[i]].dense_index = (uint32_t)i;
+    }
+
+    // Freed slot has nothing left to mirror
+    forgetSlotChange(world, handle.index);
+
+    // Invalidate outstanding handles and return slot to the free list
+    world->slots[handle.index].generation++;
+    world->slots[handle.index].dense_index = world->free_slot;
+    world->free_slot = handle.index;
+}
+
+
+bool isDiceAlive(const DiceWorld* world, DiceHandle handle) {
+    if (handle.index >= world->capacity || world->slots[handle.index].generation != handle.generation) {
+        return false;
+    }
+    // Free slots keep the generation of the next handle, so check that slot is in use
+    size_t i = world->slots[handle.index].dense_index;
+    return i < world->n_dice && world->slot_index[i] == handle.index;
+}
+
+
+size_t getDiceDenseIndex(const DiceWorld* world, DiceHandle handle) {
+    return world->slots[handle.index].dense_index;
+}
+
+
+void rollDice(DiceWorld* world, size_t i, int dice_value, const AnimationSettings* settings) {
+    // Roll starts from where the die is now
+    uint32_t dense_index = (uint32_t)i;
+    updateDiceOrientations(world, settings, &dense_index, 1);
+    fillRollAnimationQueue(&world->roll_anim[i], world->orientation[i], settings, world->type[i],
+                           (size_t)dice_value);
+    world->state[i] = DICE_STATE_ROLLING;
+    world->event_time[i] = world->time;
+    world->target_value[i] = dice_value;
+    world->result[i] = 0;
+    markSlotChanged(world, world->slot_index[i]);
+}
+
+
+// Settles finished rolls of a chunk, their results are found by one batch. Returns number of dice still rolling
+static size_t updateDiceChunk(DiceWorld* world, size_t first, size_t n, float time_delta,
+                              const AnimationSettings* settings) {
+    size_t settled[QUAT_BATCH_CHUNK];
+    size_t n_rolling = 0, n_settled = 0;
+    DiceType settled_type[QUAT_BATCH_CHUNK];
+    versor settled_orientation[QUAT_BATCH_CHUNK];
+    int settled_value[QUAT_BATCH_CHUNK];
+
+    for (size_t i = first; i < first + n; ++i) {
+        float *q_from, *q_to, weight;
+        switch (world->state[i]) {
+        case DICE_STATE_IDLE:
+            world->idle_angle_deg[i] += settings->idle_rot_speed * time_delta;
+            break;
+        case DICE_STATE_ROLLING:
+            if (advanceRollAnimation(time_delta, settings, &world->roll_anim[i], &q_from, &q_to, &weight)) {
+                n_rolling++;
+            } else {
+                glm_quat_copy(world->roll_anim[i].q_arr[world->n_roll_points - 1], world->orientation[i]);
+                world->state[i] = DICE_STATE_SETTLED;
+                settled_type[n_settled] = world->type[i];
+                glm_quat_copy(world->orientation[i], settled_orientation[n_settled]);
+                settled[n_settled++] = i;
+            }
+            break;
+        case DICE_STATE_SETTLED:
+            break;
+        }
+    }
+
+    getDiceTopFaces(settled_type, settled_orientation, n_settled, NULL, settled_value);
+    for (size_t j = 0; j < n_settled; ++j) {
+        world->result[settled[j]] = settled_value[j];
+    }
+    return n_rolling;
+}
+
+
+size_t updateDiceWorld(DiceWorld* world, float time_delta, const AnimationSettings* settings) {
+    world->time += time_delta;
+    size_t n_rolling = 0;
+    for (size_t first = 0; first < world->n_dice; first += QUAT_BATCH_CHUNK) {
+        size_t n = world->n_dice - first < QUAT_BATCH_CHUNK ? world->n_dice - first : QUAT_BATCH_CHUNK;
+        n_rolling += updateDiceChunk(world, first, n, time_delta, settings);
+    }
+    return n_rolling;
+}
+
+
+// Dice of a chunk are gathered by state into component arrays, rotated by batch kernels and scattered back
+static void updateOrientationChunk(DiceWorld* world, const uint32_t* dense_indices, size_t first, size_t n,
+                                   const AnimationSettings* settings) {
+    size_t idle[QUAT_BATCH_CHUNK], rolling[QUAT_BATCH_CHUNK];
+    size_t n_idle = 0, n_rolling = 0;
+    float a[4][QUAT_BATCH_CHUNK], b[4][QUAT_BATCH_CHUNK], c[4][QUAT_BATCH_CHUNK], t[QUAT_BATCH_CHUNK];
+    QuatArrays qa = { a[0], a[1], a[2], a[3] };
+    QuatArrays qb = { b[0], b[1], b[2], b[3] };
+    QuatArrays qc = { c[0], c[1], c[2], c[3] };
+
+    for (size_t k = first; k < first + n; ++k) {
+        size_t i = dense_indices ? dense_indices[k] : k;
+        float *q_from, *q_to;
+        switch (world->state[i]) {
+        case DICE_STATE_IDLE:
+            idle[n_idle++] = i;
+            break;
+        case DICE_STATE_ROLLING:
+            if (getRollAnimationKeyframes(settings, &world->roll_anim[i], &q_from, &q_to, &t[n_rolling])) {
+                for (int m = 0; m < 4; ++m) {
+                    a[m][n_rolling] = q_from[m];
+                    b[m][n_rolling] = q_to[m];
+                }
+                rolling[n_rolling++] = i;
+            }
+            break;
+        case DICE_STATE_SETTLED:
+            break;
+        }
+    }
+
+    interpolateQuats(settings->interpolation, qa, qb, t, qa, n_rolling);
+    for (size_t j = 0; j < n_rolling; ++j) {
+        for (int m = 0; m < 4; ++m) {
+            world->orientation[rolling[j]][m] = a[m][j];
+        }
+    }
+
+    for (size_t j = 0; j < n_idle; ++j) {
+        versor factors[3];
+        getIdleRotationFactors(world->idle_angle_deg[idle[j]], factors);
+        for (int m = 0; m < 4; ++m) {
+            a[m][j] = factors[0][m];
+            b[m][j] = factors[1][m];
+            c[m][j] = factors[2][m];
+        }
+    }
+    multiplyQuats(qb, qc, qb, n_idle);
+    multiplyQuats(qa, qb, qa, n_idle);
+    for (size_t j = 0; j < n_idle; ++j) {
+        for (int m = 0; m < 4; ++m) {
+            world->orientation[idle[j]][m] = a[m][j];
+        }
+    }
+}
+
+
+void updateDiceOrientations(DiceWorld* world, const AnimationSettings* settings, const uint32_t* dense_indices,
+                            size_t n) {
+    for (size_t first = 0; first < n; first += QUAT_BATCH_CHUNK) {
+        size_t n_chunk = n - first < QUAT_BATCH_CHUNK ? n - first : QUAT_BATCH_CHUNK;
+        updateOrientationChunk(world, dense_indices, first, n_chunk, settings);
+    }
+}
+
+
+void clearDiceChanges(DiceWorld* world) {
+    for (size_t k = 0; k < world->n_changed_slots; ++k) {
+        world->is_slot_changed[world->changed_slots[k]] = false;
+    }
+    world->n_changed_slots = 0;
+}
+
+
+uint32_t getDiceWorldChecksum(const DiceWorld* world) {
+    const unsigned char* bytes = (const unsigned char*)world->orientation;
+    uint32_t hash = 2166136261u;
+    for (size_t b = 0; b < world->n_dice * sizeof(versor); ++b) {
+        hash = (hash ^ bytes[b]) * 16777619u;
+    }
+    return hash;
+}
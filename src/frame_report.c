@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "frame_report.h"
+#include "allocation.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+enum {
+    REPORT_VERSION = 1,
+    MAX_PATH_LENGTH = 512
+};
+
+static const uint64_t HITCH_THRESHOLDS_US[FRAME_REPORT_N_HITCH_LEVELS] = { 33333, 50000, 100000 };
+static const double REPORT_PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9 };
+static const char* PERCENTILE_KEYS[] = { "p50_ms", "p90_ms", "p99_ms", "p999_ms" };
+
+
+void initFrameReport(FrameReport* report) {
+    for (int stage = 0; stage < FRAME_N_STAGES; ++stage) {
+        clearHistogram(&report->stages[stage]);
+    }
+    memset(report->n_hitches, 0, sizeof(report->n_hitches));
+    report->n_instances = 1;
+}
+
+
+void recordFrameStage(FrameReport* report, FrameStage stage, double seconds) {
+    uint64_t time_us = seconds > 0.0 ? (uint64_t)(seconds * 1e6 + 0.5) : 0;
+    recordHistogramValue(&report->stages[stage], time_us);
+    if (stage == FRAME_STAGE_FRAME) {
+        for (int level = 0; level < FRAME_REPORT_N_HITCH_LEVELS && time_us > HITCH_THRESHOLDS_US[level]; ++level) {
+            report->n_hitches[level]++;
+        }
+    }
+}
+
+
+void mergeFrameReport(FrameReport* report, const FrameReport* other) {
+    for (int stage = 0; stage < FRAME_N_STAGES; ++stage) {
+        mergeHistogram(&report->stages[stage], &other->stages[stage]);
+    }
+    for (int level = 0; level < FRAME_REPORT_N_HITCH_LEVELS; ++level) {
+        report->n_hitches[level] += other->n_hitches[level];
+    }
+    report->n_instances += other->n_instances;
+}
+
+
+const char* getFrameStageName(FrameStage stage) {
+    static const char* NAMES[FRAME_N_STAGES] = { "frame", "update", "render", "present" };
+    return stage < FRAME_N_STAGES ? NAMES[stage] : "unknown";
+}
+
+
+/* Writing */
+
+static void writeUnsignedArray(FILE* file, const uint64_t* values, size_t n_values) {
+    fputc('[', file);
+    for (size_t i = 0; i < n_values; ++i) {
+        fprintf(file, i == 0 ? "%llu" : ", %llu", (unsigned long long)values[i]);
+    }
+    fputc(']', file);
+}
+
+
+static void writeStage(FILE* file, const Histogram* histogram, const char* name) {
+    fprintf(file, "    \"%s\": {\n", name);
+    fprintf(file, "      \"count\": %llu, \"sum_us\": %llu, \"min_us\": %llu, \"max_us\": %llu,\n",
+            (unsigned long long)histogram->n_values, (unsigned long long)histogram->sum,
+            (unsigned long long)(histogram->n_values > 0 ? histogram->min : 0), (unsigned long long)histogram->max);
+
+    double mean_ms = histogram->n_values > 0 ? (double)histogram->sum / histogram->n_values * 1e-3 : 0.0;
+    fprintf(file, "      \"mean_ms\": %.3f", mean_ms);
+    for (size_t i = 0; i < sizeof(REPORT_PERCENTILES) / sizeof(REPORT_PERCENTILES[0]); ++i) {
+        fprintf(file, ", \"%s\": %.3f", PERCENTILE_KEYS[i],
+                getHistogramPercentile(histogram, REPORT_PERCENTILES[i]) * 1e-3);
+    }
+    fprintf(file, ", \"max_ms\": %.3f,\n", histogram->max * 1e-3);
+
+    // Only non-empty buckets as [index, count]
+    fputs("      \"buckets\": [", file);
+    bool is_first = true;
+    for (size_t i = 0; i < HISTOGRAM_N_BUCKETS; ++i) {
+        if (histogram->counts[i] > 0) {
+            fprintf(file, is_first ? "[%llu, %llu]" : ", [%llu, %llu]", (unsigned long long)i,
+                    (unsigned long long)histogram->counts[i]);
+            is_first = false;
+        }
+    }
+    fputs("]\n    }", file);
+}
+
+
+static Status replaceFile(const char* temp_path, const char* path) {
+#ifdef _WIN32
+    bool is_replaced = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    bool is_replaced = rename(temp_path, path) == 0;
+#endif
+    if (!is_replaced) {
+        printf("Unable to replace frame report %s\n", path);
+        remove(temp_path);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+Status writeFrameReport(const FrameReport* report, const char* path) {
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        printf("Frame report path is too long: %s\n", path);
+        return STATUS_ERR;
+    }
+    FILE* file = fopen(temp_path, "w");
+    if (!file) {
+        printf("Unable to create frame report %s\n", temp_path);
+        return STATUS_ERR;
+    }
+
+    const Histogram* frames = &report->stages[FRAME_STAGE_FRAME];
+    fprintf(file, "{\n  \"version\": %d,\n  \"instances\": %llu,\n  \"frames\": %llu,\n  \"duration_s\": %.3f,\n",
+            REPORT_VERSION, (unsigned long long)report->n_instances, (unsigned long long)frames->n_values,
+            frames->sum * 1e-6);
+    fprintf(file, "  \"sub_bucket_bits\": %d,\n", HISTOGRAM_SUB_BUCKET_BITS);
+    fputs("  \"hitch_thresholds_us\": ", file);
+    writeUnsignedArray(file, HITCH_THRESHOLDS_US, FRAME_REPORT_N_HITCH_LEVELS);
+    fputs(",\n  \"hitches\": ", file);
+    writeUnsignedArray(file, report->n_hitches, FRAME_REPORT_N_HITCH_LEVELS);
+    fputs(",\n  \"stages\": {\n", file);
+    for (int stage = 0; stage < FRAME_N_STAGES; ++stage) {
+        writeStage(file, &report->stages[stage], getFrameStageName(stage));
+        fputs(stage + 1 < FRAME_N_STAGES ? ",\n" : "\n", file);
+    }
+    fputs("  }\n}\n", file);
+
+    bool is_written = !ferror(file);
+    if (fclose(file) != 0 || !is_written) {
+        printf("Unable to write frame report %s\n", temp_path);
+        remove(temp_path);
+        return STATUS_ERR;
+    }
+    return replaceFile(temp_path, path);
+}
+
+
+/* Reading. Not a general JSON parser: keys are looked up by name, which works for reports because every
+key is unique within its object and stage objects hold no nested objects */
+
+static const char* skipSpaces(const char* cursor) {
+    while (isspace((unsigned char)*cursor)) {
+        ++cursor;
+    }
+    return cursor;
+}
+
+
+static bool expectChar(const char** cursor, char c) {
+    const char* next = skipSpaces(*cursor);
+    if (*next != c) {
+        return false;
+    }
+    *cursor = next + 1;
+    return true;
+}
+
+
+static bool parseUnsigned(const char** cursor, uint64_t* value) {
+    const char* begin = skipSpaces(*cursor);
+    if (!isdigit((unsigned char)*begin)) {
+        return false;
+    }
+    char* end;
+    *value = strtoull(begin, &end, 10);
+    *cursor = end;
+    return true;
+}
+
+
+// Position after the colon of "key" between begin and end, NULL if missing
+static const char* findKey(const char* begin, const char* end, const char* key) {
+    size_t key_length = strlen(key);
+    for (const char* found = strstr(begin, key); found && found < end; found = strstr(found + 1, key)) {
+        const char* cursor = found + key_length;
+        if (found > begin && found[-1] == '"' && *cursor == '"') {
+            cursor = skipSpaces(cursor + 1);
+            if (*cursor == ':') {
+                return cursor + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+static bool readUnsignedKey(const char* begin, const char* end, const char* key, uint64_t* value) {
+    const char* cursor = findKey(begin, end, key);
+    return cursor && parseUnsigned(&cursor, value);
+}
+
+
+static bool readUnsignedArrayKey(const char* begin, const char* end, const char* key, uint64_t* values,
+                                 size_t n_values) {
+    const char* cursor = findKey(begin, end, key);
+    if (!cursor || !expectChar(&cursor, '[')) {
+        return false;
+    }
+    for (size_t i = 0; i < n_values; ++i) {
+        if ((i > 0 && !expectChar(&cursor, ',')) || !parseUnsigned(&cursor, &values[i])) {
+            return false;
+        }
+    }
+    return expectChar(&cursor, ']');
+}
+
+
+static bool readStage(const char* begin, const char* end, const char* name, Histogram* histogram) {
+    const char* stage_begin = findKey(begin, end, name);
+    if (!stage_begin || !expectChar(&stage_begin, '{')) {
+        return false;
+    }
+    const char* stage_end = strchr(stage_begin, '}');
+    if (!stage_end || stage_end > end) {
+        return false;
+    }
+
+    clearHistogram(histogram);
+    uint64_t min;
+    if (!readUnsignedKey(stage_begin, stage_end, "count", &histogram->n_values)
+        || !readUnsignedKey(stage_begin, stage_end, "sum_us", &histogram->sum)
+        || !readUnsignedKey(stage_begin, stage_end, "min_us", &min)
+        || !readUnsignedKey(stage_begin, stage_end, "max_us", &histogram->max)) {
+        return false;
+    }
+    histogram->min = histogram->n_values > 0 ? min : UINT64_MAX;
+
+    const char* cursor = findKey(stage_begin, stage_end, "buckets");
+    if (!cursor || !expectChar(&cursor, '[')) {
+        return false;
+    }
+    uint64_t n_counted = 0;
+    for (bool is_first = true; !expectChar(&cursor, ']'); is_first = false) {
+        uint64_t index, count;
+        if ((!is_first && !expectChar(&cursor, ',')) || !expectChar(&cursor, '[') || !parseUnsigned(&cursor, &index)
+            || !expectChar(&cursor, ',') || !parseUnsigned(&cursor, &count) || !expectChar(&cursor, ']')
+            || index >= HISTOGRAM_N_BUCKETS) {
+            return false;
+        }
+        histogram->counts[index] += count;
+        n_counted += count;
+    }
+    return n_counted == histogram->n_values;
+}
+
+
+static Status parseFrameReport(FrameReport* report, const char* text) {
+    const char* end = text + strlen(text);
+    uint64_t version, sub_bucket_bits;
+    uint64_t thresholds[FRAME_REPORT_N_HITCH_LEVELS];
+    if (!readUnsignedKey(text, end, "version", &version) || version != REPORT_VERSION
+        || !readUnsignedKey(text, end, "sub_bucket_bits", &sub_bucket_bits)
+        || !readUnsignedArrayKey(text, end, "hitch_thresholds_us", thresholds, FRAME_REPORT_N_HITCH_LEVELS)) {
+        puts("Unknown frame report format");
+        return STATUS_ERR;
+    }
+    if (sub_bucket_bits != HISTOGRAM_SUB_BUCKET_BITS
+        || memcmp(thresholds, HITCH_THRESHOLDS_US, sizeof(thresholds)) != 0) {
+        puts("Frame report has different buckets or hitch thresholds");
+        return STATUS_ERR;
+    }
+
+    const char* stages = findKey(text, end, "stages");
+    if (!readUnsignedKey(text, end, "instances", &report->n_instances)
+        || !readUnsignedArrayKey(text, end, "hitches", report->n_hitches, FRAME_REPORT_N_HITCH_LEVELS) || !stages) {
+        puts("Frame report is damaged");
+        return STATUS_ERR;
+    }
+    for (int stage = 0; stage < FRAME_N_STAGES; ++stage) {
+        if (!readStage(stages, end, getFrameStageName(stage), &report->stages[stage])) {
+            printf("Frame report has damaged %s stage\n", getFrameStageName(stage));
+            return STATUS_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+
+Status readFrameReport(FrameReport* report, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printf("Unable to open frame report %s\n", path);
+        return STATUS_ERR;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* text = length >= 0 ? allocateMemory((size_t)length + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)length, file) != (size_t)length) {
+        printf("Unable to read frame report %s\n", path);
+        free(text);
+        fclose(file);
+        return STATUS_ERR;
+    }
+    fclose(file);
+    text[length] = '\0';
+
+    initFrameReport(report);
+    Status status = parseFrameReport(report, text);
+    free(text);
+    return status;
+}
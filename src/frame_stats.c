@@ -0,0 +1,34 @@
+#include "frame_stats.h"
+
+
+Status openFrameStatsSink(FrameStatsSink* sink, const char* path) {
+    *sink = (FrameStatsSink) { .file = fopen(path, "w") };
+    if (!sink->file) {
+        printf("Unable to create frame statistics file %s\n", path);
+        return STATUS_ERR;
+    }
+    fputs("frame,frame_ms,dice,text_characters,draw_calls,dispatches,state_changes,texture_binds,"
+          "uniform_updates,upload_bytes,allocations\n", sink->file);
+    return STATUS_OK;
+}
+
+
+void closeFrameStatsSink(FrameStatsSink* sink) {
+    if (sink->file) {
+        fclose(sink->file);
+        sink->file = NULL;
+    }
+}
+
+
+void writeFrameStats(FrameStatsSink* sink, const FrameStats* stats) {
+    const GlCallCounters* calls = &stats->gl_calls;
+    fprintf(sink->file, "%llu,%.3f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", (unsigned long long)sink->n_frames,
+            stats->frame_time * 1000.0, (unsigned long long)stats->n_dice,
+            (unsigned long long)stats->n_text_characters,
+            (unsigned long long)calls->n_draw_calls, (unsigned long long)calls->n_dispatches,
+            (unsigned long long)calls->n_state_changes, (unsigned long long)calls->n_texture_binds,
+            (unsigned long long)calls->n_uniform_updates, (unsigned long long)calls->n_upload_bytes,
+            (unsigned long long)stats->n_allocations);
+    sink->n_frames++;
+}
@@ -0,0 +1,227 @@
+#include <glad/gl.h>
+
+#include "gl_counters.h"
+
+
+static GlCallCounters g_counters = { 0 };
+static bool g_is_installed = false;
+
+
+// Driver entry points saved on install, the wrappers forward to them
+static PFNGLDRAWARRAYSPROC g_draw_arrays;
+static PFNGLDRAWARRAYSINSTANCEDPROC g_draw_arrays_instanced;
+static PFNGLMULTIDRAWELEMENTSINDIRECTPROC g_multi_draw_elements_indirect;
+static PFNGLDISPATCHCOMPUTEPROC g_dispatch_compute;
+static PFNGLUSEPROGRAMPROC g_use_program;
+static PFNGLBINDVERTEXARRAYPROC g_bind_vertex_array;
+static PFNGLBINDBUFFERPROC g_bind_buffer;
+static PFNGLBINDBUFFERBASEPROC g_bind_buffer_base;
+static PFNGLBINDFRAMEBUFFERPROC g_bind_framebuffer;
+static PFNGLENABLEPROC g_enable;
+static PFNGLDISABLEPROC g_disable;
+static PFNGLBLENDFUNCPROC g_blend_func;
+static PFNGLPOLYGONMODEPROC g_polygon_mode;
+static PFNGLVIEWPORTPROC g_viewport;
+static PFNGLBINDTEXTUREUNITPROC g_bind_texture_unit;
+static PFNGLUNIFORM1FPROC g_uniform_1f;
+static PFNGLUNIFORM1UIPROC g_uniform_1ui;
+static PFNGLUNIFORM3FPROC g_uniform_3f;
+static PFNGLUNIFORM3FVPROC g_uniform_3fv;
+static PFNGLUNIFORMMATRIX4FVPROC g_uniform_matrix_4fv;
+static PFNGLNAMEDBUFFERDATAPROC g_named_buffer_data;
+static PFNGLNAMEDBUFFERSUBDATAPROC g_named_buffer_sub_data;
+
+
+/* Draws */
+
+static void GLAD_API_PTR countDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    g_counters.n_draw_calls++;
+    g_draw_arrays(mode, first, count);
+}
+
+
+static void GLAD_API_PTR countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei n_instances) {
+    g_counters.n_draw_calls++;
+    g_draw_arrays_instanced(mode, first, count, n_instances);
+}
+
+
+static void GLAD_API_PTR countMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect,
+                                                        GLsizei n_draws, GLsizei stride) {
+    g_counters.n_draw_calls++;
+    g_multi_draw_elements_indirect(mode, type, indirect, n_draws, stride);
+}
+
+
+static void GLAD_API_PTR countDispatchCompute(GLuint n_groups_x, GLuint n_groups_y, GLuint n_groups_z) {
+    g_counters.n_dispatches++;
+    g_dispatch_compute(n_groups_x, n_groups_y, n_groups_z);
+}
+
+
+/* State changes */
+
+static void GLAD_API_PTR countUseProgram(GLuint program) {
+    g_counters.n_state_changes++;
+    g_use_program(program);
+}
+
+
+static void GLAD_API_PTR countBindVertexArray(GLuint vao) {
+    g_counters.n_state_changes++;
+    g_bind_vertex_array(vao);
+}
+
+
+static void GLAD_API_PTR countBindBuffer(GLenum target, GLuint buffer) {
+    g_counters.n_state_changes++;
+    g_bind_buffer(target, buffer);
+}
+
+
+static void GLAD_API_PTR countBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    g_counters.n_state_changes++;
+    g_bind_buffer_base(target, index, buffer);
+}
+
+
+static void GLAD_API_PTR countBindFramebuffer(GLenum target, GLuint framebuffer) {
+    g_counters.n_state_changes++;
+    g_bind_framebuffer(target, framebuffer);
+}
+
+
+static void GLAD_API_PTR countEnable(GLenum capability) {
+    g_counters.n_state_changes++;
+    g_enable(capability);
+}
+
+
+static void GLAD_API_PTR countDisable(GLenum capability) {
+    g_counters.n_state_changes++;
+    g_disable(capability);
+}
+
+
+static void GLAD_API_PTR countBlendFunc(GLenum source_factor, GLenum destination_factor) {
+    g_counters.n_state_changes++;
+    g_blend_func(source_factor, destination_factor);
+}
+
+
+static void GLAD_API_PTR countPolygonMode(GLenum face, GLenum mode) {
+    g_counters.n_state_changes++;
+    g_polygon_mode(face, mode);
+}
+
+
+static void GLAD_API_PTR countViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    g_counters.n_state_changes++;
+    g_viewport(x, y, width, height);
+}
+
+
+static void GLAD_API_PTR countBindTextureUnit(GLuint unit, GLuint texture) {
+    g_counters.n_texture_binds++;
+    g_bind_texture_unit(unit, texture);
+}
+
+
+/* Uniforms */
+
+static void GLAD_API_PTR countUniform1f(GLint location, GLfloat v0) {
+    g_counters.n_uniform_updates++;
+    g_uniform_1f(location, v0);
+}
+
+
+static void GLAD_API_PTR countUniform1ui(GLint location, GLuint v0) {
+    g_counters.n_uniform_updates++;
+    g_uniform_1ui(location, v0);
+}
+
+
+static void GLAD_API_PTR countUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    g_counters.n_uniform_updates++;
+    g_uniform_3f(location, v0, v1, v2);
+}
+
+
+static void GLAD_API_PTR countUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    g_counters.n_uniform_updates++;
+    g_uniform_3fv(location, count, value);
+}
+
+
+static void GLAD_API_PTR countUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                                               const GLfloat* value) {
+    g_counters.n_uniform_updates++;
+    g_uniform_matrix_4fv(location, count, transpose, value);
+}
+
+
+/* Uploads */
+
+static void GLAD_API_PTR countNamedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) {
+    if (data) {
+        g_counters.n_upload_bytes += (uint64_t)size;
+    }
+    g_named_buffer_data(buffer, size, data, usage);
+}
+
+
+static void GLAD_API_PTR countNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size,
+                                                 const void* data) {
+    g_counters.n_upload_bytes += (uint64_t)size;
+    g_named_buffer_sub_data(buffer, offset, size, data);
+}
+
+
+// Save entry point and put wrapper in its place
+#define WRAP_GL_FUNCTION(name, saved, wrapper) \
+    do { \
+        saved = glad_##name; \
+        glad_##name = wrapper; \
+    } while (0)
+
+
+void installGlCallCounters(void) {
+    if (g_is_installed) {
+        return;
+    }
+    WRAP_GL_FUNCTION(glDrawArrays, g_draw_arrays, countDrawArrays);
+    WRAP_GL_FUNCTION(glDrawArraysInstanced, g_draw_arrays_instanced, countDrawArraysInstanced);
+    WRAP_GL_FUNCTION(glMultiDrawElementsIndirect, g_multi_draw_elements_indirect, countMultiDrawElementsIndirect);
+    WRAP_GL_FUNCTION(glDispatchCompute, g_dispatch_compute, countDispatchCompute);
+    WRAP_GL_FUNCTION(glUseProgram, g_use_program, countUseProgram);
+    WRAP_GL_FUNCTION(glBindVertexArray, g_bind_vertex_array, countBindVertexArray);
+    WRAP_GL_FUNCTION(glBindBuffer, g_bind_buffer, countBindBuffer);
+    WRAP_GL_FUNCTION(glBindBufferBase, g_bind_buffer_base, countBindBufferBase);
+    WRAP_GL_FUNCTION(glBindFramebuffer, g_bind_framebuffer, countBindFramebuffer);
+    WRAP_GL_FUNCTION(glEnable, g_enable, countEnable);
+    WRAP_GL_FUNCTION(glDisable, g_disable, countDisable);
+    WRAP_GL_FUNCTION(glBlendFunc, g_blend_func, countBlendFunc);
+    WRAP_GL_FUNCTION(glPolygonMode, g_polygon_mode, countPolygonMode);
+    WRAP_GL_FUNCTION(glViewport, g_viewport, countViewport);
+    WRAP_GL_FUNCTION(glBindTextureUnit, g_bind_texture_unit, countBindTextureUnit);
+    WRAP_GL_FUNCTION(glUniform1f, g_uniform_1f, countUniform1f);
+    WRAP_GL_FUNCTION(glUniform1ui, g_uniform_1ui, countUniform1ui);
+    WRAP_GL_FUNCTION(glUniform3f, g_uniform_3f, countUniform3f);
+    WRAP_GL_FUNCTION(glUniform3fv, g_uniform_3fv, countUniform3fv);
+    WRAP_GL_FUNCTION(glUniformMatrix4fv, g_uniform_matrix_4fv, countUniformMatrix4fv);
+    WRAP_GL_FUNCTION(glNamedBufferData, g_named_buffer_data, countNamedBufferData);
+    WRAP_GL_FUNCTION(glNamedBufferSubData, g_named_buffer_sub_data, countNamedBufferSubData);
+    g_is_installed = true;
+}
+
+
+bool areGlCallCountersInstalled(void) {
+    return g_is_installed;
+}
+
+
+GlCallCounters takeGlCallCounters(void) {
+    GlCallCounters counters = g_counters;
+    g_counters = (GlCallCounters) { 0 };
+    return counters;
+}
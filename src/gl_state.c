@@ -0,0 +1,143 @@
+#include <stddef.h>
+
+#include "gl_state.h"
+
+
+enum {
+    CAPABILITY_BLEND,
+    CAPABILITY_DEPTH_TEST,
+    CAPABILITY_CULL_FACE,
+    N_CAPABILITIES
+};
+
+
+// Cached value with flag, unknown until first set
+typedef struct {
+    GLuint value;
+    bool is_known;
+} CachedValue;
+
+
+typedef struct {
+    CachedValue program;
+    CachedValue vao;
+    CachedValue textures[GL_STATE_N_TEXTURE_UNITS];
+    CachedValue capabilities[N_CAPABILITIES];
+    CachedValue blend_factors;  // source in high 16 bits, all blend factor enums fit in 16 bits
+    CachedValue polygon_mode;
+} GlState;
+
+
+static GlState g_state = { 0 };
+static GlStateCounters g_counters = { 0 };
+
+
+// Record requested value, true when it differs from the value in effect and must be set
+static bool updateValue(CachedValue* cached, GLuint value, GlStateKind kind) {
+    g_counters.n_requested[kind]++;
+    if (cached->is_known && cached->value == value) {
+        g_counters.n_skipped[kind]++;
+        return false;
+    }
+    cached->value = value;
+    cached->is_known = true;
+    return true;
+}
+
+
+void useGlProgram(GLuint program) {
+    if (updateValue(&g_state.program, program, STATE_PROGRAM)) {
+        glUseProgram(program);
+    }
+}
+
+
+void bindGlVertexArray(GLuint vao) {
+    if (updateValue(&g_state.vao, vao, STATE_VERTEX_ARRAY)) {
+        glBindVertexArray(vao);
+    }
+}
+
+
+void bindGlTextureUnit(GLuint unit, GLuint texture) {
+    if (unit >= GL_STATE_N_TEXTURE_UNITS) {
+        g_counters.n_requested[STATE_TEXTURE_UNIT]++;
+        glBindTextureUnit(unit, texture);
+    } else if (updateValue(&g_state.textures[unit], texture, STATE_TEXTURE_UNIT)) {
+        glBindTextureUnit(unit, texture);
+    }
+}
+
+
+static CachedValue* getCachedCapability(GLenum capability) {
+    switch (capability) {
+    case GL_BLEND:
+        return &g_state.capabilities[CAPABILITY_BLEND];
+    case GL_DEPTH_TEST:
+        return &g_state.capabilities[CAPABILITY_DEPTH_TEST];
+    case GL_CULL_FACE:
+        return &g_state.capabilities[CAPABILITY_CULL_FACE];
+    default:
+        return NULL;
+    }
+}
+
+
+void setGlCapability(GLenum capability, bool is_enabled) {
+    CachedValue* cached = getCachedCapability(capability);
+    if (!cached) {
+        g_counters.n_requested[STATE_CAPABILITY]++;
+    } else if (!updateValue(cached, is_enabled, STATE_CAPABILITY)) {
+        return;
+    }
+
+    if (is_enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+
+void setGlBlendFunc(GLenum source_factor, GLenum destination_factor) {
+    GLuint factors = source_factor << 16 | destination_factor;
+    if (updateValue(&g_state.blend_factors, factors, STATE_BLEND_FUNC)) {
+        glBlendFunc(source_factor, destination_factor);
+    }
+}
+
+
+void setGlPolygonMode(GLenum mode) {
+    if (updateValue(&g_state.polygon_mode, mode, STATE_POLYGON_MODE)) {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+
+void forgetGlTexture(GLuint texture) {
+    for (size_t unit = 0; unit < GL_STATE_N_TEXTURE_UNITS; ++unit) {
+        if (g_state.textures[unit].value == texture) {
+            g_state.textures[unit].is_known = false;
+        }
+    }
+}
+
+
+void forgetGlVertexArray(GLuint vao) {
+    if (g_state.vao.value == vao) {
+        g_state.vao.is_known = false;
+    }
+}
+
+
+const GlStateCounters* getGlStateCounters(void) {
+    return &g_counters;
+}
+
+
+const char* getGlStateKindName(GlStateKind kind) {
+    static const char* NAMES[STATE_N_KINDS] = {
+        "program", "vertex array", "texture unit", "capability", "blend func", "polygon mode"
+    };
+    return kind < STATE_N_KINDS ? NAMES[kind] : "unknown";
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+
+#include "gpu_animation.h"
+#include "gl_state.h"
+
+
+static const char COMPUTE_SHADER_PATH[] = "resources/shaders/roll_compute_shader.glsl";
+
+enum {
+    WORKGROUP_SIZE = 64,  // local_size_x of compute shader
+    DICE_INSTANCE_BINDING = 0,
+    DICE_RECORD_BINDING = 3,
+    ROLL_KEYFRAME_BINDING = 4,
+    DRAW_SLOT_BINDING = 5
+};
+
+
+static Status initUniformVariables(GLuint program, GpuAnimatorUniformVariables* uvars) {
+    Status status = STATUS_OK;
+    uvars->instance_count_id = initUniformVariable(program, "instanceCount", &status);
+    uvars->time_id = initUniformVariable(program, "time", &status);
+    uvars->view_id = initUniformVariable(program, "view", &status);
+    uvars->idle_speed_id = initUniformVariable(program, "idleSpeed", &status);
+    uvars->keyframe_count_id = initUniformVariable(program, "keyframeCount", &status);
+    uvars->max_speed_id = initUniformVariable(program, "maxSpeed", &status);
+    uvars->min_speed_id = initUniformVariable(program, "minSpeed", &status);
+    uvars->deceleration_id = initUniformVariable(program, "deceleration", &status);
+    uvars->deceleration_start_id = initUniformVariable(program, "decelerationStart", &status);
+    uvars->interpolation_id = initUniformVariable(program, "interpolation", &status);
+    return status;
+}
+
+
+Status initGpuAnimator(GpuAnimator* animator, size_t capacity, size_t n_roll_points) {
+    Status status = initComputeProgram(COMPUTE_SHADER_PATH, &animator->shader);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize roll compute program");
+        return status;
+    }
+    status = initUniformVariables(animator->shader.id, &animator->uvars);
+    if (status != STATUS_OK) {
+        freeProgram(&animator->shader);
+        return status;
+    }
+
+    animator->capacity = capacity;
+    animator->n_keyframes = n_roll_points + 1;
+
+    glCreateBuffers(1, &animator->record_buffer);
+    glNamedBufferStorage(animator->record_buffer, capacity * sizeof(GpuDiceRecord), NULL, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &animator->keyframe_buffer);
+    glNamedBufferStorage(animator->keyframe_buffer, capacity * animator->n_keyframes * sizeof(versor), NULL,
+                         GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &animator->draw_slot_buffer);
+    glNamedBufferStorage(animator->draw_slot_buffer, capacity * sizeof(GLuint), NULL, GL_DYNAMIC_STORAGE_BIT);
+    return STATUS_OK;
+}
+
+
+void freeGpuAnimator(GpuAnimator* animator) {
+    glDeleteBuffers(1, &animator->record_buffer);
+    glDeleteBuffers(1, &animator->keyframe_buffer);
+    glDeleteBuffers(1, &animator->draw_slot_buffer);
+    freeProgram(&animator->shader);
+}
+
+
+void requestGpuAnimatorShaderReload(GpuAnimator* animator, const char* file_name) {
+    if (isProgramSource(&animator->shader, file_name)) {
+        printf("Reloading roll compute shader: %s changed\n", file_name);
+        beginProgramReload(&animator->shader);
+    }
+}
+
+
+void updateGpuAnimatorShaderReload(GpuAnimator* animator) {
+    if (pollProgramReload(&animator->shader) == PROGRAM_RELOAD_LINKED) {
+        GpuAnimatorUniformVariables uvars;
+        Status status = initUniformVariables(animator->shader.pending_id, &uvars);
+        if (finishProgramReload(&animator->shader, status) == PROGRAM_RELOAD_DONE) {
+            animator->uvars = uvars;
+        }
+    }
+}
+
+
+void syncGpuAnimator(GpuAnimator* animator, DiceWorld* world) {
+    for (size_t k = 0; k < world->n_changed_slots; ++k) {
+        uint32_t slot = world->changed_slots[k];
+        size_t i = world->slots[slot].dense_index;
+        if (i >= world->n_dice || world->slot_index[i] != slot) {
+            continue;  // destroyed since
+        }
+
+        // Idle spin continues from its current angle, rolls are evaluated from their start
+        bool is_rolling = world->state[i] != DICE_STATE_IDLE;
+        GpuDiceRecord record = {
+            .position_scale = { world->position[i][0], world->position[i][1], world->position[i][2],
+                                world->scale[i] },
+            .event_time = (GLfloat)(is_rolling ? world->event_time[i] : world->time),
+            .idle_angle_deg = world->idle_angle_deg[i],
+            .is_rolling = is_rolling
+        };
+        glNamedBufferSubData(animator->record_buffer, slot * sizeof(GpuDiceRecord), sizeof(GpuDiceRecord), &record);
+
+        if (is_rolling) {
+            // Start orientation goes right before the queue, so that keyframe n - 1 precedes keyframe n
+            GLintptr offset = slot * animator->n_keyframes * sizeof(versor);
+            glNamedBufferSubData(animator->keyframe_buffer, offset, sizeof(versor), world->roll_anim[i].q_start);
+            glNamedBufferSubData(animator->keyframe_buffer, offset + sizeof(versor),
+                                 world->n_roll_points * sizeof(versor), world->roll_anim[i].q_arr);
+        }
+    }
+    clearDiceChanges(world);
+}
+
+
+void dispatchGpuAnimator(GpuAnimator* animator, const DiceWorld* world, const AnimationSettings* settings,
+                         const uint32_t* draw_slots, size_t n_instances, mat4 view, GLuint instance_buffer) {
+    if (n_instances == 0) {
+        return;
+    }
+    glNamedBufferSubData(animator->draw_slot_buffer, 0, n_instances * sizeof(GLuint), draw_slots);
+
+    RollSpeedProfile profile = getRollSpeedProfile(settings);
+    GpuAnimatorUniformVariables* uvars = &animator->uvars;
+    useGlProgram(animator->shader.id);
+    glUniform1ui(uvars->instance_count_id, (GLuint)n_instances);
+    glUniform1f(uvars->time_id, (GLfloat)world->time);
+    glUniformMatrix4fv(uvars->view_id, 1, GL_FALSE, (float*)view);
+    glUniform1f(uvars->idle_speed_id, settings->idle_rot_speed);
+    glUniform1ui(uvars->keyframe_count_id, (GLuint)world->n_roll_points);
+    glUniform1f(uvars->max_speed_id, profile.max_speed);
+    glUniform1f(uvars->min_speed_id, profile.min_speed);
+    glUniform1f(uvars->deceleration_id, profile.deceleration);
+    glUniform1f(uvars->deceleration_start_id, profile.deceleration_start);
+    glUniform1ui(uvars->interpolation_id, (GLuint)settings->interpolation);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DICE_INSTANCE_BINDING, instance_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DICE_RECORD_BINDING, animator->record_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ROLL_KEYFRAME_BINDING, animator->keyframe_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_SLOT_BINDING, animator->draw_slot_buffer);
+    glDispatchCompute((GLuint)((n_instances + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE), 1, 1);
+}
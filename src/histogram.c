@@ -0,0 +1,110 @@
+#include <string.h>
+#include <math.h>
+
+#include "histogram.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+
+static const uint64_t MAX_VALUE = ((uint64_t)1 << HISTOGRAM_VALUE_BITS) - 1;
+
+
+// Position of highest set bit of non-zero value
+static unsigned getHighestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (unsigned)index;
+#elif defined(__GNUC__)
+    return 63 - (unsigned)__builtin_clzll(value);
+#else
+    unsigned index = 0;
+    while (value >>= 1) {
+        ++index;
+    }
+    return index;
+#endif
+}
+
+
+size_t getHistogramBucketIndex(uint64_t value) {
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    if (value < 2 * HISTOGRAM_N_SUB_BUCKETS) {
+        return (size_t)value;
+    }
+    // Keep top HISTOGRAM_SUB_BUCKET_BITS + 1 bits, the leading one selects upper half of sub buckets
+    unsigned shift = getHighestBit(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    return (size_t)shift * HISTOGRAM_N_SUB_BUCKETS + (size_t)(value >> shift);
+}
+
+
+uint64_t getHistogramBucketHighestValue(size_t index) {
+    if (index < 2 * HISTOGRAM_N_SUB_BUCKETS) {
+        return index;
+    }
+    unsigned shift = (unsigned)(index / HISTOGRAM_N_SUB_BUCKETS) - 1;
+    uint64_t sub_bucket = index % HISTOGRAM_N_SUB_BUCKETS + HISTOGRAM_N_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+
+void clearHistogram(Histogram* histogram) {
+    memset(histogram->counts, 0, sizeof(histogram->counts));
+    histogram->n_values = 0;
+    histogram->sum = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+}
+
+
+void recordHistogramValue(Histogram* histogram, uint64_t value) {
+    histogram->counts[getHistogramBucketIndex(value)]++;
+    histogram->n_values++;
+    histogram->sum += value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+
+void mergeHistogram(Histogram* histogram, const Histogram* other) {
+    for (size_t i = 0; i < HISTOGRAM_N_BUCKETS; ++i) {
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->n_values += other->n_values;
+    histogram->sum += other->sum;
+    if (other->min < histogram->min) {
+        histogram->min = other->min;
+    }
+    if (other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+}
+
+
+uint64_t getHistogramPercentile(const Histogram* histogram, double percentile) {
+    if (histogram->n_values == 0) {
+        return 0;
+    }
+
+    // Nearest rank
+    double rank = ceil(percentile / 100.0 * (double)histogram->n_values);
+    uint64_t target = rank < 1.0 ? 1 : (rank > (double)histogram->n_values ? histogram->n_values : (uint64_t)rank);
+
+    uint64_t n_seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_N_BUCKETS; ++i) {
+        n_seen += histogram->counts[i];
+        if (n_seen >= target) {
+            uint64_t value = getHistogramBucketHighestValue(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
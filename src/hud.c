@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cglm/cglm.h>
+
+#include "hud.h"
+#include "allocation.h"
+#include "gl_state.h"
+
+
+static const char VERTEX_SHADER_PATH[] = "resources/shaders/hud_vertex_shader.glsl";
+static const char FRAGMENT_SHADER_PATH[] = "resources/shaders/hud_fragment_shader.glsl";
+
+
+enum {
+    HUD_VERTICES_PER_QUAD = 6,
+    HUD_N_TEXT_LINES = 4,
+    HUD_MAX_LINE_LENGTH = 96
+};
+
+// Layout in window pixels
+static const float HUD_MARGIN = 10.0f;
+static const float HUD_PADDING = 8.0f;
+static const float HUD_WIDTH = 380.0f;
+static const float HUD_TEXT_SIZE = 15.0f;
+static const float HUD_LINE_HEIGHT = 19.0f;
+static const float HUD_GRAPH_HEIGHT = 70.0f;
+static const float HUD_GRAPH_MAX_MS = 50.0f;  // top of graph
+
+// Frame time bands of the graph
+static const float HUD_TARGET_MS = 1000.0f / 60.0f;
+static const float HUD_SLOW_MS = 2.0f * 1000.0f / 60.0f;
+
+static const GLubyte PANEL_COLOR[4] = { 0, 0, 0, 170 };
+static const GLubyte TEXT_COLOR[4] = { 235, 235, 235, 255 };
+static const GLubyte GUIDE_COLOR[4] = { 255, 255, 255, 70 };
+static const GLubyte FAST_COLOR[4] = { 80, 210, 90, 255 };
+static const GLubyte SLOW_COLOR[4] = { 240, 200, 60, 255 };
+static const GLubyte STUTTER_COLOR[4] = { 240, 70, 60, 255 };
+
+
+static Status initUniformVariables(GLuint program, HudUniformVariables* uvars) {
+    Status status = STATUS_OK;
+    uvars->projection_id = initUniformVariable(program, "projection", &status);
+    return status;
+}
+
+
+static void initVertexArray(Hud* hud) {
+    glCreateBuffers(1, &hud->vbo);
+    glNamedBufferStorage(hud->vbo, HUD_MAX_QUADS * HUD_VERTICES_PER_QUAD * sizeof(HudVertex), NULL,
+                         GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateVertexArrays(1, &hud->vao);
+    glVertexArrayVertexBuffer(hud->vao, 0, hud->vbo, 0, sizeof(HudVertex));
+    glEnableVertexArrayAttrib(hud->vao, 0);
+    glVertexArrayAttribFormat(hud->vao, 0, 4, GL_FLOAT, GL_FALSE, offsetof(HudVertex, position));
+    glVertexArrayAttribBinding(hud->vao, 0, 0);
+    glEnableVertexArrayAttrib(hud->vao, 1);
+    glVertexArrayAttribFormat(hud->vao, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(HudVertex, color));
+    glVertexArrayAttribBinding(hud->vao, 1, 0);
+}
+
+
+Status initHud(Hud* hud, const TextRenderer* text) {
+    *hud = (Hud) { .text = text, .gpu_ms = -1.0f };
+    hud->vertices = allocateMemory(HUD_MAX_QUADS * HUD_VERTICES_PER_QUAD * sizeof(HudVertex));
+    if (!hud->vertices) {
+        puts("Unable to allocate HUD vertices");
+        return STATUS_ERR;
+    }
+
+    Status status = initProgram(VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH, &hud->shader);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize HUD shader program");
+        free(hud->vertices);
+        hud->vertices = NULL;
+        return status;
+    }
+    status = initUniformVariables(hud->shader.id, &hud->uvars);
+    if (status != STATUS_OK) {
+        freeProgram(&hud->shader);
+        free(hud->vertices);
+        hud->vertices = NULL;
+        return status;
+    }
+    initVertexArray(hud);
+    glCreateQueries(GL_TIME_ELAPSED, HUD_N_TIMERS, hud->timers);
+    return STATUS_OK;
+}
+
+
+void freeHud(Hud* hud) {
+    glDeleteQueries(HUD_N_TIMERS, hud->timers);
+    glDeleteBuffers(1, &hud->vbo);
+    forgetGlVertexArray(hud->vao);
+    glDeleteVertexArrays(1, &hud->vao);
+    freeProgram(&hud->shader);
+    free(hud->vertices);
+    hud->vertices = NULL;
+}
+
+
+void requestHudShaderReload(Hud* hud, const char* file_name) {
+    if (isProgramSource(&hud->shader, file_name)) {
+        printf("Reloading HUD shaders: %s changed\n", file_name);
+        beginProgramReload(&hud->shader);
+    }
+}
+
+
+void updateHudShaderReload(Hud* hud) {
+    if (pollProgramReload(&hud->shader) == PROGRAM_RELOAD_LINKED) {
+        HudUniformVariables uvars;
+        Status status = initUniformVariables(hud->shader.pending_id, &uvars);
+        if (finishProgramReload(&hud->shader, status) == PROGRAM_RELOAD_DONE) {
+            hud->uvars = uvars;
+        }
+    }
+}
+
+
+/* Timing */
+
+// Read finished timer queries, oldest first, without waiting
+static void collectTimers(Hud* hud) {
+    while (hud->n_timers > 0) {
+        GLuint timer = hud->timers[hud->timer_first];
+        GLint is_available = GL_FALSE;
+        glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (!is_available) {
+            return;
+        }
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed_ns);
+        hud->gpu_ms = (float)(elapsed_ns / 1.0e6);
+        hud->timer_first = (hud->timer_first + 1) % HUD_N_TIMERS;
+        hud->n_timers--;
+    }
+}
+
+
+void beginHudFrame(Hud* hud, double time) {
+    hud->cpu_start_time = time;
+    collectTimers(hud);
+
+    // With every query still in flight the GPU is far behind, this frame is not timed rather than waited for
+    hud->is_timing = hud->n_timers < HUD_N_TIMERS;
+    if (hud->is_timing) {
+        glBeginQuery(GL_TIME_ELAPSED, hud->timers[(hud->timer_first + hud->n_timers) % HUD_N_TIMERS]);
+    }
+}
+
+
+void endHudFrame(Hud* hud, double time, double frame_time) {
+    if (hud->is_timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        hud->n_timers++;
+        hud->is_timing = false;
+    }
+    hud->cpu_ms = (float)((time - hud->cpu_start_time) * 1000.0);
+
+    size_t slot = (hud->history_first + hud->n_history) % HUD_N_FRAMES;
+    hud->frame_ms[slot] = (float)(frame_time * 1000.0);
+    if (hud->n_history < HUD_N_FRAMES) {
+        hud->n_history++;
+    } else {
+        hud->history_first = (hud->history_first + 1) % HUD_N_FRAMES;
+    }
+}
+
+
+void setHudFrameCounters(Hud* hud, const GlCallCounters* gl_calls, uint64_t n_allocations) {
+    hud->gl_calls = *gl_calls;
+    hud->n_allocations = n_allocations;
+}
+
+
+static int compareFloats(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Nearest-rank percentile of sorted values
+static float getPercentile(const float* sorted, size_t n, float percentile) {
+    size_t rank = (size_t)ceilf(percentile / 100.0f * n);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+
+/* Vertex batch */
+
+static void addQuad(Hud* hud, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                    const GLubyte* color) {
+    if (hud->n_vertices + HUD_VERTICES_PER_QUAD > HUD_MAX_QUADS * HUD_VERTICES_PER_QUAD) {
+        return;
+    }
+    HudVertex corners[4] = {
+        { { x0, y1 }, { u0, v0 } },
+        { { x0, y0 }, { u0, v1 } },
+        { { x1, y0 }, { u1, v1 } },
+        { { x1, y1 }, { u1, v0 } }
+    };
+    static const int CORNER_ORDER[HUD_VERTICES_PER_QUAD] = { 0, 1, 2, 0, 2, 3 };
+    for (int i = 0; i < HUD_VERTICES_PER_QUAD; ++i) {
+        HudVertex* vertex = &hud->vertices[hud->n_vertices++];
+        *vertex = corners[CORNER_ORDER[i]];
+        memcpy(vertex->color, color, sizeof(vertex->color));
+    }
+}
+
+
+static void addSolidQuad(Hud* hud, float x0, float y0, float x1, float y1, const GLubyte* color) {
+    addQuad(hud, x0, y0, x1, y1, -1.0f, -1.0f, -1.0f, -1.0f, color);
+}
+
+
+static void addTextLine(Hud* hud, const char* line, float x, float y) {
+    TextQuad quads[HUD_MAX_LINE_LENGTH];
+    size_t n_quads = layoutText(hud->text, line, HUD_TEXT_SIZE, x, y, quads, HUD_MAX_LINE_LENGTH);
+    for (size_t i = 0; i < n_quads; ++i) {
+        const TextQuad* q = &quads[i];
+        addQuad(hud, q->x0, q->y0, q->x1, q->y1, q->u0, q->v0, q->u1, q->v1, TEXT_COLOR);
+    }
+}
+
+
+static const GLubyte* getFrameColor(float frame_ms) {
+    if (frame_ms <= HUD_TARGET_MS * 1.05f) {
+        return FAST_COLOR;
+    }
+    return frame_ms <= HUD_SLOW_MS * 1.05f ? SLOW_COLOR : STUTTER_COLOR;
+}
+
+
+// Bars of frame times, newest at the right edge
+static void addGraph(Hud* hud, float x0, float y0, float width) {
+    float bar_width = width / HUD_N_FRAMES;
+    float scale = HUD_GRAPH_HEIGHT / HUD_GRAPH_MAX_MS;
+    float x = x0 + width - hud->n_history * bar_width;
+    for (size_t i = 0; i < hud->n_history; ++i) {
+        float frame_ms = hud->frame_ms[(hud->history_first + i) % HUD_N_FRAMES];
+        float height = fminf(frame_ms, HUD_GRAPH_MAX_MS) * scale;
+        addSolidQuad(hud, x, y0, x + bar_width, y0 + fmaxf(height, 1.0f), getFrameColor(frame_ms));
+        x += bar_width;
+    }
+
+    // Guides at 60 and 30 FPS
+    addSolidQuad(hud, x0, y0 + HUD_TARGET_MS * scale, x0 + width, y0 + HUD_TARGET_MS * scale + 1.0f, GUIDE_COLOR);
+    addSolidQuad(hud, x0, y0 + HUD_SLOW_MS * scale, x0 + width, y0 + HUD_SLOW_MS * scale + 1.0f, GUIDE_COLOR);
+}
+
+
+static void addStatistics(Hud* hud, float x, float y) {
+    float sorted[HUD_N_FRAMES];
+    size_t n = hud->n_history;
+    for (size_t i = 0; i < n; ++i) {
+        sorted[i] = hud->frame_ms[(hud->history_first + i) % HUD_N_FRAMES];
+    }
+    qsort(sorted, n, sizeof(float), compareFloats);
+
+    char lines[HUD_N_TEXT_LINES][HUD_MAX_LINE_LENGTH];
+    if (n > 0) {
+        snprintf(lines[0], HUD_MAX_LINE_LENGTH, "frame p50 %.1f  p95 %.1f  p99 %.1f  max %.1f ms",
+                 getPercentile(sorted, n, 50.0f), getPercentile(sorted, n, 95.0f), getPercentile(sorted, n, 99.0f),
+                 sorted[n - 1]);
+    } else {
+        snprintf(lines[0], HUD_MAX_LINE_LENGTH, "frame -");
+    }
+    // Average rate over the graph
+    float total_ms = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        total_ms += sorted[i];
+    }
+    float fps = total_ms > 0.0f ? 1000.0f * n / total_ms : 0.0f;
+    if (hud->gpu_ms >= 0.0f) {
+        snprintf(lines[1], HUD_MAX_LINE_LENGTH, "%.0f FPS  cpu %.2f ms  gpu %.2f ms", fps, hud->cpu_ms, hud->gpu_ms);
+    } else {
+        snprintf(lines[1], HUD_MAX_LINE_LENGTH, "%.0f FPS  cpu %.2f ms  gpu -", fps, hud->cpu_ms);
+    }
+    const GlCallCounters* calls = &hud->gl_calls;
+    snprintf(lines[2], HUD_MAX_LINE_LENGTH, "draws %llu  dispatches %llu  state %llu  textures %llu",
+             (unsigned long long)calls->n_draw_calls, (unsigned long long)calls->n_dispatches,
+             (unsigned long long)calls->n_state_changes, (unsigned long long)calls->n_texture_binds);
+    snprintf(lines[3], HUD_MAX_LINE_LENGTH, "uniforms %llu  upload %.1f KB  allocations %llu",
+             (unsigned long long)calls->n_uniform_updates, calls->n_upload_bytes / 1024.0,
+             (unsigned long long)hud->n_allocations);
+
+    for (int i = 0; i < HUD_N_TEXT_LINES; ++i) {
+        addTextLine(hud, lines[i], x, y - i * HUD_LINE_HEIGHT);
+    }
+}
+
+
+void renderHud(Hud* hud, float window_width, float window_height) {
+    // Panel in top-left corner: text lines above graph
+    float text_height = HUD_N_TEXT_LINES * HUD_LINE_HEIGHT;
+    float panel_height = 3.0f * HUD_PADDING + text_height + HUD_GRAPH_HEIGHT;
+    float x0 = HUD_MARGIN, y1 = window_height - HUD_MARGIN;
+    float y0 = y1 - panel_height;
+
+    hud->n_vertices = 0;
+    addSolidQuad(hud, x0, y0, x0 + HUD_WIDTH, y1, PANEL_COLOR);
+    addGraph(hud, x0 + HUD_PADDING, y0 + HUD_PADDING, HUD_WIDTH - 2.0f * HUD_PADDING);
+    addStatistics(hud, x0 + HUD_PADDING, y1 - HUD_PADDING - HUD_TEXT_SIZE);
+
+    mat4 projection;
+    glm_ortho(0.0f, window_width, 0.0f, window_height, 0.0f, 1.0f, projection);
+    useGlProgram(hud->shader.id);
+    glUniformMatrix4fv(hud->uvars.projection_id, 1, GL_FALSE, (float*)projection);
+    bindGlVertexArray(hud->vao);
+    bindGlTextureUnit(0, hud->text->atlas_texture);
+    glNamedBufferSubData(hud->vbo, 0, hud->n_vertices * sizeof(HudVertex), hud->vertices);
+
+    // Overlay is drawn in order, glyphs over panel at the same depth
+    setGlCapability(GL_DEPTH_TEST, false);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)hud->n_vertices);
+    setGlCapability(GL_DEPTH_TEST, true);
+}
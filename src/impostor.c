@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "impostor.h"
+#include "allocation.h"
+#include "gl_state.h"
+
+
+static const char VERTEX_SHADER_PATH[] = "resources/shaders/impostor_vertex_shader.glsl";
+static const char FRAGMENT_SHADER_PATH[] = "resources/shaders/impostor_fragment_shader.glsl";
+
+enum {
+    IMPOSTOR_ATLAS_SIZE = IMPOSTOR_GRID_SIZE * IMPOSTOR_CELL_SIZE,
+    IMPOSTOR_MAX_MIP_LEVEL = 4,  // lower levels would blend neighbouring cells
+    IMPOSTOR_INSTANCE_BINDING = 1
+};
+
+
+static float signNotZero(float x) {
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+
+// Map unit direction to [0, 1]^2: project onto octahedron, unfold lower half outwards
+static void encodeOctahedral(const vec3 dir, float* u, float* v) {
+    float l1 = fabsf(dir[0]) + fabsf(dir[1]) + fabsf(dir[2]);
+    float x = dir[0] / l1, y = dir[1] / l1;
+    if (dir[2] < 0.0f) {
+        float x_prev = x;
+        x = (1.0f - fabsf(y)) * signNotZero(x_prev);
+        y = (1.0f - fabsf(x_prev)) * signNotZero(y);
+    }
+    *u = x * 0.5f + 0.5f;
+    *v = y * 0.5f + 0.5f;
+}
+
+
+static void decodeOctahedral(float u, float v, vec3 dir) {
+    float x = u * 2.0f - 1.0f, y = v * 2.0f - 1.0f;
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    if (z < 0.0f) {
+        float x_prev = x;
+        x = (1.0f - fabsf(y)) * signNotZero(x_prev);
+        y = (1.0f - fabsf(x_prev)) * signNotZero(y);
+    }
+    dir[0] = x;
+    dir[1] = y;
+    dir[2] = z;
+    glm_vec3_normalize(dir);
+}
+
+
+void getImpostorCellBasis(int cell_x, int cell_y, vec3 right, vec3 up, vec3 dir) {
+    decodeOctahedral((cell_x + 0.5f) / IMPOSTOR_GRID_SIZE, (cell_y + 0.5f) / IMPOSTOR_GRID_SIZE, dir);
+
+    // Any up works as long as runtime uses the same one, avoid the one parallel to dir
+    vec3 up_ref = { 0.0f, 1.0f, 0.0f };
+    if (fabsf(dir[1]) > 0.99f) {
+        glm_vec3_copy((vec3) { 0.0f, 0.0f, 1.0f }, up_ref);
+    }
+    glm_vec3_crossn(up_ref, dir, right);
+    glm_vec3_cross(dir, right, up);
+}
+
+
+static Status initAtlas(ImpostorRenderer* impostor, size_t n_layers) {
+    impostor->n_layers = n_layers;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &impostor->atlas_texture);
+    glTextureStorage3D(impostor->atlas_texture, IMPOSTOR_MAX_MIP_LEVEL + 1, GL_RGBA8,
+                       IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, n_layers);
+    glTextureParameteri(impostor->atlas_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(impostor->atlas_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(impostor->atlas_texture, GL_TEXTURE_MAX_LEVEL, IMPOSTOR_MAX_MIP_LEVEL);
+    glTextureParameteri(impostor->atlas_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(impostor->atlas_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glCreateRenderbuffers(1, &impostor->depth_buffer);
+    glNamedRenderbufferStorage(impostor->depth_buffer, GL_DEPTH_COMPONENT24, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+
+    glCreateFramebuffers(1, &impostor->framebuffer);
+    glNamedFramebufferTextureLayer(impostor->framebuffer, GL_COLOR_ATTACHMENT0, impostor->atlas_texture, 0, 0);
+    glNamedFramebufferRenderbuffer(impostor->framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                   impostor->depth_buffer);
+
+    if (glCheckNamedFramebufferStatus(impostor->framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        puts("Impostor framebuffer is incomplete");
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+static void freeAtlas(ImpostorRenderer* impostor) {
+    glDeleteFramebuffers(1, &impostor->framebuffer);
+    glDeleteRenderbuffers(1, &impostor->depth_buffer);
+    forgetGlTexture(impostor->atlas_texture);
+    glDeleteTextures(1, &impostor->atlas_texture);
+}
+
+
+static Status initUniformVariables(GLuint program, ImpostorUniformVariables* uvars) {
+    Status status = STATUS_OK;
+    uvars->projection_id = initUniformVariable(program, "projection", &status);
+    uvars->grid_size_id = initUniformVariable(program, "gridSize", &status);
+    return status;
+}
+
+
+Status initImpostorRenderer(ImpostorRenderer* impostor, size_t n_layers, size_t max_dice) {
+    Status status = initAtlas(impostor, n_layers);
+    if (status != STATUS_OK) {
+        freeAtlas(impostor);
+        return status;
+    }
+
+    impostor->instances = allocateMemory(max_dice * sizeof(ImpostorInstance));
+    if (!impostor->instances) {
+        puts("Unable to allocate impostor instances");
+        freeAtlas(impostor);
+        return STATUS_ERR;
+    }
+    impostor->instance_capacity = max_dice;
+    impostor->n_instances = 0;
+    glCreateBuffers(1, &impostor->instance_buffer);
+    glNamedBufferStorage(impostor->instance_buffer, max_dice * sizeof(ImpostorInstance), NULL,
+                         GL_DYNAMIC_STORAGE_BIT);
+    glCreateVertexArrays(1, &impostor->vao);
+
+    status = initProgram(VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH, &impostor->shader);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize impostor shader program");
+        freeImpostorRenderer(impostor);
+        return status;
+    }
+    status = initUniformVariables(impostor->shader.id, &impostor->uvars);
+    if (status != STATUS_OK) {
+        freeImpostorRenderer(impostor);
+    }
+    return status;
+}
+
+
+void freeImpostorRenderer(ImpostorRenderer* impostor) {
+    freeAtlas(impostor);
+    forgetGlVertexArray(impostor->vao);
+    glDeleteVertexArrays(1, &impostor->vao);
+    glDeleteBuffers(1, &impostor->instance_buffer);
+    free(impostor->instances);
+    impostor->instances = NULL;
+    freeProgram(&impostor->shader);
+}
+
+
+void requestImpostorShaderReload(ImpostorRenderer* impostor, const char* file_name) {
+    if (isProgramSource(&impostor->shader, file_name)) {
+        printf("Reloading impostor shaders: %s changed\n", file_name);
+        beginProgramReload(&impostor->shader);
+    }
+}
+
+
+void updateImpostorShaderReload(ImpostorRenderer* impostor) {
+    if (pollProgramReload(&impostor->shader) == PROGRAM_RELOAD_LINKED) {
+        ImpostorUniformVariables uvars;
+        Status status = initUniformVariables(impostor->shader.pending_id, &uvars);
+        if (finishProgramReload(&impostor->shader, status) == PROGRAM_RELOAD_DONE) {
+            impostor->uvars = uvars;
+        }
+    }
+}
+
+
+void beginImpostorLayerCapture(ImpostorRenderer* impostor, int layer) {
+    glNamedFramebufferTextureLayer(impostor->framebuffer, GL_COLOR_ATTACHMENT0, impostor->atlas_texture, 0, layer);
+
+    const GLfloat transparent[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat far_depth = 1.0f;
+    glClearNamedFramebufferfv(impostor->framebuffer, GL_COLOR, 0, transparent);
+    glClearNamedFramebufferfv(impostor->framebuffer, GL_DEPTH, 0, &far_depth);
+    glBindFramebuffer(GL_FRAMEBUFFER, impostor->framebuffer);
+}
+
+
+void beginImpostorCellCapture(ImpostorRenderer* impostor, int cell_x, int cell_y) {
+    glViewport(cell_x * IMPOSTOR_CELL_SIZE, cell_y * IMPOSTOR_CELL_SIZE, IMPOSTOR_CELL_SIZE, IMPOSTOR_CELL_SIZE);
+}
+
+
+void addImpostorInstance(ImpostorRenderer* impostor, int layer, vec3 view_center, versor view_rotation,
+                         float radius) {
+    if (impostor->n_instances == impostor->instance_capacity) {
+        return;
+    }
+
+    // Bring camera direction and screen up into model space
+    versor inverse_rotation;
+    glm_quat_inv(view_rotation, inverse_rotation);
+    vec3 to_camera, dir;
+    glm_vec3_negate_to(view_center, to_camera);
+    glm_vec3_normalize(to_camera);
+    glm_quat_rotatev(inverse_rotation, to_camera, dir);
+    vec3 screen_up;
+    glm_quat_rotatev(inverse_rotation, (vec3) { 0.0f, 1.0f, 0.0f }, screen_up);
+
+    // Nearest captured direction
+    float u, v;
+    encodeOctahedral(dir, &u, &v);
+    int cell_x = glm_clamp(u * IMPOSTOR_GRID_SIZE, 0.0f, IMPOSTOR_GRID_SIZE - 1);
+    int cell_y = glm_clamp(v * IMPOSTOR_GRID_SIZE, 0.0f, IMPOSTOR_GRID_SIZE - 1);
+
+    // Roll: where screen up points in the captured image
+    vec3 cell_right, cell_up, cell_dir;
+    getImpostorCellBasis(cell_x, cell_y, cell_right, cell_up, cell_dir);
+    float up_x = glm_vec3_dot(screen_up, cell_right);
+    float up_y = glm_vec3_dot(screen_up, cell_up);
+    float up_length = sqrtf(up_x * up_x + up_y * up_y);
+    if (up_length < 1e-6f) {
+        up_x = 0.0f;
+        up_y = up_length = 1.0f;
+    }
+
+    ImpostorInstance* instance = &impostor->instances[impostor->n_instances++];
+    glm_vec4_copy((vec4) { view_center[0], view_center[1], view_center[2], radius }, instance->center_radius);
+    glm_vec4_copy((vec4) { cell_x, cell_y, up_x / up_length, up_y / up_length }, instance->cell_up);
+    instance->layer = layer;
+}
+
+
+void renderImpostors(ImpostorRenderer* impostor, mat4 projection) {
+    size_t n = impostor->n_instances;
+    impostor->n_instances = 0;  // instances are collected anew every frame
+    if (n == 0) {
+        return;
+    }
+
+    glNamedBufferSubData(impostor->instance_buffer, 0, n * sizeof(ImpostorInstance), impostor->instances);
+
+    useGlProgram(impostor->shader.id);
+    glUniformMatrix4fv(impostor->uvars.projection_id, 1, GL_FALSE, (float*)projection);
+    glUniform1f(impostor->uvars.grid_size_id, IMPOSTOR_GRID_SIZE);
+
+    bindGlVertexArray(impostor->vao);
+    bindGlTextureUnit(0, impostor->atlas_texture);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IMPOSTOR_INSTANCE_BINDING, impostor->instance_buffer);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, n);
+}
+
+
+void finishImpostorAtlas(ImpostorRenderer* impostor) {
+    glGenerateTextureMipmap(impostor->atlas_texture);
+}
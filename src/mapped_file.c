@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+
+Status mapFile(const char* path, MappedFile* file) {
+    HANDLE file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        printf("Unable to open file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_handle, &size) || size.QuadPart == 0) {
+        printf("Unable to map empty file: %s\n", path);
+        CloseHandle(file_handle);
+        return STATUS_ERR;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file_handle);  // mapping keeps the file open
+    if (!mapping) {
+        printf("Unable to map file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        printf("Unable to map file: %s\n", path);
+        CloseHandle(mapping);
+        return STATUS_ERR;
+    }
+
+    file->data = data;
+    file->size = (size_t)size.QuadPart;
+    file->handle = mapping;
+    return STATUS_OK;
+}
+
+
+void unmapFile(MappedFile* file) {
+    UnmapViewOfFile(file->data);
+    CloseHandle(file->handle);
+    file->data = NULL;
+    file->size = 0;
+}
+
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+Status mapFile(const char* path, MappedFile* file) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        printf("Unable to open file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        printf("Unable to map empty file: %s\n", path);
+        close(fd);
+        return STATUS_ERR;
+    }
+
+    void* data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // mapping keeps the file open
+    if (data == MAP_FAILED) {
+        printf("Unable to map file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    file->data = data;
+    file->size = (size_t)file_stat.st_size;
+    file->handle = NULL;
+    return STATUS_OK;
+}
+
+
+void unmapFile(MappedFile* file) {
+    munmap((void*)file->data, file->size);
+    file->data = NULL;
+    file->size = 0;
+}
+
+#endif
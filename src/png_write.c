@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "png_write.h"
+
+
+enum {
+    MAX_STORED_BLOCK_SIZE = 65535  // deflate stored block length is 16 bit
+};
+
+typedef struct {
+    FILE* file;
+    uint32_t crc_table[256];  // built per image, so images can be written from several threads
+    uint32_t crc;  // of current chunk type and data
+    uint32_t adler_a;  // zlib checksum of uncompressed data
+    uint32_t adler_b;
+    size_t data_left;  // uncompressed bytes not written yet
+    size_t block_left;  // bytes left in current stored block
+} PngWriter;
+
+
+static void initCrcTable(uint32_t* table) {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+}
+
+
+static uint32_t updateCrc(const uint32_t* table, uint32_t crc, const unsigned char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+
+static void writeU32(FILE* file, uint32_t value) {
+    unsigned char bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+    fwrite(bytes, 4, 1, file);
+}
+
+
+static void beginChunk(PngWriter* writer, const char* type, uint32_t size) {
+    writeU32(writer->file, size);
+    fwrite(type, 4, 1, writer->file);
+    writer->crc = updateCrc(writer->crc_table, 0xFFFFFFFFu, (const unsigned char*)type, 4);
+}
+
+
+static void writeChunkData(PngWriter* writer, const void* data, size_t size) {
+    fwrite(data, size, 1, writer->file);
+    writer->crc = updateCrc(writer->crc_table, writer->crc, data, size);
+}
+
+
+static void endChunk(PngWriter* writer) {
+    writeU32(writer->file, writer->crc ^ 0xFFFFFFFFu);
+}
+
+
+// Append uncompressed bytes to zlib stream, starting a new stored block whenever the previous one is full
+static void writeImageData(PngWriter* writer, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        if (writer->block_left == 0) {
+            size_t block_size = writer->data_left < MAX_STORED_BLOCK_SIZE ? writer->data_left : MAX_STORED_BLOCK_SIZE;
+            unsigned char block_header[5] = {
+                block_size == writer->data_left,  // last block
+                block_size & 0xFF, block_size >> 8, ~block_size & 0xFF, (~block_size >> 8) & 0xFF
+            };
+            writeChunkData(writer, block_header, sizeof(block_header));
+            writer->block_left = block_size;
+        }
+
+        size_t n = size < writer->block_left ? size : writer->block_left;
+        for (size_t i = 0; i < n; ++i) {
+            writer->adler_a = (writer->adler_a + data[i]) % 65521;
+            writer->adler_b = (writer->adler_b + writer->adler_a) % 65521;
+        }
+        writeChunkData(writer, data, n);
+        data += n;
+        size -= n;
+        writer->block_left -= n;
+        writer->data_left -= n;
+    }
+}
+
+
+Status writePng(const char* path, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t n_channels) {
+    static const unsigned char SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const unsigned char COLOR_TYPES[] = { 0, 0, 0, 2, 6 };  // by number of channels
+    if ((n_channels != 1 && n_channels != 3 && n_channels != 4) || width == 0 || height == 0) {
+        return STATUS_ERR;
+    }
+    // Every row starts with filter type 0 (none)
+    size_t row_size = (size_t)width * n_channels;
+    size_t data_size = (row_size + 1) * height;
+    size_t n_blocks = (data_size + MAX_STORED_BLOCK_SIZE - 1) / MAX_STORED_BLOCK_SIZE;
+
+    PngWriter writer = { .file = fopen(path, "wb"), .adler_a = 1, .adler_b = 0, .data_left = data_size };
+    if (!writer.file) {
+        printf("Unable to create %s\n", path);
+        return STATUS_ERR;
+    }
+    initCrcTable(writer.crc_table);
+    fwrite(SIGNATURE, sizeof(SIGNATURE), 1, writer.file);
+
+    unsigned char header[13] = {
+        width >> 24, width >> 16, width >> 8, width,
+        height >> 24, height >> 16, height >> 8, height,
+        8, COLOR_TYPES[n_channels], 0, 0, 0
+    };
+    beginChunk(&writer, "IHDR", sizeof(header));
+    writeChunkData(&writer, header, sizeof(header));
+    endChunk(&writer);
+
+    // zlib header, stored blocks of rows, Adler-32 trailer
+    beginChunk(&writer, "IDAT", (uint32_t)(2 + n_blocks * 5 + data_size + 4));
+    const unsigned char zlib_header[2] = { 0x78, 0x01 };
+    writeChunkData(&writer, zlib_header, sizeof(zlib_header));
+    for (uint32_t y = 0; y < height; ++y) {
+        const unsigned char filter = 0;
+        writeImageData(&writer, &filter, 1);
+        writeImageData(&writer, pixels + y * row_size, row_size);
+    }
+    unsigned char adler[4] = { writer.adler_b >> 8, writer.adler_b, writer.adler_a >> 8, writer.adler_a };
+    writeChunkData(&writer, adler, sizeof(adler));
+    endChunk(&writer);
+
+    beginChunk(&writer, "IEND", 0);
+    endChunk(&writer);
+
+    bool is_ok = !ferror(writer.file);
+    if (fclose(writer.file) != 0 || !is_ok) {
+        printf("Unable to write %s\n", path);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
@@ -0,0 +1,479 @@
+#include <stdbool.h>
+#include <assert.h>
+#include <math.h>
+
+#include <cglm/cglm.h>
+
+#include "polyhedron.h"
+
+// Golden ratio (1 + sqrt(5)) / 2
+#define GR 1.6180339887498948482045868343656
+
+enum {
+    MAX_POLYHEDRON_VERTICES = 20,
+    MAX_FACE_VERTICES = 5
+};
+
+static const float EPSILON = 1e-4f;
+static const float DECAL_OFFSET = 1e-3f;  // number triangle is lifted above polygon face to avoid z-fighting
+static const float DECAL_SCALE = 0.95f;  // number triangle circumradius relative to face inradius
+static const float BACKGROUND_UV_SHIFT = 0.15f;  // from d20 face corner towards its center
+
+static const GLfloat DEFAULT_VERTEX_COLOR[] = { 0.8f, 0.8f, 0.8f };
+
+static bool g_is_initialized = false;
+
+DiceMesh gDiceMeshes[DICE_N_TYPES];
+Vertex gDiceVertices[DICE_MAX_VERTICES];
+GLuint gDiceIndices[DICE_MAX_INDICES];
+size_t gDiceVertexCount = 0;
+size_t gDiceIndexCount = 0;
+
+
+typedef struct {
+    size_t n_vertices;
+    size_t vertices[MAX_FACE_VERTICES];  // counter-clockwise seen from outside, first is orientation vertex
+    vec3 normal;
+    vec3 center;
+} PolyhedronFace;
+
+
+/* Vertex sets, faces are found as convex hull */
+
+static size_t getTetrahedronVertices(vec3* points) {
+    const float v[][3] = { { 1, 1, 1 }, { 1, -1, -1 }, { -1, 1, -1 }, { -1, -1, 1 } };
+    for (size_t i = 0; i < 4; ++i) {
+        glm_vec3_copy((float*)v[i], points[i]);
+    }
+    return 4;
+}
+
+
+static size_t getCubeVertices(vec3* points) {
+    for (size_t i = 0; i < 8; ++i) {
+        points[i][0] = (i & 1) ? 1.0f : -1.0f;
+        points[i][1] = (i & 2) ? 1.0f : -1.0f;
+        points[i][2] = (i & 4) ? 1.0f : -1.0f;
+    }
+    return 8;
+}
+
+
+static size_t getOctahedronVertices(vec3* points) {
+    for (size_t i = 0; i < 6; ++i) {
+        glm_vec3_copy((vec3) { 0.0f, 0.0f, 0.0f }, points[i]);
+        points[i][i / 2] = (i & 1) ? -1.0f : 1.0f;
+    }
+    return 6;
+}
+
+
+// Pentagonal trapezohedron: two apexes and a zig-zag ring of 10 vertices.
+// Apex height is chosen so that each kite face is planar
+static size_t getTrapezohedronVertices(vec3* points) {
+    const float ring_z = 0.12f;
+    const float c = cosf(GLM_PIf / 5.0f);
+    const float apex_z = ring_z * (1.0f + c) / (1.0f - c);
+
+    glm_vec3_copy((vec3) { 0.0f, 0.0f, apex_z }, points[0]);
+    glm_vec3_copy((vec3) { 0.0f, 0.0f, -apex_z }, points[1]);
+    for (size_t i = 0; i < 10; ++i) {
+        float angle = i * GLM_PIf / 5.0f;
+        points[2 + i][0] = cosf(angle);
+        points[2 + i][1] = sinf(angle);
+        points[2 + i][2] = (i % 2 == 0) ? ring_z : -ring_z;
+    }
+    return 12;
+}
+
+
+static size_t getDodecahedronVertices(vec3* points) {
+    size_t n = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        points[n][0] = (i & 1) ? 1.0f : -1.0f;
+        points[n][1] = (i & 2) ? 1.0f : -1.0f;
+        points[n][2] = (i & 4) ? 1.0f : -1.0f;
+        ++n;
+    }
+    // Cyclic permutations of (0, +-1/GR, +-GR)
+    for (size_t axis = 0; axis < 3; ++axis) {
+        for (size_t i = 0; i < 4; ++i) {
+            points[n][axis] = 0.0f;
+            points[n][(axis + 1) % 3] = (i & 1) ? -1.0f / GR : 1.0f / GR;
+            points[n][(axis + 2) % 3] = (i & 2) ? -GR : GR;
+            ++n;
+        }
+    }
+    return n;
+}
+
+
+/* Face search */
+
+static bool isKnownFace(const PolyhedronFace* faces, size_t n_faces, const vec3 normal) {
+    for (size_t f = 0; f < n_faces; ++f) {
+        if (glm_vec3_dot((float*)faces[f].normal, (float*)normal) > 1.0f - EPSILON) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Order face vertices counter-clockwise around outward normal, starting from orientation vertex,
+// which is the one farthest from face center (kite apex for d10)
+static void sortFaceVertices(PolyhedronFace* face, const vec3* points) {
+    size_t n = face->n_vertices;
+    glm_vec3_copy((vec3) { 0.0f, 0.0f, 0.0f }, face->center);
+    for (size_t v = 0; v < n; ++v) {
+        glm_vec3_add(face->center, (float*)points[face->vertices[v]], face->center);
+    }
+    glm_vec3_scale(face->center, 1.0f / n, face->center);
+
+    size_t first = 0;
+    float max_distance = 0.0f;
+    for (size_t v = 0; v < n; ++v) {
+        vec3 d;
+        glm_vec3_sub((float*)points[face->vertices[v]], face->center, d);
+        if (glm_vec3_norm(d) > max_distance + EPSILON) {
+            max_distance = glm_vec3_norm(d);
+            first = v;
+        }
+    }
+
+    vec3 u, w;
+    glm_vec3_sub((float*)points[face->vertices[first]], face->center, u);
+    glm_vec3_normalize(u);
+    glm_vec3_cross(face->normal, u, w);
+
+    float angles[MAX_FACE_VERTICES];
+    for (size_t v = 0; v < n; ++v) {
+        vec3 d;
+        glm_vec3_sub((float*)points[face->vertices[v]], face->center, d);
+        float angle = atan2f(glm_vec3_dot(d, w), glm_vec3_dot(d, u));
+        angles[v] = v == first ? 0.0f : (angle < 0.0f ? angle + 2.0f * GLM_PIf : angle);
+    }
+
+    // Insertion sort by angle, orientation vertex has angle 0 and comes first
+    for (size_t i = 1; i < n; ++i) {
+        for (size_t j = i; j > 0 && angles[j - 1] > angles[j]; --j) {
+            float angle = angles[j];
+            angles[j] = angles[j - 1];
+            angles[j - 1] = angle;
+            size_t vertex = face->vertices[j];
+            face->vertices[j] = face->vertices[j - 1];
+            face->vertices[j - 1] = vertex;
+        }
+    }
+}
+
+
+// Every plane through three vertices that has all other vertices behind it is a face
+static size_t findFaces(const vec3* points, size_t n_points, PolyhedronFace* faces) {
+    size_t n_faces = 0;
+    for (size_t i = 0; i < n_points - 2; ++i) {
+        for (size_t j = i + 1; j < n_points - 1; ++j) {
+            for (size_t k = j + 1; k < n_points; ++k) {
+                vec3 v1, v2, normal;
+                glm_vec3_sub((float*)points[j], (float*)points[i], v1);
+                glm_vec3_sub((float*)points[k], (float*)points[i], v2);
+                glm_vec3_cross(v1, v2, normal);
+                if (glm_vec3_norm(normal) < EPSILON) {
+                    continue;  // collinear
+                }
+                glm_vec3_normalize(normal);
+
+                // Polyhedron is centered at origin, so outward normal points away from it
+                float plane_distance = glm_vec3_dot(normal, (float*)points[i]);
+                if (plane_distance < 0.0f) {
+                    glm_vec3_negate(normal);
+                    plane_distance = -plane_distance;
+                }
+
+                bool is_supporting = true;
+                for (size_t p = 0; p < n_points && is_supporting; ++p) {
+                    is_supporting = glm_vec3_dot(normal, (float*)points[p]) <= plane_distance + EPSILON;
+                }
+                if (!is_supporting || isKnownFace(faces, n_faces, normal)) {
+                    continue;
+                }
+
+                assert(n_faces < DICE_MAX_FACES);
+                PolyhedronFace* face = &faces[n_faces++];
+                glm_vec3_copy(normal, face->normal);
+                face->n_vertices = 0;
+                for (size_t p = 0; p < n_points; ++p) {
+                    if (fabsf(glm_vec3_dot(normal, (float*)points[p]) - plane_distance) < EPSILON) {
+                        assert(face->n_vertices < MAX_FACE_VERTICES);
+                        face->vertices[face->n_vertices++] = p;
+                    }
+                }
+                sortFaceVertices(face, points);
+            }
+        }
+    }
+    return n_faces;
+}
+
+
+// Values go from 1 in order of faces, opposite faces sum up to n_faces + 1 when they exist
+static void assignFaceValues(const PolyhedronFace* faces, size_t n_faces, int* values) {
+    bool is_used[DICE_MAX_FACES + 1] = { false };
+    for (size_t f = 0; f < n_faces; ++f) {
+        values[f] = 0;
+    }
+
+    for (size_t f = 0; f < n_faces; ++f) {
+        if (values[f] != 0) {
+            continue;
+        }
+        int value = 1;
+        while (is_used[value]) {
+            ++value;
+        }
+        values[f] = value;
+        is_used[value] = true;
+
+        for (size_t g = f + 1; g < n_faces; ++g) {
+            if (glm_vec3_dot((float*)faces[f].normal, (float*)faces[g].normal) < -1.0f + EPSILON) {
+                values[g] = (int)n_faces + 1 - value;
+                is_used[values[g]] = true;
+                break;
+            }
+        }
+    }
+}
+
+
+/* Mesh building */
+
+// Texture coordinates of d20 face showing the same value, starting from its orientation vertex
+static void getValueTextureCoords(int dice_value, vec2 uv[3]) {
+    size_t face_idx = getIcosahedronFaceIndex(dice_value);
+    size_t orientation = getOrientationVertexIndex(face_idx);
+    for (size_t v = 0; v < 3; ++v) {
+        const Vertex* vertex = &gIcosahedronMesh[face_idx * 3 + (orientation + v) % 3];
+        uv[v][0] = vertex->t_x;
+        uv[v][1] = vertex->t_y;
+    }
+}
+
+
+// Point near d20 face corner, outside of the printed number
+static void getBackgroundTextureCoords(int dice_value, vec2 uv) {
+    vec2 face_uv[3];
+    getValueTextureCoords(dice_value, face_uv);
+    for (size_t c = 0; c < 2; ++c) {
+        float center = (face_uv[0][c] + face_uv[1][c] + face_uv[2][c]) / 3.0f;
+        uv[c] = face_uv[0][c] + (center - face_uv[0][c]) * BACKGROUND_UV_SHIFT;
+    }
+}
+
+
+static GLuint addVertex(const vec3 position, const vec3 normal, const vec2 uv) {
+    assert(gDiceVertexCount < DICE_MAX_VERTICES);
+    Vertex* vertex = &gDiceVertices[gDiceVertexCount];
+    vertex->x = position[0];
+    vertex->y = position[1];
+    vertex->z = position[2];
+    vertex->r = DEFAULT_VERTEX_COLOR[0];
+    vertex->g = DEFAULT_VERTEX_COLOR[1];
+    vertex->b = DEFAULT_VERTEX_COLOR[2];
+    glm_vec3_copy((float*)normal, vertex->n);
+    vertex->t_x = uv[0];
+    vertex->t_y = uv[1];
+    return (GLuint)gDiceVertexCount++;
+}
+
+
+static void addTriangle(GLuint base_vertex, GLuint a, GLuint b, GLuint c) {
+    assert(gDiceIndexCount + 3 <= DICE_MAX_INDICES);
+    gDiceIndices[gDiceIndexCount++] = a - base_vertex;
+    gDiceIndices[gDiceIndexCount++] = b - base_vertex;
+    gDiceIndices[gDiceIndexCount++] = c - base_vertex;
+}
+
+
+// Triangular faces take the d20 number triangle directly. Other faces are filled with
+// background color and get the number triangle inscribed on top
+static void addFace(const PolyhedronFace* face, const vec3* points, float scale, int dice_value,
+                    GLuint base_vertex) {
+    vec2 value_uv[3];
+    getValueTextureCoords(dice_value, value_uv);
+
+    vec3 corners[MAX_FACE_VERTICES];
+    for (size_t v = 0; v < face->n_vertices; ++v) {
+        glm_vec3_scale((float*)points[face->vertices[v]], scale, corners[v]);
+    }
+
+    if (face->n_vertices == 3) {
+        GLuint a = addVertex(corners[0], face->normal, value_uv[0]);
+        GLuint b = addVertex(corners[1], face->normal, value_uv[1]);
+        GLuint c = addVertex(corners[2], face->normal, value_uv[2]);
+        addTriangle(base_vertex, a, b, c);
+        return;
+    }
+
+    vec2 background_uv;
+    getBackgroundTextureCoords(dice_value, background_uv);
+    GLuint fan[MAX_FACE_VERTICES];
+    for (size_t v = 0; v < face->n_vertices; ++v) {
+        fan[v] = addVertex(corners[v], face->normal, background_uv);
+    }
+    for (size_t v = 1; v + 1 < face->n_vertices; ++v) {
+        addTriangle(base_vertex, fan[0], fan[v], fan[v + 1]);
+    }
+
+    // Inradius: distance from center to the nearest edge
+    vec3 center;
+    glm_vec3_scale((float*)face->center, scale, center);
+    float inradius = INFINITY;
+    for (size_t v = 0; v < face->n_vertices; ++v) {
+        vec3 edge, to_center, cross;
+        glm_vec3_sub(corners[(v + 1) % face->n_vertices], corners[v], edge);
+        glm_vec3_sub(center, corners[v], to_center);
+        glm_vec3_cross(edge, to_center, cross);
+        inradius = glm_min(inradius, glm_vec3_norm(cross) / glm_vec3_norm(edge));
+    }
+
+    // Equilateral triangle pointing to orientation vertex
+    vec3 up, side;
+    glm_vec3_sub(corners[0], center, up);
+    glm_vec3_normalize(up);
+    glm_vec3_cross((float*)face->normal, up, side);
+    float decal_radius = inradius * DECAL_SCALE;
+    GLuint decal[3];
+    for (size_t v = 0; v < 3; ++v) {
+        float angle = v * 2.0f * GLM_PIf / 3.0f;
+        vec3 position;
+        for (size_t c = 0; c < 3; ++c) {
+            position[c] = center[c] + face->normal[c] * DECAL_OFFSET
+                          + decal_radius * (cosf(angle) * up[c] + sinf(angle) * side[c]);
+        }
+        decal[v] = addVertex(position, face->normal, value_uv[v]);
+    }
+    addTriangle(base_vertex, decal[0], decal[1], decal[2]);
+}
+
+
+static void initPolyhedronMesh(DiceType type, const vec3* points, size_t n_points, float radius) {
+    PolyhedronFace faces[DICE_MAX_FACES];
+    size_t n_faces = findFaces(points, n_points, faces);
+
+    // All dice share the bounding sphere of the d20
+    float scale = 0.0f;
+    for (size_t p = 0; p < n_points; ++p) {
+        scale = glm_max(scale, glm_vec3_norm((float*)points[p]));
+    }
+    scale = radius / scale;
+
+    DiceMesh* mesh = &gDiceMeshes[type];
+    mesh->n_faces = n_faces;
+    mesh->radius = radius;
+    mesh->first_index = gDiceIndexCount;
+    mesh->base_vertex = gDiceVertexCount;
+    assignFaceValues(faces, n_faces, mesh->face_value);
+
+    for (size_t f = 0; f < n_faces; ++f) {
+        glm_vec3_copy(faces[f].normal, mesh->face_normal[f]);
+        glm_vec3_sub((float*)points[faces[f].vertices[0]], faces[f].center, mesh->face_up[f]);
+        glm_vec3_normalize(mesh->face_up[f]);
+        addFace(&faces[f], points, scale, mesh->face_value[f], mesh->base_vertex);
+    }
+    mesh->n_indices = gDiceIndexCount - mesh->first_index;
+}
+
+
+// D20 keeps the hand-made texture layout of icosahedron.c
+static void initIcosahedronMesh(float* out_radius) {
+    initIcosahedronMeshFromVertices();
+
+    DiceMesh* mesh = &gDiceMeshes[DICE_D20];
+    mesh->n_faces = 20;
+    mesh->first_index = gDiceIndexCount;
+    mesh->base_vertex = gDiceVertexCount;
+
+    float radius = 0.0f;
+    for (size_t v = 0; v < 20 * 3; ++v) {
+        gDiceVertices[gDiceVertexCount++] = gIcosahedronMesh[v];
+        gDiceIndices[gDiceIndexCount++] = v;
+        radius = glm_max(radius, glm_vec3_norm((vec3) { gIcosahedronMesh[v].x, gIcosahedronMesh[v].y,
+                                                          gIcosahedronMesh[v].z }));
+    }
+    mesh->n_indices = 20 * 3;
+    mesh->radius = radius;
+
+    for (int value = 1; value <= 20; ++value) {
+        size_t face_idx = getIcosahedronFaceIndex(value);
+        const Vertex* face = &gIcosahedronMesh[face_idx * 3];
+        const Vertex* orientation_vertex = &face[getOrientationVertexIndex(face_idx)];
+
+        vec3 center = {
+            (face[0].x + face[1].x + face[2].x) / 3.0f,
+            (face[0].y + face[1].y + face[2].y) / 3.0f,
+            (face[0].z + face[1].z + face[2].z) / 3.0f
+        };
+        mesh->face_value[face_idx] = value;
+        glm_vec3_copy((float*)face[0].n, mesh->face_normal[face_idx]);
+        glm_vec3_sub((vec3) { orientation_vertex->x, orientation_vertex->y, orientation_vertex->z },
+                     center, mesh->face_up[face_idx]);
+        glm_vec3_normalize(mesh->face_up[face_idx]);
+    }
+    *out_radius = radius;
+}
+
+
+static void initFaceNormalTable(DiceMesh* mesh) {
+    for (size_t f = 0; f < DICE_FACE_TABLE_SIZE; ++f) {
+        bool is_face = f < mesh->n_faces;
+        mesh->normal_x[f] = is_face ? mesh->face_normal[f][0] : 0.0f;
+        mesh->normal_y[f] = is_face ? mesh->face_normal[f][1] : 0.0f;
+        mesh->normal_z[f] = is_face ? mesh->face_normal[f][2] : 0.0f;
+        mesh->normal_bias[f] = is_face ? 0.0f : -INFINITY;
+    }
+}
+
+
+void initDiceMeshes(void) {
+    if (g_is_initialized) {
+        return;
+    }
+
+    float radius;
+    initIcosahedronMesh(&radius);
+
+    vec3 points[MAX_POLYHEDRON_VERTICES];
+    size_t n_points = getTetrahedronVertices(points);
+    initPolyhedronMesh(DICE_D4, points, n_points, radius);
+    n_points = getCubeVertices(points);
+    initPolyhedronMesh(DICE_D6, points, n_points, radius);
+    n_points = getOctahedronVertices(points);
+    initPolyhedronMesh(DICE_D8, points, n_points, radius);
+    n_points = getTrapezohedronVertices(points);
+    initPolyhedronMesh(DICE_D10, points, n_points, radius);
+    n_points = getDodecahedronVertices(points);
+    initPolyhedronMesh(DICE_D12, points, n_points, radius);
+
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        initFaceNormalTable(&gDiceMeshes[type]);
+    }
+    g_is_initialized = true;
+}
+
+
+size_t getDiceFaceCount(DiceType type) {
+    return gDiceMeshes[type].n_faces;
+}
+
+
+// Get face index from dice value (1 to number of faces)
+size_t getDiceFaceIndex(DiceType type, int dice_value) {
+    const DiceMesh* mesh = &gDiceMeshes[type];
+    for (size_t f = 0; f < mesh->n_faces; ++f) {
+        if (mesh->face_value[f] == dice_value) {
+            return f;
+        }
+    }
+    assert(false && "dice value out of range");
+    return 0;
+}
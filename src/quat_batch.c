@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include <math.h>
+
+#include "quat_batch.h"
+#include "quat_kernels.h"
+#include "cpu_features.h"
+#include "thread.h"
+
+
+// Baseline vector kernels built into this file, wider ones have their own files compiled with extra flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUAT_BATCH_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define QUAT_BATCH_NEON
+#endif
+
+
+#define QB_WIDTH 1
+#define QB_VEC float
+#define QB_MASK bool
+#define QB_LOAD(p) (*(p))
+#define QB_STORE(p, v) (*(p) = (v))
+#define QB_SET1(x) (x)
+#define QB_ADD(a, b) ((a) + (b))
+#define QB_SUB(a, b) ((a) - (b))
+#define QB_MUL(a, b) ((a) * (b))
+#define QB_DIV(a, b) ((a) / (b))
+#define QB_SQRT(a) sqrtf(a)
+#define QB_LT(a, b) ((a) < (b))
+#define QB_SELECT(mask, a, b) ((mask) ? (a) : (b))
+#define QB_SUFFIX Scalar
+#define QB_TABLE static const QuatKernels QUAT_KERNELS_SCALAR
+#include "quat_kernels.inc"
+
+
+#ifdef QUAT_BATCH_SSE2
+#define QB_WIDTH 4
+#define QB_VEC __m128
+#define QB_MASK __m128
+#define QB_LOAD(p) _mm_loadu_ps(p)
+#define QB_STORE(p, v) _mm_storeu_ps(p, v)
+#define QB_SET1(x) _mm_set1_ps(x)
+#define QB_ADD(a, b) _mm_add_ps(a, b)
+#define QB_SUB(a, b) _mm_sub_ps(a, b)
+#define QB_MUL(a, b) _mm_mul_ps(a, b)
+#define QB_DIV(a, b) _mm_div_ps(a, b)
+#define QB_SQRT(a) _mm_sqrt_ps(a)
+#define QB_LT(a, b) _mm_cmplt_ps(a, b)
+#define QB_SELECT(mask, a, b) _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#define QB_SUFFIX Sse2
+#define QB_TABLE static const QuatKernels QUAT_KERNELS_SSE2
+#include "quat_kernels.inc"
+#endif
+
+
+#ifdef QUAT_BATCH_NEON
+#define QB_WIDTH 4
+#define QB_VEC float32x4_t
+#define QB_MASK uint32x4_t
+#define QB_LOAD(p) vld1q_f32(p)
+#define QB_STORE(p, v) vst1q_f32(p, v)
+#define QB_SET1(x) vdupq_n_f32(x)
+#define QB_ADD(a, b) vaddq_f32(a, b)
+#define QB_SUB(a, b) vsubq_f32(a, b)
+#define QB_MUL(a, b) vmulq_f32(a, b)
+#define QB_DIV(a, b) vdivq_f32(a, b)
+#define QB_SQRT(a) vsqrtq_f32(a)
+#define QB_LT(a, b) vcltq_f32(a, b)
+#define QB_SELECT(mask, a, b) vbslq_f32(mask, a, b)
+#define QB_SUFFIX Neon
+#define QB_TABLE static const QuatKernels QUAT_KERNELS_NEON
+#include "quat_kernels.inc"
+#endif
+
+
+// Selected instruction set plus one, 0 until first use
+static AtomicCounter g_selected_isa = { 0 };
+
+
+static const QuatKernels* getQuatKernels(QuatIsa isa) {
+    switch (isa) {
+#ifdef QUAT_BATCH_SSE2
+    case QUAT_ISA_SSE2:
+        return &QUAT_KERNELS_SSE2;
+#endif
+#ifdef QUAT_BATCH_NEON
+    case QUAT_ISA_NEON:
+        return &QUAT_KERNELS_NEON;
+#endif
+    case QUAT_ISA_AVX2:
+        return &QUAT_KERNELS_AVX2;
+    case QUAT_ISA_AVX512:
+        return &QUAT_KERNELS_AVX512;
+    default:
+        return &QUAT_KERNELS_SCALAR;
+    }
+}
+
+
+bool isQuatIsaSupported(QuatIsa isa) {
+    switch (isa) {
+    case QUAT_ISA_SCALAR:
+        return true;
+#ifdef QUAT_BATCH_SSE2
+    case QUAT_ISA_SSE2:
+        return true;
+#endif
+#ifdef QUAT_BATCH_NEON
+    case QUAT_ISA_NEON:
+        return true;
+#endif
+    case QUAT_ISA_AVX2:
+        return getQuatKernels(isa)->width > 0 && hasCpuAvx2();
+    case QUAT_ISA_AVX512:
+        return getQuatKernels(isa)->width > 0 && hasCpuAvx512();
+    default:
+        return false;
+    }
+}
+
+
+QuatIsa getBestQuatIsa(void) {
+    for (int isa = QUAT_N_ISAS - 1; isa > QUAT_ISA_SCALAR; --isa) {
+        if (isQuatIsaSupported((QuatIsa)isa)) {
+            return (QuatIsa)isa;
+        }
+    }
+    return QUAT_ISA_SCALAR;
+}
+
+
+QuatIsa getQuatIsa(void) {
+    int64_t selected = loadAtomicCounter(&g_selected_isa);
+    if (selected == 0) {
+        // Threads racing here all pick the same one
+        selected = (int64_t)getBestQuatIsa() + 1;
+        storeAtomicCounter(&g_selected_isa, selected);
+    }
+    return (QuatIsa)(selected - 1);
+}
+
+
+void setQuatIsa(QuatIsa isa) {
+    if (isQuatIsaSupported(isa)) {
+        storeAtomicCounter(&g_selected_isa, (int64_t)isa + 1);
+    }
+}
+
+
+const char* getQuatIsaName(QuatIsa isa) {
+    static const char* const NAMES[QUAT_N_ISAS] = { "scalar", "SSE2", "NEON", "AVX2", "AVX-512" };
+    return isa < QUAT_N_ISAS ? NAMES[isa] : "unknown";
+}
+
+
+static QuatArrays offsetQuats(QuatArrays q, size_t k) {
+    return (QuatArrays) { q.x + k, q.y + k, q.z + k, q.w + k };
+}
+
+
+static Vec3Arrays offsetVec3s(Vec3Arrays v, size_t k) {
+    return (Vec3Arrays) { v.x + k, v.y + k, v.z + k };
+}
+
+
+static Mat3Arrays offsetMat3s(Mat3Arrays m, size_t k) {
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            m.m[c][r] += k;
+        }
+    }
+    return m;
+}
+
+
+// Quaternions that fill whole vectors of the selected kernels, the rest goes to scalar ones
+static const QuatKernels* getVectorKernels(size_t n, size_t* n_vector) {
+    const QuatKernels* kernels = getQuatKernels(getQuatIsa());
+    *n_vector = n - n % kernels->width;
+    return kernels;
+}
+
+
+void normalizeQuats(QuatArrays q, QuatArrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->normalize(q, out, k);
+    QUAT_KERNELS_SCALAR.normalize(offsetQuats(q, k), offsetQuats(out, k), n - k);
+}
+
+
+void multiplyQuats(QuatArrays a, QuatArrays b, QuatArrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->multiply(a, b, out, k);
+    QUAT_KERNELS_SCALAR.multiply(offsetQuats(a, k), offsetQuats(b, k), offsetQuats(out, k), n - k);
+}
+
+
+void nlerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->nlerp(a, b, t, out, k);
+    QUAT_KERNELS_SCALAR.nlerp(offsetQuats(a, k), offsetQuats(b, k), t + k, offsetQuats(out, k), n - k);
+}
+
+
+void slerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->slerp(a, b, t, out, k);
+    QUAT_KERNELS_SCALAR.slerp(offsetQuats(a, k), offsetQuats(b, k), t + k, offsetQuats(out, k), n - k);
+}
+
+
+void fastSlerpQuats(QuatArrays a, QuatArrays b, const float* t, QuatArrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->fastSlerp(a, b, t, out, k);
+    QUAT_KERNELS_SCALAR.fastSlerp(offsetQuats(a, k), offsetQuats(b, k), t + k, offsetQuats(out, k), n - k);
+}
+
+
+void interpolateQuats(QuatInterpolation method, QuatArrays a, QuatArrays b, const float* t, QuatArrays out,
+                      size_t n) {
+    switch (method) {
+    case QUAT_NLERP:
+        nlerpQuats(a, b, t, out, n);
+        break;
+    case QUAT_FAST_SLERP:
+        fastSlerpQuats(a, b, t, out, n);
+        break;
+    default:
+        slerpQuats(a, b, t, out, n);
+        break;
+    }
+}
+
+
+void quatsToMat3(QuatArrays q, Mat3Arrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->toMat3(q, out, k);
+    QUAT_KERNELS_SCALAR.toMat3(offsetQuats(q, k), offsetMat3s(out, k), n - k);
+}
+
+
+void quatsToMat4(QuatArrays q, mat4* out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->toMat4(q, out, k);
+    QUAT_KERNELS_SCALAR.toMat4(offsetQuats(q, k), out + k, n - k);
+}
+
+
+void rotateVec3s(QuatArrays q, Vec3Arrays v, Vec3Arrays out, size_t n) {
+    size_t k;
+    getVectorKernels(n, &k)->rotate(q, v, out, k);
+    QUAT_KERNELS_SCALAR.rotate(offsetQuats(q, k), offsetVec3s(v, k), offsetVec3s(out, k), n - k);
+}
+
+
+// Components of one versor as arrays of length 1
+static QuatArrays getVersorArrays(versor q) {
+    return (QuatArrays) { &q[0], &q[1], &q[2], &q[3] };
+}
+
+
+void nlerpQuat(versor a, versor b, float t, versor out) {
+    QUAT_KERNELS_SCALAR.nlerp(getVersorArrays(a), getVersorArrays(b), &t, getVersorArrays(out), 1);
+}
+
+
+void slerpQuat(versor a, versor b, float t, versor out) {
+    QUAT_KERNELS_SCALAR.slerp(getVersorArrays(a), getVersorArrays(b), &t, getVersorArrays(out), 1);
+}
+
+
+void interpolateQuat(QuatInterpolation method, versor a, versor b, float t, versor out) {
+    interpolateQuats(method, getVersorArrays(a), getVersorArrays(b), &t, getVersorArrays(out), 1);
+}
+
+
+const char* getQuatInterpolationName(QuatInterpolation method) {
+    static const char* const NAMES[QUAT_N_INTERPOLATIONS] = { "slerp", "nlerp", "fast-slerp" };
+    return method < QUAT_N_INTERPOLATIONS ? NAMES[method] : "unknown";
+}
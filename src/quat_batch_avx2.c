@@ -0,0 +1,29 @@
+#include <math.h>
+
+#include "quat_kernels.h"
+
+
+// Compiled with AVX2 enabled on x86 and only called after CPUID reports it
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+#define QB_WIDTH 8
+#define QB_VEC __m256
+#define QB_MASK __m256
+#define QB_LOAD(p) _mm256_loadu_ps(p)
+#define QB_STORE(p, v) _mm256_storeu_ps(p, v)
+#define QB_SET1(x) _mm256_set1_ps(x)
+#define QB_ADD(a, b) _mm256_add_ps(a, b)
+#define QB_SUB(a, b) _mm256_sub_ps(a, b)
+#define QB_MUL(a, b) _mm256_mul_ps(a, b)
+#define QB_DIV(a, b) _mm256_div_ps(a, b)
+#define QB_SQRT(a) _mm256_sqrt_ps(a)
+#define QB_LT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define QB_SELECT(mask, a, b) _mm256_blendv_ps(b, a, mask)
+#define QB_SUFFIX Avx2
+#define QB_TABLE const QuatKernels QUAT_KERNELS_AVX2
+#include "quat_kernels.inc"
+
+#else
+const QuatKernels QUAT_KERNELS_AVX2 = { 0 };
+#endif
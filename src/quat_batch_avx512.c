@@ -0,0 +1,30 @@
+#include <math.h>
+
+#include "quat_kernels.h"
+
+
+// Compiled with AVX-512 enabled on x86 and only called after CPUID reports it. Comparisons give
+// mask registers, blending with them needs only AVX-512F
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+#define QB_WIDTH 16
+#define QB_VEC __m512
+#define QB_MASK __mmask16
+#define QB_LOAD(p) _mm512_loadu_ps(p)
+#define QB_STORE(p, v) _mm512_storeu_ps(p, v)
+#define QB_SET1(x) _mm512_set1_ps(x)
+#define QB_ADD(a, b) _mm512_add_ps(a, b)
+#define QB_SUB(a, b) _mm512_sub_ps(a, b)
+#define QB_MUL(a, b) _mm512_mul_ps(a, b)
+#define QB_DIV(a, b) _mm512_div_ps(a, b)
+#define QB_SQRT(a) _mm512_sqrt_ps(a)
+#define QB_LT(a, b) _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ)
+#define QB_SELECT(mask, a, b) _mm512_mask_blend_ps(mask, b, a)
+#define QB_SUFFIX Avx512
+#define QB_TABLE const QuatKernels QUAT_KERNELS_AVX512
+#include "quat_kernels.inc"
+
+#else
+const QuatKernels QUAT_KERNELS_AVX512 = { 0 };
+#endif
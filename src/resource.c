@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "resource.h"
+
+
+#ifdef D20_EMBED_RESOURCES
+// Generated at build time from resources.pak
+extern const unsigned char gEmbeddedResourcePack[];
+extern const size_t gEmbeddedResourcePackSize;
+#endif
+
+
+static MappedFile g_pack;  // pack data, mapped from file or pointing to embedded array
+static bool g_is_pack_open = false;
+static bool g_is_pack_mapped = false;
+static const ResourcePackEntry* g_pack_entries = NULL;
+static size_t g_pack_n_entries = 0;
+
+
+static Status validatePack(const MappedFile* pack) {
+    ResourcePackHeader header;
+    if (pack->size < sizeof(header)) {
+        puts("Resource pack is too small");
+        return STATUS_ERR;
+    }
+    memcpy(&header, pack->data, sizeof(header));
+
+    if (header.magic != RESOURCE_PACK_MAGIC || header.version != RESOURCE_PACK_VERSION) {
+        puts("Unknown resource pack version");
+        return STATUS_ERR;
+    }
+    if ((pack->size - sizeof(header)) / sizeof(ResourcePackEntry) < header.n_entries) {
+        puts("Resource pack index is out of bounds");
+        return STATUS_ERR;
+    }
+
+    const ResourcePackEntry* entries =
+        (const ResourcePackEntry*)((const unsigned char*)pack->data + sizeof(header));
+    for (uint32_t i = 0; i < header.n_entries; ++i) {
+        if (entries[i].name[RESOURCE_NAME_LENGTH - 1] != '\0'
+            || entries[i].offset > pack->size || entries[i].size > pack->size - entries[i].offset) {
+            puts("Resource pack entry is corrupted");
+            return STATUS_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+
+static Status initPackIndex(void) {
+    Status status = validatePack(&g_pack);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    const ResourcePackHeader* header = g_pack.data;
+    g_pack_entries = (const ResourcePackEntry*)(header + 1);
+    g_pack_n_entries = header->n_entries;
+    g_is_pack_open = true;
+    return STATUS_OK;
+}
+
+
+Status openResourcePack(const char* path) {
+    if (g_is_pack_open) {
+        closeResourcePack();
+    }
+
+    Status status = mapFile(path, &g_pack);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    g_is_pack_mapped = true;
+    status = initPackIndex();
+    if (status != STATUS_OK) {
+        closeResourcePack();
+    }
+    return status;
+}
+
+
+Status openEmbeddedResourcePack(void) {
+#ifdef D20_EMBED_RESOURCES
+    if (g_is_pack_open) {
+        closeResourcePack();
+    }
+
+    g_pack.data = gEmbeddedResourcePack;
+    g_pack.size = gEmbeddedResourcePackSize;
+    g_is_pack_mapped = false;
+    return initPackIndex();
+#else
+    return STATUS_ERR;
+#endif
+}
+
+
+void closeResourcePack(void) {
+    if (g_is_pack_mapped) {
+        unmapFile(&g_pack);
+        g_is_pack_mapped = false;
+    }
+    if (g_is_pack_open) {
+        g_pack_entries = NULL;
+        g_pack_n_entries = 0;
+        g_is_pack_open = false;
+    }
+}
+
+
+bool isResourcePackOpen(void) {
+    return g_is_pack_open;
+}
+
+
+// Binary search, index is sorted by d20_pack
+static const ResourcePackEntry* findPackEntry(const char* path) {
+    size_t lo = 0, hi = g_pack_n_entries;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(path, g_pack_entries[mid].name);
+        if (cmp == 0) {
+            return &g_pack_entries[mid];
+        } else if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+
+Status loadResource(const char* path, Resource* resource) {
+    if (g_is_pack_open) {
+        const ResourcePackEntry* entry = findPackEntry(path);
+        if (entry) {
+            resource->data = (const unsigned char*)g_pack.data + entry->offset;
+            resource->size = (size_t)entry->size;
+            resource->is_mapped = false;
+            return STATUS_OK;
+        }
+    }
+    return loadResourceFile(path, resource);
+}
+
+
+Status loadResourceFile(const char* path, Resource* resource) {
+    Status status = mapFile(path, &resource->file);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    resource->data = resource->file.data;
+    resource->size = resource->file.size;
+    resource->is_mapped = true;
+    return STATUS_OK;
+}
+
+
+void freeResource(Resource* resource) {
+    if (resource->is_mapped) {
+        unmapFile(&resource->file);
+        resource->is_mapped = false;
+    }
+    resource->data = NULL;
+    resource->size = 0;
+}
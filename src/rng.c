@@ -0,0 +1,44 @@
+#include "rng.h"
+
+
+static const uint64_t PCG_MULTIPLIER = 6364136223846793005ULL;
+
+
+void initRng(Rng* rng, uint64_t seed, uint64_t stream) {
+    rng->state = 0;
+    rng->increment = (stream << 1) | 1;
+    nextRngU32(rng);
+    rng->state += seed;
+    nextRngU32(rng);
+}
+
+
+uint32_t nextRngU32(Rng* rng) {
+    uint64_t state = rng->state;
+    rng->state = state * PCG_MULTIPLIER + rng->increment;
+
+    // XSH RR output permutation
+    uint32_t xorshifted = (uint32_t)(((state >> 18) ^ state) >> 27);
+    uint32_t rotation = (uint32_t)(state >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+}
+
+
+uint32_t nextRngBounded(Rng* rng, uint32_t bound) {
+    // Lemire's multiply-shift, rejecting the few low products that would be overrepresented
+    uint64_t product = (uint64_t)nextRngU32(rng) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            product = (uint64_t)nextRngU32(rng) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+
+float nextRngFloat(Rng* rng) {
+    return (nextRngU32(rng) >> 8) * (1.0f / 16777216.0f);
+}
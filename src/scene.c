@@ -4,27 +4,40 @@
 #include "stb_image.h"
 
 #include "scene.h"
+#include "allocation.h"
 #include "status.h"
-#include "icosahedron.h"
+#include "polyhedron.h"
 #include "shader.h"
+#include "resource.h"
+#include "texture_container.h"
+#include "gl_state.h"
 
 
 static const char VERTEX_SHADER_PATH[] = "resources/shaders/vertex_shader.glsl";
 static const char FRAGMENT_SHADER_PATH[] = "resources/shaders/fragment_shader.glsl";
 const char TEXTURE_PATH[] = "resources/textures/d20_uv.png";
+const char TEXTURE_CONTAINER_PATH[] = "resources/textures/d20_uv.d20tex";
 
+enum {
+    DICE_INSTANCE_BINDING = 0
+};
 
-static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
-    // Create buffers and upload values
+
+static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr, GLuint* ibo_ptr) {
+    // Create buffers and upload values of all dice types
     glCreateBuffers(1, vbo_ptr);
     GLuint vbo = *vbo_ptr;
+    glNamedBufferStorage(vbo, gDiceVertexCount * sizeof(Vertex), gDiceVertices, 0);
 
-    glNamedBufferStorage(vbo, sizeof(gIcosahedronMesh), &gIcosahedronMesh, 0);
+    glCreateBuffers(1, ibo_ptr);
+    GLuint ibo = *ibo_ptr;
+    glNamedBufferStorage(ibo, gDiceIndexCount * sizeof(GLuint), gDiceIndices, 0);
 
     glCreateVertexArrays(1, vao_ptr);  // create vertex array objects for dice and text
     GLuint vao = *vao_ptr;
 
     glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(Vertex));
+    glVertexArrayElementBuffer(vao, ibo);
 
     GLuint loc_attr = 0, col_attr = 1, norm_attr = 2, texture_attr = 3;
     // Enable attributes of vertex array
@@ -49,22 +62,46 @@ static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
 }
 
 
-static void freeVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
+static void freeVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr, GLuint* ibo_ptr) {
     glDeleteBuffers(1, vbo_ptr);
+    glDeleteBuffers(1, ibo_ptr);
+    forgetGlVertexArray(*vao_ptr);
     glDeleteVertexArrays(1, vao_ptr);
 }
 
 
-static Status initTextures(const char* path, GLuint* texture_id) {
+// Upload pre-mipmapped texture produced by d20_texconv straight from the mapping
+static Status initTexturesFromContainer(const char* path, GLuint* texture_id) {
+    Resource container;
+    Status status = loadResource(path, &container);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    status = initTextureFromContainer(container.data, container.size, texture_id);
+    freeResource(&container);
+    return status;
+}
+
+
+// Fallback when container is missing: decode PNG and build mip chain on GPU
+static Status initTexturesFromImage(const char* path, GLuint* texture_id) {
+    Resource image;
+    if (loadResource(path, &image) != STATUS_OK) {
+        return STATUS_ERR;
+    }
+
     int width, height, n_channels;
-    unsigned char* data = stbi_load(path, &width, &height, &n_channels, 3);
+    unsigned char* data = stbi_load_from_memory(image.data, (int)image.size, &width, &height, &n_channels, 3);
+    freeResource(&image);
     Status status = STATUS_OK;
 
     if (data) {
         glCreateTextures(GL_TEXTURE_2D, 1, texture_id);
         glTextureParameteri(*texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTextureParameteri(*texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTextureStorage2D(*texture_id, 1, GL_RGB8, width, height);
+        glTextureStorage2D(*texture_id, getTextureMipLevelCount(width, height), GL_RGB8, width, height);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTextureSubImage2D(*texture_id, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
         glGenerateTextureMipmap(*texture_id);
     } else {
@@ -75,65 +112,202 @@ static Status initTextures(const char* path, GLuint* texture_id) {
 }
 
 
+static Status initTextures(GLuint* texture_id) {
+    if (initTexturesFromContainer(TEXTURE_CONTAINER_PATH, texture_id) == STATUS_OK) {
+        return STATUS_OK;
+    }
+    puts("Falling back to PNG texture");
+    return initTexturesFromImage(TEXTURE_PATH, texture_id);
+}
+
+
 static void freeTextures(GLuint* texture_id) {
+    forgetGlTexture(*texture_id);
     glDeleteTextures(1, texture_id);
 }
 
 
-static void initUniformVariables(GLuint program, SceneUniformVariables* uvars) {
-    uvars->model_id = initUniformVariable(program, "model");
-    uvars->normal_matrix_id = initUniformVariable(program, "normalMatrix");
-    uvars->view_id = initUniformVariable(program, "view");
-    uvars->projection_id = initUniformVariable(program, "projection");
-    uvars->light_dir_id = initUniformVariable(program, "lightDirection");
-    uvars->ambient_brightness_id = initUniformVariable(program, "ambientBrightness");
-    uvars->direct_brightness_id = initUniformVariable(program, "directBrightness");
-    uvars->specular_brightness_id = initUniformVariable(program, "specularBrightness");
+static Status initInstanceBuffer(SceneRenderer* dice, size_t max_dice) {
+    dice->instances = allocateMemory(max_dice * sizeof(DiceInstance));
+    dice->near_dice = allocateMemory(max_dice * sizeof(uint32_t));
+    dice->far_dice = allocateMemory(max_dice * sizeof(uint32_t));
+    dice->draw_dice = allocateMemory(max_dice * sizeof(uint32_t));
+    dice->draw_slots = allocateMemory(max_dice * sizeof(uint32_t));
+    if (!dice->instances || !dice->near_dice || !dice->far_dice || !dice->draw_dice || !dice->draw_slots) {
+        free(dice->instances);
+        free(dice->near_dice);
+        free(dice->far_dice);
+        free(dice->draw_dice);
+        free(dice->draw_slots);
+        return STATUS_ERR;
+    }
+    if (initDiceCuller(&dice->culler, max_dice) != STATUS_OK) {
+        free(dice->instances);
+        free(dice->near_dice);
+        free(dice->far_dice);
+        free(dice->draw_dice);
+        free(dice->draw_slots);
+        return STATUS_ERR;
+    }
+    dice->instance_capacity = max_dice;
+
+    glCreateBuffers(1, &dice->instance_buffer);
+    glNamedBufferStorage(dice->instance_buffer, max_dice * sizeof(DiceInstance), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    // Mesh ranges never change, only instance ranges are rewritten every frame
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        dice->commands[type] = (DrawElementsIndirectCommand) {
+            .count = gDiceMeshes[type].n_indices,
+            .instance_count = 0,
+            .first_index = gDiceMeshes[type].first_index,
+            .base_vertex = gDiceMeshes[type].base_vertex,
+            .base_instance = 0
+        };
+    }
+    glCreateBuffers(1, &dice->command_buffer);
+    glNamedBufferStorage(dice->command_buffer, sizeof(dice->commands), dice->commands, GL_DYNAMIC_STORAGE_BIT);
+    return STATUS_OK;
 }
 
 
-Status initSceneRenderer(SceneRenderer* dice) {
-    initIcosahedronMeshFromVertices();
+static void freeInstanceBuffer(SceneRenderer* dice) {
+    glDeleteBuffers(1, &dice->instance_buffer);
+    glDeleteBuffers(1, &dice->command_buffer);
+    free(dice->instances);
+    free(dice->near_dice);
+    free(dice->far_dice);
+    free(dice->draw_dice);
+    free(dice->draw_slots);
+    freeDiceCuller(&dice->culler);
+}
+
 
-    Status status = initVertexArray(&dice->vao, &dice->vbo);
+static Status initUniformVariables(GLuint program, SceneUniformVariables* uvars) {
+    Status status = STATUS_OK;
+    uvars->view_id = initUniformVariable(program, "view", &status);
+    uvars->projection_id = initUniformVariable(program, "projection", &status);
+    uvars->light_dir_id = initUniformVariable(program, "lightDirection", &status);
+    uvars->ambient_brightness_id = initUniformVariable(program, "ambientBrightness", &status);
+    uvars->direct_brightness_id = initUniformVariable(program, "directBrightness", &status);
+    uvars->specular_brightness_id = initUniformVariable(program, "specularBrightness", &status);
+    // Only declared by the shader when it has no draw parameters
+    uvars->instance_offset_id = glGetUniformLocation(program, "instanceOffset");
+    return status;
+}
+
+
+Status initSceneRenderer(SceneRenderer* dice, const DiceWorld* world) {
+    size_t max_dice = world->capacity;
+
+    // gl_BaseInstance is core only since 4.6
+    dice->has_draw_parameters = GLAD_GL_ARB_shader_draw_parameters;
+    if (!dice->has_draw_parameters) {
+        puts("GL_ARB_shader_draw_parameters is not supported, dice types are drawn one by one");
+    }
+
+    initDiceMeshes();
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        dice->type_radius[type] = gDiceMeshes[type].radius;
+    }
+
+    Status status = initVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
     if (status != STATUS_OK) {
         puts("Unable to initalize vertex array");
         return status;
     }
 
-    status = initTextures(TEXTURE_PATH, &dice->texture);
+    status = initTextures(&dice->texture);
     if (status != STATUS_OK) {
         puts("Unable to initalize textures");
-        freeVertexArray(&dice->vao, &dice->vbo);
+        freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
+        return status;
+    }
+
+    status = initInstanceBuffer(dice, max_dice);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize instance buffer");
+        freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
+        freeTextures(&dice->texture);
         return status;
     }
 
     status = initProgram(VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH, &dice->shader);
     if (status != STATUS_OK) {
         puts("Unable to initalize shader program");
-        freeVertexArray(&dice->vao, &dice->vbo);
+        freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
         freeTextures(&dice->texture);
+        freeInstanceBuffer(dice);
         return status;
     }
 
-    initUniformVariables(dice->shader.id, &dice->uvars);
+    status = initImpostorRenderer(&dice->impostor, DICE_N_TYPES, max_dice);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize impostors");
+        freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
+        freeTextures(&dice->texture);
+        freeInstanceBuffer(dice);
+        freeProgram(&dice->shader);
+        return status;
+    }
+    dice->is_impostor_atlas_valid = false;
+    initCameraTransform(&dice->camera);
+
+    status = initGpuAnimator(&dice->animator, max_dice, world->n_roll_points);
+    if (status != STATUS_OK) {
+        puts("Unable to initalize GPU animation");
+        freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
+        freeTextures(&dice->texture);
+        freeInstanceBuffer(dice);
+        freeProgram(&dice->shader);
+        freeImpostorRenderer(&dice->impostor);
+        return status;
+    }
+
+    status = initUniformVariables(dice->shader.id, &dice->uvars);
+    if (status != STATUS_OK) {
+        freeSceneRenderer(dice);
+    }
     return status;
 }
 
 
 void freeSceneRenderer(SceneRenderer* dice) {
-    freeVertexArray(&dice->vao, &dice->vbo);
+    freeVertexArray(&dice->vao, &dice->vbo, &dice->ibo);
     freeTextures(&dice->texture);
+    freeInstanceBuffer(dice);
+    freeImpostorRenderer(&dice->impostor);
+    freeGpuAnimator(&dice->animator);
     freeProgram(&dice->shader);
 }
 
 
+void requestSceneShaderReload(SceneRenderer* dice, const char* file_name) {
+    if (isProgramSource(&dice->shader, file_name)) {
+        printf("Reloading scene shaders: %s changed\n", file_name);
+        beginProgramReload(&dice->shader);
+    }
+    requestImpostorShaderReload(&dice->impostor, file_name);
+    requestGpuAnimatorShaderReload(&dice->animator, file_name);
+}
+
+
+void updateSceneShaderReload(SceneRenderer* dice) {
+    if (pollProgramReload(&dice->shader) == PROGRAM_RELOAD_LINKED) {
+        SceneUniformVariables uvars;
+        Status status = initUniformVariables(dice->shader.pending_id, &uvars);
+        if (finishProgramReload(&dice->shader, status) == PROGRAM_RELOAD_DONE) {
+            dice->uvars = uvars;
+            dice->is_impostor_atlas_valid = false;  // recapture with new shaders
+        }
+    }
+    updateImpostorShaderReload(&dice->impostor);
+    updateGpuAnimatorShaderReload(&dice->animator);
+}
+
+
 /* Rendering */
-static void setDiceUniformMatrices(SceneUniformVariables* uvars_ptr,
-    mat4 model, mat4 view, mat3 normal_matrix, mat4 projection) {
-    glUniformMatrix4fv(uvars_ptr->model_id, 1, GL_FALSE, (float*)model);
+static void setDiceUniformMatrices(SceneUniformVariables* uvars_ptr, mat4 view, mat4 projection) {
     glUniformMatrix4fv(uvars_ptr->view_id, 1, GL_FALSE, (float*)view);
-    glUniformMatrix3fv(uvars_ptr->normal_matrix_id, 1, GL_FALSE, (float*)normal_matrix);
     glUniformMatrix4fv(uvars_ptr->projection_id, 1, GL_FALSE, (float*)projection);
 }
 
@@ -148,58 +322,210 @@ static void setLightingUniformMatrices(
 }
 
 
-static void computeDiceGeometry(SceneSettings* settings_ptr, versor rotation_quat,
-                                float aspect_ratio, mat4 model, mat4 view, 
-                                mat3 normal_matrix, mat4 projection) {
-    glm_mat4_identity(model);
-    glm_scale(model, (vec3) { settings_ptr->scale, settings_ptr->scale, settings_ptr->scale });
-    glm_quat_rotate(model, rotation_quat, model);  // apply model rotation for current frame
+// Draws one by one take their ranges from the CPU copy of commands
+static void uploadDrawCommands(SceneRenderer* dice_ptr) {
+    if (dice_ptr->has_draw_parameters) {
+        glNamedBufferSubData(dice_ptr->command_buffer, 0, sizeof(dice_ptr->commands), dice_ptr->commands);
+    }
+}
 
-    glm_mat4_identity(view);
-    glm_translate(view, settings_ptr->camera_position);
 
-    mat4 view_model;
-    glm_mat4_mul(view, model, view_model);
+static void getViewCenter(const DiceWorld* world, size_t i, mat4 view, vec4 view_center) {
+    glm_mat4_mulv(view, (vec4) { world->position[i][0], world->position[i][1], world->position[i][2], 1.0f },
+                  view_center);
+}
+
+
+// Fill instance data of visible dice and upload it, grouped by dice type. Dice with projected radius
+// below impostor_size_px go to impostor list instead. With GPU animation only slots of dice are collected,
+// instances are written by compute shader, and CPU evaluates orientations of impostors only.
+// Returns number of instances
+static size_t uploadDiceInstances(SceneRenderer* dice_ptr, DiceWorld* world, const AnimationSettings* anim_settings,
+                                  mat4 view, mat4 projection, float impostor_size_px, int height,
+                                  bool gpu_animation) {
+    // Projected radius in pixels is radius * pixels_per_unit / depth
+    float pixels_per_unit = projection[1][1] * height * 0.5f;
+
+    size_t n = 0, n_far = 0;
+    size_t type_count[DICE_N_TYPES] = { 0 };
+    const uint32_t* visible = dice_ptr->culler.visible;
+    for (size_t k = 0; k < dice_ptr->culler.n_visible; ++k) {
+        uint32_t i = visible[k];
+        DiceType type = world->type[i];
+        float radius = world->scale[i] * dice_ptr->type_radius[type];
+
+        vec4 view_center;
+        getViewCenter(world, i, view, view_center);
+        float depth = glm_max(-view_center[2], 1e-6f);
+
+        if (radius * pixels_per_unit < impostor_size_px * depth) {
+            dice_ptr->far_dice[n_far++] = i;
+        } else {
+            dice_ptr->near_dice[n++] = i;
+            ++type_count[type];
+        }
+    }
 
-    mat4 normal_matrix4;
-    glm_mat4_inv(view_model, normal_matrix4);
-    glm_mat4_transpose(normal_matrix4);
-    glm_mat4_pick3(normal_matrix4, normal_matrix);
+    updateDiceOrientations(world, anim_settings, dice_ptr->far_dice, n_far);
+    for (size_t k = 0; k < n_far; ++k) {
+        uint32_t i = dice_ptr->far_dice[k];
+        vec4 view_center;
+        getViewCenter(world, i, view, view_center);
+        // Camera does not rotate, so die orientation is its rotation relative to camera
+        addImpostorInstance(&dice_ptr->impostor, world->type[i], view_center, world->orientation[i],
+                            world->scale[i] * dice_ptr->type_radius[world->type[i]]);
+    }
 
-    glm_perspective(glm_rad(settings_ptr->fov_deg), aspect_ratio, settings_ptr->camera_near_z,
-        settings_ptr->camera_far_z, projection);
+    // Counting sort by type, so that every type is one contiguous instance range of its draw command
+    size_t next[DICE_N_TYPES];
+    size_t first = 0;
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        dice_ptr->commands[type].base_instance = next[type] = first;
+        dice_ptr->commands[type].instance_count = type_count[type];
+        first += type_count[type];
+    }
+    for (size_t k = 0; k < n; ++k) {
+        uint32_t i = dice_ptr->near_dice[k];
+        dice_ptr->draw_dice[next[world->type[i]]++] = i;
+    }
+    if (gpu_animation) {
+        for (size_t k = 0; k < n; ++k) {
+            dice_ptr->draw_slots[k] = world->slot_index[dice_ptr->draw_dice[k]];
+        }
+    } else {
+        updateDiceOrientations(world, anim_settings, dice_ptr->draw_dice, n);
+        computeDiceInstances(view, world, dice_ptr->draw_dice, n, dice_ptr->instances);
+        glNamedBufferSubData(dice_ptr->instance_buffer, 0, n * sizeof(DiceInstance), dice_ptr->instances);
+    }
+    uploadDrawCommands(dice_ptr);
+    return n;
 }
 
 
-static void computeLightingGeometry(mat4 scene_view, vec3 scene_direction, vec3 out_direction) {
-    mat3 view_matrix3;
-    glm_mat4_pick3(scene_view, view_matrix3);
-    vec3 norm_light_direction;
-    glm_vec3_copy(scene_direction, norm_light_direction);
-    glm_normalize(norm_light_direction);
-    glm_mat3_mulv(view_matrix3, norm_light_direction, out_direction);
+// Submit draw commands of all dice types at once, or one by one without shader draw parameters
+static void drawDice(SceneRenderer* dice_ptr, bool wireMode) {
+    bindGlVertexArray(dice_ptr->vao);
+    bindGlTextureUnit(0, dice_ptr->texture);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DICE_INSTANCE_BINDING, dice_ptr->instance_buffer);
+    if (wireMode) {
+        setGlPolygonMode(GL_LINE);
+    }
+    if (dice_ptr->has_draw_parameters) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, dice_ptr->command_buffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, DICE_N_TYPES, 0);
+    } else {
+        for (int type = 0; type < DICE_N_TYPES; ++type) {
+            const DrawElementsIndirectCommand* command = &dice_ptr->commands[type];
+            if (command->instance_count == 0) {
+                continue;
+            }
+            glUniform1i(dice_ptr->uvars.instance_offset_id, command->base_instance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command->count, GL_UNSIGNED_INT,
+                                              (void*)(command->first_index * sizeof(GLuint)),
+                                              command->instance_count, command->base_vertex);
+        }
+    }
+    if (wireMode) {
+        setGlPolygonMode(GL_FILL);
+    }
 }
 
 
-void renderScene(SceneRenderer* dice_ptr, SceneSettings* settings_ptr, versor rot_quat,
-                float aspect_ratio, bool wireMode) {
-    glUseProgram(dice_ptr->shader.id);
-    mat4 model, view, projection;
-    mat3 normal_matrix;
-    computeDiceGeometry(settings_ptr, rot_quat, aspect_ratio, model, view, normal_matrix, projection);
-    setDiceUniformMatrices(&dice_ptr->uvars, model, view, normal_matrix, projection);
+// Render die of one type from every atlas cell direction with orthographic camera fitted to its bounding sphere
+static void captureImpostorLayer(SceneRenderer* dice_ptr, SceneSettings* settings_ptr, DiceType type) {
+    float r = dice_ptr->type_radius[type];
+    mat4 view, projection;
+    glm_translate_make(view, (vec3) { 0.0f, 0.0f, -2.0f * r });
+    glm_ortho(-r, r, -r, r, 0.5f * r, 3.5f * r, projection);
+
+    useGlProgram(dice_ptr->shader.id);
+    setDiceUniformMatrices(&dice_ptr->uvars, view, projection);
     vec3 view_light_direction;
-    computeLightingGeometry(view, settings_ptr->light_direction, view_light_direction);
+    computeViewLightDirection(view, settings_ptr->light_direction, view_light_direction);
     setLightingUniformMatrices(settings_ptr, &dice_ptr->uvars, view_light_direction);
 
-    glBindVertexArray(dice_ptr->vao);
-    glBindTextureUnit(0, dice_ptr->texture);
-    size_t n = sizeof(gIcosahedronMesh) / sizeof(Vertex);
-    if (wireMode == false) {
-        glDrawArrays(GL_TRIANGLES, 0, n);
-    } else {
-        for (size_t i = 0; i < n / 3; ++i) {
-            glDrawArrays(GL_LINE_LOOP, i * 3, 3);
+    // Draw only one instance of this type
+    for (int t = 0; t < DICE_N_TYPES; ++t) {
+        dice_ptr->commands[t].instance_count = t == type ? 1 : 0;
+        dice_ptr->commands[t].base_instance = 0;
+    }
+    uploadDrawCommands(dice_ptr);
+
+    beginImpostorLayerCapture(&dice_ptr->impostor, type);
+    for (int cell_y = 0; cell_y < IMPOSTOR_GRID_SIZE; ++cell_y) {
+        for (int cell_x = 0; cell_x < IMPOSTOR_GRID_SIZE; ++cell_x) {
+            // Rotate die so that cell basis maps onto camera axes
+            vec3 right, up, dir;
+            getImpostorCellBasis(cell_x, cell_y, right, up, dir);
+            DiceInstance instance;
+            glm_mat4_identity(instance.model);
+            for (int c = 0; c < 3; ++c) {
+                instance.model[c][0] = right[c];
+                instance.model[c][1] = up[c];
+                instance.model[c][2] = dir[c];
+            }
+            computeNormalMatrix(view, instance.model, 1.0f, instance.normal_matrix);
+            glNamedBufferSubData(dice_ptr->instance_buffer, 0, sizeof(instance), &instance);
+
+            beginImpostorCellCapture(&dice_ptr->impostor, cell_x, cell_y);
+            drawDice(dice_ptr, false);
         }
     }
 }
+
+
+static void captureImpostorAtlas(SceneRenderer* dice_ptr, SceneSettings* settings_ptr) {
+    // Scene may be rendered offscreen, so restore whatever framebuffer was bound
+    GLint viewport[4], framebuffer;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        captureImpostorLayer(dice_ptr, settings_ptr, type);
+    }
+    finishImpostorAtlas(&dice_ptr->impostor);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    dice_ptr->is_impostor_atlas_valid = true;
+}
+
+
+void renderScene(SceneRenderer* dice_ptr, SceneSettings* settings_ptr, const AnimationSettings* anim_settings,
+                 DiceWorld* world, int width, int height, bool wireMode) {
+    if (!dice_ptr->is_impostor_atlas_valid) {
+        captureImpostorAtlas(dice_ptr, settings_ptr);
+    }
+
+    // Derived camera and light state is only recomputed after settings or viewport changed
+    CameraTransform* camera = &dice_ptr->camera;
+    setCameraPosition(camera, settings_ptr->camera_position);
+    setCameraLens(camera, settings_ptr->fov_deg, settings_ptr->camera_near_z, settings_ptr->camera_far_z);
+    setCameraViewport(camera, width, height);
+    setCameraLightDirection(camera, settings_ptr->light_direction);
+    updateCameraTransform(camera);
+    vec4* view = camera->view;
+    vec4* projection = camera->projection;
+    cullDice(&dice_ptr->culler, world, dice_ptr->type_radius, camera->view_projection);
+
+    // Wire mode shows real geometry of every die
+    float impostor_size_px = wireMode ? 0.0f : settings_ptr->impostor_size_px;
+    bool gpu_animation = settings_ptr->gpu_animation;
+    size_t n_instances = uploadDiceInstances(dice_ptr, world, anim_settings, view, projection, impostor_size_px,
+                                             height, gpu_animation);
+    if (gpu_animation) {
+        syncGpuAnimator(&dice_ptr->animator, world);
+        dispatchGpuAnimator(&dice_ptr->animator, world, anim_settings, dice_ptr->draw_slots, n_instances, view,
+                            dice_ptr->instance_buffer);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    useGlProgram(dice_ptr->shader.id);
+    setDiceUniformMatrices(&dice_ptr->uvars, view, projection);
+    setLightingUniformMatrices(settings_ptr, &dice_ptr->uvars, camera->view_light_direction);
+    if (n_instances > 0) {
+        drawDice(dice_ptr, wireMode);
+    }
+
+    renderImpostors(&dice_ptr->impostor, projection);
+}
@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "session_log.h"
+
+
+enum {
+    FRAME_RECORD_SIZE = 1 + 4 + 4,
+    KEY_RECORD_SIZE = 1 + 2 + 1 + 8,
+    MAX_RECORD_SIZE = KEY_RECORD_SIZE
+};
+
+
+Status openSessionLogForWriting(SessionLog* log, const char* path, uint64_t seed, uint32_t n_dice,
+                                uint32_t dice_type, uint32_t interpolation) {
+    log->file = fopen(path, "wb");
+    if (!log->file) {
+        printf("Unable to create session log %s\n", path);
+        return STATUS_ERR;
+    }
+    log->is_writing = true;
+    log->n_frames = 0;
+
+    SessionLogHeader header = {
+        .magic = SESSION_LOG_MAGIC,
+        .version = SESSION_LOG_VERSION,
+        .seed = seed,
+        .n_dice = n_dice,
+        .dice_type = dice_type,
+        .interpolation = interpolation,
+    };
+    if (fwrite(&header, sizeof(header), 1, log->file) != 1) {
+        printf("Unable to write session log %s\n", path);
+        closeSessionLog(log);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+Status openSessionLogForReading(SessionLog* log, const char* path, SessionLogHeader* out_header) {
+    log->file = fopen(path, "rb");
+    if (!log->file) {
+        printf("Unable to open session log %s\n", path);
+        return STATUS_ERR;
+    }
+    log->is_writing = false;
+    log->n_frames = 0;
+
+    if (fread(out_header, sizeof(*out_header), 1, log->file) != 1
+        || out_header->magic != SESSION_LOG_MAGIC || out_header->version != SESSION_LOG_VERSION) {
+        printf("Unknown session log version: %s\n", path);
+        closeSessionLog(log);
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+void closeSessionLog(SessionLog* log) {
+    if (log->file) {
+        fclose(log->file);
+        log->file = NULL;
+    }
+}
+
+
+void writeSessionFrame(SessionLog* log, float time_delta, uint32_t checksum) {
+    unsigned char record[FRAME_RECORD_SIZE] = { SESSION_RECORD_FRAME };
+    memcpy(record + 1, &time_delta, 4);
+    memcpy(record + 5, &checksum, 4);
+    fwrite(record, sizeof(record), 1, log->file);
+    log->n_frames++;
+}
+
+
+void writeSessionKey(SessionLog* log, int key, int action, double time) {
+    unsigned char record[KEY_RECORD_SIZE] = { SESSION_RECORD_KEY };
+    int16_t key16 = (int16_t)key;
+    record[3] = (unsigned char)action;
+    memcpy(record + 1, &key16, 2);
+    memcpy(record + 4, &time, 8);
+    fwrite(record, sizeof(record), 1, log->file);
+}
+
+
+bool readSessionRecord(SessionLog* log, SessionRecord* record) {
+    unsigned char buf[MAX_RECORD_SIZE];
+    if (fread(buf, 1, 1, log->file) != 1) {
+        return false;
+    }
+
+    record->type = buf[0];
+    switch (record->type) {
+    case SESSION_RECORD_FRAME:
+        if (fread(buf + 1, FRAME_RECORD_SIZE - 1, 1, log->file) != 1) {
+            return false;
+        }
+        memcpy(&record->time_delta, buf + 1, 4);
+        memcpy(&record->checksum, buf + 5, 4);
+        log->n_frames++;
+        return true;
+    case SESSION_RECORD_KEY: {
+        if (fread(buf + 1, KEY_RECORD_SIZE - 1, 1, log->file) != 1) {
+            return false;
+        }
+        int16_t key16;
+        memcpy(&key16, buf + 1, 2);
+        record->key = key16;
+        record->action = buf[3];
+        memcpy(&record->time, buf + 4, 8);
+        return true;
+    }
+    default:
+        puts("Session log is corrupted");
+        return false;
+    }
+}
@@ -1,91 +1,98 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "shader.h"
+#include "allocation.h"
+#include "resource.h"
 
 
-/*
-* Loads shader code from path to output buffer outBuf
-* Caller must free(outBuf).
-*/
-static Status loadShaderText(const char* path, char** outBuf) {
-    FILE* file = fopen(path, "rb");
-    if (!file) {
-        puts("Unable to read file");
-        return STATUS_ERR;
-    }
+static const char* g_shader_source_dir = "resources/shaders";
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
 
-    char* buf = malloc(length + 1);
-    if (buf) {
-        long n_read = fread(buf, 1, length, file);
-        if (n_read != length) {
-            puts("Error during file read");
-            free(buf);
-            return STATUS_ERR;
-        }
+static const char* getFileName(const char* path) {
+    const char* name = strrchr(path, '/');
+    return name ? name + 1 : path;
+}
 
-        buf[length] = '\0';
-        fclose(file);
-    } else {
-        puts("Unable to allocate buffer to read file");
-        return STATUS_ERR;
-    }
-    *outBuf = buf;
-    return STATUS_OK;
+
+void setShaderSourceDir(const char* dir_path) {
+    g_shader_source_dir = dir_path;
 }
 
 
-static Status compileShader(GLuint shader, const char* path) {
-    char* shader_text = NULL;
-    Status status = loadShaderText(path, &shader_text);
+// Check compile status of the shader. Blocks until compilation is finished
+static Status checkShader(GLuint shader) {
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 
-    if (status != STATUS_OK) {
-        printf("Unable to read shader\n");
-    } else {
-        glShaderSource(shader, 1, &shader_text, NULL);
-        glCompileShader(shader);
-        free(shader_text);
-
-        // Check for compile errors
-        GLint success = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-        if (!success) {
-            GLint max_length = 0;
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &max_length);
-
-            // The max_length includes the NULL character
-            GLchar* error_log = malloc(max_length);
-            if (error_log) {
-                glGetShaderInfoLog(shader, max_length, &max_length, &error_log[0]);
-                printf("Shader compilation error:\n%s\n", error_log);
-            }
-
-            status = STATUS_ERR;
+    if (!success) {
+        GLint max_length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &max_length);
+
+        // The max_length includes the NULL character
+        GLchar* error_log = allocateMemory(max_length);
+        if (error_log) {
+            glGetShaderInfoLog(shader, max_length, &max_length, &error_log[0]);
+            printf("Shader compilation error:\n%s\n", error_log);
+            free(error_log);
         }
+
+        return STATUS_ERR;
     }
-    return status;
+    return STATUS_OK;
 }
 
 
 typedef enum {
     VERTEX_SHADER,
-    FRAGMENT_SHADER
+    FRAGMENT_SHADER,
+    COMPUTE_SHADER
 } ShaderType;
 
 
-static Status initShader(const char* shader_path, ShaderType shader_type, GLuint* out_shader) {
-    GLuint shader = glCreateShader(shader_type == VERTEX_SHADER ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
-    Status status = compileShader(shader, shader_path);
-    if (status == STATUS_OK) {
-        *out_shader = shader;
+static GLenum getShaderGLType(ShaderType shader_type) {
+    switch (shader_type) {
+    case VERTEX_SHADER:
+        return GL_VERTEX_SHADER;
+    case FRAGMENT_SHADER:
+        return GL_FRAGMENT_SHADER;
+    case COMPUTE_SHADER:
+        return GL_COMPUTE_SHADER;
     }
-    return status;
+    return GL_VERTEX_SHADER;
+}
+
+
+// Start shader compilation without waiting for the result. Source is taken from resource pack
+// unless from_filesystem is set, then the file of the same name is read from shader source directory
+static Status initShader(const char* shader_path, ShaderType shader_type, bool from_filesystem,
+                         GLuint* out_shader) {
+    Resource shader_text;
+    Status status;
+    if (from_filesystem) {
+        char file_path[1024];
+        snprintf(file_path, sizeof(file_path), "%s/%s", g_shader_source_dir, getFileName(shader_path));
+        status = loadResourceFile(file_path, &shader_text);
+    } else {
+        status = loadResource(shader_path, &shader_text);
+    }
+    if (status != STATUS_OK) {
+        printf("Unable to read shader\n");
+        return status;
+    }
+
+    // Source is not null-terminated, pass its length explicitly
+    const GLchar* source = shader_text.data;
+    GLint length = (GLint)shader_text.size;
+    GLuint shader = glCreateShader(getShaderGLType(shader_type));
+    glShaderSource(shader, 1, &source, &length);
+    glCompileShader(shader);
+    freeResource(&shader_text);
+
+    *out_shader = shader;
+    return STATUS_OK;
 }
 
 
@@ -94,48 +101,195 @@ static void freeShader(GLuint shader) {
 }
 
 
-Status initProgram(const char* vertex_shader_path, const char* fragment_shader_path, ShaderProgram* shader_program) {
-    GLuint vertex_shader, fragment_shader;
-    Status status = initShader(vertex_shader_path, VERTEX_SHADER, &vertex_shader);
+// Compile and link compute program without waiting for the result
+static Status startComputeProgram(const char* compute_shader_path, bool from_filesystem, GLuint* out_program) {
+    GLuint compute_shader;
+    Status status = initShader(compute_shader_path, COMPUTE_SHADER, from_filesystem, &compute_shader);
+    if (status != STATUS_OK) {
+        return status;
+    }
 
-    if (status == STATUS_OK) {
-        status = initShader(fragment_shader_path, FRAGMENT_SHADER, &fragment_shader);
-    } else {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, compute_shader);
+    glLinkProgram(program);
+    freeShader(compute_shader);
+
+    *out_program = program;
+    return STATUS_OK;
+}
+
+
+// Compile and link program without waiting for the result
+static Status startRenderProgram(const char* vertex_shader_path, const char* fragment_shader_path,
+                                 bool from_filesystem, GLuint* out_program) {
+    GLuint vertex_shader, fragment_shader;
+    Status status = initShader(vertex_shader_path, VERTEX_SHADER, from_filesystem, &vertex_shader);
+    if (status != STATUS_OK) {
         return status;
     }
 
-    if (status == STATUS_ERR) {
+    status = initShader(fragment_shader_path, FRAGMENT_SHADER, from_filesystem, &fragment_shader);
+    if (status != STATUS_OK) {
         freeShader(vertex_shader);
         return status;
     }
 
-    shader_program->id = glCreateProgram();
-    glAttachShader(shader_program->id, vertex_shader);
-    glAttachShader(shader_program->id, fragment_shader);
-    glLinkProgram(shader_program->id);
-    GLint link_success;
-    glGetProgramiv(shader_program->id, GL_LINK_STATUS, &link_success);
-    if (!link_success) {
-        status = STATUS_ERR;
-        puts("Shader linking error");
-    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+
+    // Attached shaders live until the program is deleted, we only need them for error logs
     freeShader(vertex_shader);
     freeShader(fragment_shader);
 
+    *out_program = program;
+    return STATUS_OK;
+}
+
+
+static Status startProgram(const ShaderProgram* shader_program, bool from_filesystem, GLuint* out_program) {
+    if (shader_program->compute_shader_path) {
+        return startComputeProgram(shader_program->compute_shader_path, from_filesystem, out_program);
+    }
+    return startRenderProgram(shader_program->vertex_shader_path, shader_program->fragment_shader_path,
+                              from_filesystem, out_program);
+}
+
+
+// Check link status of the program. Blocks until linking is finished
+static Status finishProgram(GLuint program) {
+    GLint link_success;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    if (link_success) {
+        return STATUS_OK;
+    }
+
+    GLuint shaders[2];
+    GLsizei n_shaders = 0;
+    glGetAttachedShaders(program, 2, &n_shaders, shaders);
+    for (GLsizei i = 0; i < n_shaders; ++i) {
+        checkShader(shaders[i]);
+    }
+    puts("Shader linking error");
+    return STATUS_ERR;
+}
+
+
+// Whether the program has finished compiling, so that its status can be queried without a stall
+static bool isProgramReady(GLuint program) {
+    if (!GLAD_GL_KHR_parallel_shader_compile) {
+        return true;  // status query will simply block
+    }
+    GLint is_completed = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &is_completed);
+    return is_completed == GL_TRUE;
+}
+
+
+void initParallelShaderCompile(void) {
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);  // implementation-specific maximum
+    }
+}
+
+
+static Status buildProgram(ShaderProgram* shader_program) {
+    shader_program->pending_id = 0;
+    Status status = startProgram(shader_program, false, &shader_program->id);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    status = finishProgram(shader_program->id);
+    if (status != STATUS_OK) {
+        glDeleteProgram(shader_program->id);
+    }
     return status;
 }
 
 
+Status initProgram(const char* vertex_shader_path, const char* fragment_shader_path, ShaderProgram* shader_program) {
+    shader_program->vertex_shader_path = vertex_shader_path;
+    shader_program->fragment_shader_path = fragment_shader_path;
+    shader_program->compute_shader_path = NULL;
+    return buildProgram(shader_program);
+}
+
+
+Status initComputeProgram(const char* compute_shader_path, ShaderProgram* shader_program) {
+    shader_program->vertex_shader_path = NULL;
+    shader_program->fragment_shader_path = NULL;
+    shader_program->compute_shader_path = compute_shader_path;
+    return buildProgram(shader_program);
+}
+
+
 void freeProgram(ShaderProgram* shader_program) {
+    glDeleteProgram(shader_program->pending_id);
+    glDeleteProgram(shader_program->id);
+}
+
+
+static bool isSourceFile(const char* path, const char* file_name) {
+    return path && strcmp(getFileName(path), file_name) == 0;
+}
+
+
+bool isProgramSource(const ShaderProgram* shader_program, const char* file_name) {
+    return isSourceFile(shader_program->vertex_shader_path, file_name)
+        || isSourceFile(shader_program->fragment_shader_path, file_name)
+        || isSourceFile(shader_program->compute_shader_path, file_name);
+}
+
+
+Status beginProgramReload(ShaderProgram* shader_program) {
+    // Restart if sources changed again while previous reload is still compiling
+    glDeleteProgram(shader_program->pending_id);
+    shader_program->pending_id = 0;
+
+    // Edited sources are in shader source directory even when the program was initially loaded from the pack
+    return startProgram(shader_program, true, &shader_program->pending_id);
+}
+
+
+ProgramReloadStatus pollProgramReload(ShaderProgram* shader_program) {
+    if (shader_program->pending_id == 0) {
+        return PROGRAM_RELOAD_NONE;
+    }
+    if (!isProgramReady(shader_program->pending_id)) {
+        return PROGRAM_RELOAD_PENDING;
+    }
+
+    if (finishProgram(shader_program->pending_id) != STATUS_OK) {
+        glDeleteProgram(shader_program->pending_id);
+        shader_program->pending_id = 0;
+        return PROGRAM_RELOAD_FAILED;
+    }
+    return PROGRAM_RELOAD_LINKED;
+}
+
+
+ProgramReloadStatus finishProgramReload(ShaderProgram* shader_program, Status uniform_status) {
+    GLuint program = shader_program->pending_id;
+    shader_program->pending_id = 0;
+    if (uniform_status != STATUS_OK) {
+        puts("Reloaded program lacks uniform variables, keeping the old one");
+        glDeleteProgram(program);
+        return PROGRAM_RELOAD_FAILED;
+    }
+
     glDeleteProgram(shader_program->id);
+    shader_program->id = program;
+    return PROGRAM_RELOAD_DONE;
 }
 
 
-GLuint initUniformVariable(GLuint program, const char* name) {
-    GLuint index = glGetUniformLocation(program, name);
+GLuint initUniformVariable(GLuint program, const char* name, Status* status) {
+    GLint index = glGetUniformLocation(program, name);
     if (index == -1) {
         printf("Unable to get uniform variable with name: %s\n", name);
-        abort();
+        *status = STATUS_ERR;
     }
-    return index;
+    return (GLuint)index;
 }
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "shader_watcher.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+
+
+Status initShaderWatcher(ShaderWatcher* watcher, const char* dir_path) {
+    watcher->buf_len = 0;
+    watcher->buf_pos = 0;
+    watcher->watch_id = -1;
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd == -1) {
+        puts("Unable to initialize inotify");
+        return STATUS_ERR;
+    }
+
+    // Editors either rewrite files in place or move a new file over the old one
+    watcher->watch_id = inotify_add_watch(watcher->fd, dir_path, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watcher->watch_id == -1) {
+        printf("Unable to watch directory: %s\n", dir_path);
+        close(watcher->fd);
+        watcher->fd = -1;
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
+
+
+void freeShaderWatcher(ShaderWatcher* watcher) {
+    if (watcher->fd != -1) {
+        close(watcher->fd);
+        watcher->fd = -1;
+    }
+}
+
+
+const char* pollShaderWatcher(ShaderWatcher* watcher) {
+    if (watcher->fd == -1) {
+        return NULL;
+    }
+
+    while (true) {
+        if (watcher->buf_pos >= watcher->buf_len) {
+            ssize_t n_read = read(watcher->fd, watcher->buf, sizeof(watcher->buf));
+            watcher->buf_pos = 0;
+            watcher->buf_len = n_read > 0 ? (size_t)n_read : 0;
+            if (watcher->buf_len == 0) {
+                return NULL;  // EAGAIN, nothing has changed
+            }
+        }
+
+        // Buffer is not aligned for the event header, name follows it
+        struct inotify_event event;
+        memcpy(&event, &watcher->buf[watcher->buf_pos], sizeof(event));
+        const char* name = &watcher->buf[watcher->buf_pos + sizeof(event)];
+        watcher->buf_pos += sizeof(event) + event.len;
+        if (event.len > 0 && !(event.mask & IN_ISDIR)) {
+            return name;
+        }
+    }
+}
+
+#else
+
+Status initShaderWatcher(ShaderWatcher* watcher, const char* dir_path) {
+    watcher->fd = -1;
+    puts("Shader hot-reload is not supported on this platform");
+    return STATUS_ERR;
+}
+
+
+void freeShaderWatcher(ShaderWatcher* watcher) {
+}
+
+
+const char* pollShaderWatcher(ShaderWatcher* watcher) {
+    return NULL;
+}
+
+#endif
@@ -1,31 +1,42 @@
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "text.h"
+#include "resource.h"
+#include "gl_state.h"
 
 
 static const char VERTEX_SHADER_PATH[] = "resources/shaders/text_vertex_shader.glsl";
 static const char FRAGMENT_SHADER_PATH[] = "resources/shaders/text_fragment_shader.glsl";
 const char TEXT_FONT_PATH[] = "resources/fonts/arial.ttf";
+static const char TEXT_ATLAS_PATH[] = "resources/fonts/arial.sdf";
 
 
-static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
-    const size_t text_n_vertices = 6;
-    const size_t text_vertex_size = 4;
+enum {
+    TEXT_VERTEX_SIZE = 4,  // <vec2 pos, vec2 tex>
+    TEXT_VERTICES_PER_CHARACTER = 6,
+    TEXT_MAX_BATCH_CHARACTERS = 128  // longer strings are drawn in several batches
+};
+
 
+static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
     // Create buffers and upload values
     glCreateBuffers(1, vbo_ptr);
 
     // We will be changing text buffer during rendering
-    glNamedBufferData(*vbo_ptr, text_n_vertices * text_vertex_size * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+    glNamedBufferData(*vbo_ptr,
+                      TEXT_MAX_BATCH_CHARACTERS * TEXT_VERTICES_PER_CHARACTER * TEXT_VERTEX_SIZE * sizeof(GLfloat),
+                      NULL, GL_DYNAMIC_DRAW);
 
     glCreateVertexArrays(1, vao_ptr);  // create vertex array objects for dice and text
 
-    glVertexArrayVertexBuffer(*vao_ptr, 0, *vbo_ptr, 0, text_vertex_size * sizeof(GLfloat));
+    glVertexArrayVertexBuffer(*vao_ptr, 0, *vbo_ptr, 0, TEXT_VERTEX_SIZE * sizeof(GLfloat));
 
     // Only one attrib for text
     glEnableVertexArrayAttrib(*vao_ptr, 0);
-    glVertexArrayAttribFormat(*vao_ptr, 0, text_vertex_size, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribFormat(*vao_ptr, 0, TEXT_VERTEX_SIZE, GL_FLOAT, GL_FALSE, 0);
     glVertexArrayAttribBinding(*vao_ptr, 0, 0);
 
     return STATUS_OK;
@@ -34,99 +45,84 @@ static Status initVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
 
 static void freeVertexArray(GLuint* vao_ptr, GLuint* vbo_ptr) {
     glDeleteBuffers(1, vbo_ptr);
+    forgetGlVertexArray(*vao_ptr);
     glDeleteVertexArrays(1, vao_ptr);
 }
 
 
-enum {
-    TEXT_N_CHARACTERS = 128
-};
-
-
 static Character g_characters[TEXT_N_CHARACTERS];
 
 
-static void initCharacters(FT_Face face) {
-    // From learnopengl.com
-    FT_Set_Pixel_Sizes(face, 0, 48);
+static void initAtlasTexture(const TextAtlasHeader* header, const unsigned char* pixels, TextRenderer* text) {
+    memcpy(g_characters, header->characters, sizeof(g_characters));
+    text->atlas_size[0] = header->width;
+    text->atlas_size[1] = header->height;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &text->atlas_texture);
+    glTextureStorage2D(text->atlas_texture, 1, GL_R8, header->width, header->height);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+    glTextureSubImage2D(text->atlas_texture, 0, 0, 0, header->width, header->height, GL_RED, GL_UNSIGNED_BYTE,
+                        pixels);
+
+    // Distance is interpolated bilinearly, shader reconstructs the sharp edge
+    glTextureParameteri(text->atlas_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(text->atlas_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(text->atlas_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(text->atlas_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
 
-    for (unsigned char c = 0; c < TEXT_N_CHARACTERS; ++c) {
-        // load character glyph 
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-        {
-            printf("Failed to load glyph %c\n", c);
-            continue;
-        }
 
-        GLuint texture;
-        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
-        if (c != 32) {  // whitespace
-            glTextureStorage2D(
-                texture, 1, GL_R8,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows
-            );
-            glTextureSubImage2D(
-                texture,
-                0, 0, 0,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-
-            // set texture options
-            glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        }
+// Atlas of the resource pack, generated at build time
+static Status loadAtlas(uint32_t font_hash, TextRenderer* text) {
+    Resource atlas;
+    if (loadResource(TEXT_ATLAS_PATH, &atlas) != STATUS_OK) {
+        return STATUS_ERR;
+    }
 
-        g_characters[c].texture_id = texture;
-        g_characters[c].size[0] = face->glyph->bitmap.width;
-        g_characters[c].size[1] = face->glyph->bitmap.rows;
-        g_characters[c].bearing[0] = face->glyph->bitmap_left;
-        g_characters[c].bearing[1] = face->glyph->bitmap_top;
-        g_characters[c].advance = face->glyph->advance.x;
+    TextAtlasHeader header;
+    Status status = readTextAtlasHeader(atlas.data, atlas.size, font_hash, &header);
+    if (status == STATUS_OK) {
+        initAtlasTexture(&header, (const unsigned char*)atlas.data + sizeof(header), text);
     }
+    freeResource(&atlas);
+    return status;
 }
 
 
-static Status initTextLibrary(void) {
-    FT_Library ft_lib;
-    FT_Face ft_face;
+static Status initTextAtlas(TextRenderer* text) {
+    Resource font;
+    if (loadResource(TEXT_FONT_PATH, &font) != STATUS_OK) {
+        puts("Unable to load font");
+        return STATUS_ERR;
+    }
 
-    Status status = STATUS_OK;
-    if (!FT_Init_FreeType(&ft_lib)) {
-        if (!FT_New_Face(ft_lib, TEXT_FONT_PATH, 0, &ft_face)) {
-            initCharacters(ft_face);
-
-            FT_Done_Face(ft_face);
-            FT_Done_FreeType(ft_lib);
-        } else {
-            puts("Unable to initialize freetype face");
-            status = STATUS_ERR;
-            FT_Done_FreeType(ft_lib);
+    // Rendered in memory only if the atlas is missing or was made from another font, nothing is written to disk
+    Status status = loadAtlas(hashTextFont(font.data, font.size), text);
+    if (status != STATUS_OK) {
+        TextAtlasHeader header;
+        unsigned char* pixels;
+        status = generateTextAtlas(font.data, font.size, &header, &pixels);
+        if (status == STATUS_OK) {
+            initAtlasTexture(&header, pixels, text);
+            free(pixels);
         }
-    } else {
-        puts("Unable to initialize freetype library");
-        status = STATUS_ERR;
     }
 
+    freeResource(&font);
     return status;
 }
 
 
-static void initUniformVariables(GLuint program, TextUniformVariables* uvars) {
-    uvars->color_id = initUniformVariable(program, "textColor");
-    uvars->projection_id = initUniformVariable(program, "projection");
+static Status initUniformVariables(GLuint program, TextUniformVariables* uvars) {
+    Status status = STATUS_OK;
+    uvars->color_id = initUniformVariable(program, "textColor", &status);
+    uvars->projection_id = initUniformVariable(program, "projection", &status);
+    return status;
 }
 
 
 Status initTextRenderer(TextRenderer* text) {
-    Status status = initTextLibrary();
+    Status status = initTextAtlas(text);
     if (status != STATUS_OK) {
         return status;
     }
@@ -136,6 +132,7 @@ Status initTextRenderer(TextRenderer* text) {
     status = initVertexArray(&text->vao, &text->vbo);
     if (status != STATUS_OK) {
         puts("Unable to initialize text vertex array");
+        glDeleteTextures(1, &text->atlas_texture);
         return status;
     }
 
@@ -143,16 +140,43 @@ Status initTextRenderer(TextRenderer* text) {
     if (status != STATUS_OK) {
         puts("Unable to initalize text shader program");
         freeVertexArray(&text->vao, &text->vbo);
+        glDeleteTextures(1, &text->atlas_texture);
         return status;
     }
 
-    initUniformVariables(text->shader.id, &text->uvars);
+    status = initUniformVariables(text->shader.id, &text->uvars);
+    if (status != STATUS_OK) {
+        freeProgram(&text->shader);
+        freeVertexArray(&text->vao, &text->vbo);
+        glDeleteTextures(1, &text->atlas_texture);
+    }
     return status;
 }
 
 
 void freeTextRenderer(TextRenderer* text) {
     freeVertexArray(&text->vao, &text->vbo);
+    forgetGlTexture(text->atlas_texture);
+    glDeleteTextures(1, &text->atlas_texture);
+}
+
+
+void requestTextShaderReload(TextRenderer* text, const char* file_name) {
+    if (isProgramSource(&text->shader, file_name)) {
+        printf("Reloading text shaders: %s changed\n", file_name);
+        beginProgramReload(&text->shader);
+    }
+}
+
+
+void updateTextShaderReload(TextRenderer* text) {
+    if (pollProgramReload(&text->shader) == PROGRAM_RELOAD_LINKED) {
+        TextUniformVariables uvars;
+        Status status = initUniformVariables(text->shader.pending_id, &uvars);
+        if (finishProgramReload(&text->shader, status) == PROGRAM_RELOAD_DONE) {
+            text->uvars = uvars;
+        }
+    }
 }
 
 
@@ -168,41 +192,92 @@ static void computeTextGeometry(float width, float height, mat4 projection) {
 }
 
 
-void renderText(TextRenderer* renderer_ptr, const char* text, TextSettings* settings_ptr,
-                float x, float y, float window_width, float window_height) {
-    glUseProgram(renderer_ptr->shader.id);
-    mat4 text_projection;
-    computeTextGeometry(window_width, window_height, text_projection);
-    setTextUniformMatrices(&renderer_ptr->uvars, settings_ptr->text_color, text_projection);
+static void drawTextBatch(TextRenderer* renderer_ptr, const GLfloat* vertices, size_t n_characters) {
+    glNamedBufferSubData(renderer_ptr->vbo, 0,
+                         n_characters * TEXT_VERTICES_PER_CHARACTER * TEXT_VERTEX_SIZE * sizeof(GLfloat), vertices);
+    glDrawArrays(GL_TRIANGLES, 0, n_characters * TEXT_VERTICES_PER_CHARACTER);
+}
+
+
+// Quad of character with pen at (x, y), advances pen. False for characters without image, like space.
+// Bytes outside ASCII (e.g. parts of UTF-8 sequences) have no glyph in the atlas and are skipped
+static bool layoutCharacter(const TextRenderer* renderer_ptr, char c, float text_size, float* x, float y,
+                            TextQuad* quad) {
+    if ((unsigned char)c >= TEXT_N_CHARACTERS) {
+        return false;
+    }
+    Character ch = renderer_ptr->char_array_ptr[(unsigned char)c];
+    float size = text_size / TEXT_SDF_PIXEL_SIZE;
+    float pen_x = *x;
+
+    // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+    // bitshift by 6 to get value in pixels (2^6 = 64)
+    *x += (ch.advance >> 6) * size;
+    if (ch.size[0] == 0) {
+        return false;
+    }
 
-    float size = settings_ptr->text_size;
-    for (size_t i = 0; i < strlen(text); ++i) {
+    float atlas_width = renderer_ptr->atlas_size[0], atlas_height = renderer_ptr->atlas_size[1];
+    quad->x0 = pen_x + ch.bearing[0] * size;
+    quad->y0 = y - (ch.size[1] - ch.bearing[1]) * size;
+    quad->x1 = quad->x0 + ch.size[0] * size;
+    quad->y1 = quad->y0 + ch.size[1] * size;
+    quad->u0 = ch.atlas_offset[0] / atlas_width;
+    quad->v0 = ch.atlas_offset[1] / atlas_height;
+    quad->u1 = (ch.atlas_offset[0] + ch.size[0]) / atlas_width;
+    quad->v1 = (ch.atlas_offset[1] + ch.size[1]) / atlas_height;
+    return true;
+}
 
-        Character ch = renderer_ptr->char_array_ptr[text[i]];
 
-        GLfloat xpos = x + ch.bearing[0] * size;
-        GLfloat ypos = y - (ch.size[1] - ch.bearing[1]) * size;
+size_t layoutText(const TextRenderer* renderer, const char* text, float text_size, float x, float y,
+                  TextQuad* quads, size_t max_quads) {
+    size_t n_quads = 0;
+    for (const char* c = text; *c != '\0' && n_quads < max_quads; ++c) {
+        if (layoutCharacter(renderer, *c, text_size, &x, y, &quads[n_quads])) {
+            ++n_quads;
+        }
+    }
+    return n_quads;
+}
 
-        GLfloat w = ch.size[0] * size;
-        GLfloat h = ch.size[1] * size;
-        // update VBO for each character
-        GLfloat vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
 
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
-        };
+void renderText(TextRenderer* renderer_ptr, const char* text, TextSettings* settings_ptr,
+                float x, float y, float window_width, float window_height) {
+    useGlProgram(renderer_ptr->shader.id);
+    mat4 text_projection;
+    computeTextGeometry(window_width, window_height, text_projection);
+    setTextUniformMatrices(&renderer_ptr->uvars, settings_ptr->text_color, text_projection);
 
-        glBindVertexArray(renderer_ptr->vao);
-        glBindTextureUnit(0, ch.texture_id);
-        glNamedBufferSubData(renderer_ptr->vbo, 0, sizeof(vertices), vertices);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    bindGlVertexArray(renderer_ptr->vao);
+    bindGlTextureUnit(0, renderer_ptr->atlas_texture);
+
+    // All glyphs share one atlas, so a whole string is a single draw
+    GLfloat vertices[TEXT_MAX_BATCH_CHARACTERS][TEXT_VERTICES_PER_CHARACTER][TEXT_VERTEX_SIZE];
+    size_t n_batched = 0;
+
+    for (const char* c = text; *c != '\0'; ++c) {
+        TextQuad q;
+        if (layoutCharacter(renderer_ptr, *c, settings_ptr->text_size, &x, y, &q)) {
+            GLfloat quad[TEXT_VERTICES_PER_CHARACTER][TEXT_VERTEX_SIZE] = {
+                { q.x0, q.y1, q.u0, q.v0 },
+                { q.x0, q.y0, q.u0, q.v1 },
+                { q.x1, q.y0, q.u1, q.v1 },
+
+                { q.x0, q.y1, q.u0, q.v0 },
+                { q.x1, q.y0, q.u1, q.v1 },
+                { q.x1, q.y1, q.u1, q.v0 }
+            };
+            memcpy(vertices[n_batched++], quad, sizeof(quad));
+
+            if (n_batched == TEXT_MAX_BATCH_CHARACTERS) {
+                drawTextBatch(renderer_ptr, &vertices[0][0][0], n_batched);
+                n_batched = 0;
+            }
+        }
+    }
 
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        // bitshift by 6 to get value in pixels (2^6 = 64)
-        x += (ch.advance >> 6) * size;
+    if (n_batched > 0) {
+        drawTextBatch(renderer_ptr, &vertices[0][0][0], n_batched);
     }
 }
\ No newline at end of file
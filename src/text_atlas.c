@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+#include "text_atlas.h"
+#include "allocation.h"
+
+
+// FNV-1a
+uint32_t hashTextFont(const void* font_data, size_t font_size) {
+    const unsigned char* bytes = font_data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < font_size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+static Status growAtlas(unsigned char** pixels_ptr, int* height_ptr, int required_height) {
+    int height = *height_ptr;
+    while (height < required_height) {
+        height *= 2;
+    }
+    if (height == *height_ptr) {
+        return STATUS_OK;
+    }
+
+    unsigned char* pixels = reallocateMemory(*pixels_ptr, (size_t)TEXT_ATLAS_WIDTH * height);
+    if (!pixels) {
+        puts("Unable to allocate text atlas");
+        return STATUS_ERR;
+    }
+    memset(pixels + (size_t)TEXT_ATLAS_WIDTH * *height_ptr, 0,
+           (size_t)TEXT_ATLAS_WIDTH * (height - *height_ptr));
+    *pixels_ptr = pixels;
+    *height_ptr = height;
+    return STATUS_OK;
+}
+
+
+// Render distance field of every printable character and pack them into rows of a single atlas
+static Status renderAtlas(FT_Library ft_lib, FT_Face face, Character* characters, unsigned char** out_pixels,
+                          int* out_height) {
+    FT_Int spread = TEXT_SDF_SPREAD;
+    FT_Property_Set(ft_lib, "bsdf", "spread", &spread);
+    FT_Set_Pixel_Sizes(face, 0, TEXT_SDF_PIXEL_SIZE);
+
+    int height = 64;
+    unsigned char* pixels = allocateZeroedMemory((size_t)TEXT_ATLAS_WIDTH * height, 1);
+    if (!pixels) {
+        puts("Unable to allocate text atlas");
+        return STATUS_ERR;
+    }
+
+    int pen_x = TEXT_ATLAS_PADDING, pen_y = TEXT_ATLAS_PADDING, row_height = 0;
+    memset(characters, 0, TEXT_N_CHARACTERS * sizeof(Character));
+    for (unsigned char c = TEXT_FIRST_PRINTABLE; c < TEXT_N_CHARACTERS; ++c) {
+        // Rasterize first and build distance field from the bitmap (bsdf),
+        // it is more robust than the outline-based renderer
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+        {
+            printf("Failed to load glyph %c\n", c);
+            continue;
+        }
+        characters[c].advance = face->glyph->advance.x;
+        if (face->glyph->bitmap.width == 0 || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF)) {
+            continue;  // whitespace
+        }
+
+        const FT_Bitmap* bitmap = &face->glyph->bitmap;
+        int w = bitmap->width, h = bitmap->rows;
+        if (pen_x + w + TEXT_ATLAS_PADDING > TEXT_ATLAS_WIDTH) {
+            pen_x = TEXT_ATLAS_PADDING;
+            pen_y += row_height + TEXT_ATLAS_PADDING;
+            row_height = 0;
+        }
+        if (growAtlas(&pixels, &height, pen_y + h + TEXT_ATLAS_PADDING) != STATUS_OK) {
+            free(pixels);
+            return STATUS_ERR;
+        }
+
+        for (int row = 0; row < h; ++row) {
+            memcpy(&pixels[(size_t)(pen_y + row) * TEXT_ATLAS_WIDTH + pen_x],
+                   &bitmap->buffer[row * bitmap->pitch], w);
+        }
+
+        characters[c].atlas_offset[0] = pen_x;
+        characters[c].atlas_offset[1] = pen_y;
+        characters[c].size[0] = w;
+        characters[c].size[1] = h;
+        characters[c].bearing[0] = face->glyph->bitmap_left;
+        characters[c].bearing[1] = face->glyph->bitmap_top;
+
+        pen_x += w + TEXT_ATLAS_PADDING;
+        row_height = h > row_height ? h : row_height;
+    }
+
+    *out_pixels = pixels;
+    *out_height = height;
+    return STATUS_OK;
+}
+
+
+Status generateTextAtlas(const void* font_data, size_t font_size, TextAtlasHeader* header, unsigned char** pixels) {
+    *header = (TextAtlasHeader) {
+        .magic = TEXT_ATLAS_MAGIC,
+        .version = TEXT_ATLAS_VERSION,
+        .font_hash = hashTextFont(font_data, font_size),
+        .pixel_size = TEXT_SDF_PIXEL_SIZE,
+        .spread = TEXT_SDF_SPREAD,
+        .width = TEXT_ATLAS_WIDTH,
+    };
+
+    FT_Library ft_lib;
+    FT_Face ft_face;
+    if (FT_Init_FreeType(&ft_lib)) {
+        puts("Unable to initialize freetype library");
+        return STATUS_ERR;
+    }
+    // Face reads font data in place
+    if (FT_New_Memory_Face(ft_lib, font_data, (FT_Long)font_size, 0, &ft_face)) {
+        puts("Unable to initialize freetype face");
+        FT_Done_FreeType(ft_lib);
+        return STATUS_ERR;
+    }
+
+    int height;
+    Status status = renderAtlas(ft_lib, ft_face, header->characters, pixels, &height);
+    header->height = status == STATUS_OK ? (uint32_t)height : 0;
+
+    FT_Done_Face(ft_face);
+    FT_Done_FreeType(ft_lib);
+    return status;
+}
+
+
+Status readTextAtlasHeader(const void* data, size_t size, uint32_t font_hash, TextAtlasHeader* header) {
+    if (size < sizeof(*header)) {
+        return STATUS_ERR;
+    }
+    memcpy(header, data, sizeof(*header));
+    if (header->magic != TEXT_ATLAS_MAGIC || header->version != TEXT_ATLAS_VERSION
+        || header->font_hash != font_hash || header->pixel_size != TEXT_SDF_PIXEL_SIZE
+        || header->spread != TEXT_SDF_SPREAD || header->width != TEXT_ATLAS_WIDTH
+        || size - sizeof(*header) < (size_t)header->width * header->height) {
+        return STATUS_ERR;
+    }
+    return STATUS_OK;
+}
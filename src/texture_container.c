@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "texture_container.h"
+
+
+uint32_t getTextureMipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t max_dim = width > height ? width : height;
+    uint32_t n_levels = 1;
+    while (max_dim > 1) {
+        max_dim >>= 1;
+        ++n_levels;
+    }
+    return n_levels;
+}
+
+
+uint64_t getTextureLevelSize(TextureContainerFormat format, uint32_t width, uint32_t height) {
+    if (format == TEXTURE_FORMAT_BC1) {
+        return ((uint64_t)width + 3) / 4 * (((uint64_t)height + 3) / 4) * 8;
+    }
+    return (uint64_t)width * height * 3;
+}
+
+
+static uint32_t getMipDimension(uint32_t base, uint32_t level) {
+    uint32_t dimension = base >> level;
+    return dimension > 0 ? dimension : 1;
+}
+
+
+// Levels are uploaded straight from the data, so every level must match the storage mip chain
+// and lie fully inside the container
+static Status validateContainer(const TextureContainerHeader* header, size_t size) {
+    if (header->magic != TEXTURE_CONTAINER_MAGIC || header->version != TEXTURE_CONTAINER_VERSION) {
+        puts("Unknown texture container version");
+        return STATUS_ERR;
+    }
+    if (header->format != TEXTURE_FORMAT_RGB8 && header->format != TEXTURE_FORMAT_BC1) {
+        puts("Unknown texture container format");
+        return STATUS_ERR;
+    }
+    if (header->width == 0 || header->height == 0
+            || header->width > TEXTURE_CONTAINER_MAX_SIZE || header->height > TEXTURE_CONTAINER_MAX_SIZE) {
+        puts("Invalid texture dimensions");
+        return STATUS_ERR;
+    }
+    if (header->n_levels == 0 || header->n_levels > getTextureMipLevelCount(header->width, header->height)) {
+        puts("Invalid number of texture levels");
+        return STATUS_ERR;
+    }
+    for (uint32_t i = 0; i < header->n_levels; ++i) {
+        const TextureContainerLevel* level = &header->levels[i];
+        if (level->width != getMipDimension(header->width, i) || level->height != getMipDimension(header->height, i)) {
+            puts("Texture level dimensions do not match mip chain");
+            return STATUS_ERR;
+        }
+        if (level->size != getTextureLevelSize(header->format, level->width, level->height)) {
+            puts("Texture level size does not match its dimensions");
+            return STATUS_ERR;
+        }
+        if ((uint64_t)level->offset + level->size > size) {
+            puts("Texture level is out of container bounds");
+            return STATUS_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+
+Status initTextureFromContainer(const void* data, size_t size, GLuint* texture_id) {
+    TextureContainerHeader header;
+    if (size < sizeof(header)) {
+        puts("Texture container is too small");
+        return STATUS_ERR;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if (validateContainer(&header, size) != STATUS_OK) {
+        return STATUS_ERR;
+    }
+
+    GLenum internal_format;
+    if (header.format == TEXTURE_FORMAT_RGB8) {
+        internal_format = GL_RGB8;
+    } else if (header.format == TEXTURE_FORMAT_BC1 && GLAD_GL_EXT_texture_compression_s3tc) {
+        internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    } else {
+        puts("Unsupported texture container format");
+        return STATUS_ERR;
+    }
+
+    glCreateTextures(GL_TEXTURE_2D, 1, texture_id);
+    glTextureParameteri(*texture_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(*texture_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(*texture_id, GL_TEXTURE_MAX_LEVEL, header.n_levels - 1);
+    glTextureStorage2D(*texture_id, header.n_levels, internal_format, header.width, header.height);
+
+    // RGB rows of small levels are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    const unsigned char* bytes = data;
+    for (uint32_t i = 0; i < header.n_levels; ++i) {
+        const TextureContainerLevel* level = &header.levels[i];
+        if (header.format == TEXTURE_FORMAT_RGB8) {
+            glTextureSubImage2D(*texture_id, i, 0, 0, level->width, level->height,
+                                GL_RGB, GL_UNSIGNED_BYTE, bytes + level->offset);
+        } else {
+            glCompressedTextureSubImage2D(*texture_id, i, 0, 0, level->width, level->height,
+                                          internal_format, level->size, bytes + level->offset);
+        }
+    }
+    return STATUS_OK;
+}
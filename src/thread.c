@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread.h"
+#include "allocation.h"
+
+
+// Native entry points take a different signature, so function and argument travel together
+typedef struct {
+    ThreadFunction function;
+    void* arg;
+} ThreadStart;
+
+
+static ThreadStart* initThreadStart(ThreadFunction function, void* arg) {
+    ThreadStart* start = allocateMemory(sizeof(ThreadStart));
+    if (start) {
+        start->function = function;
+        start->arg = arg;
+    }
+    return start;
+}
+
+
+#ifdef _WIN32
+#include <windows.h>
+
+
+static DWORD WINAPI runThread(LPVOID param) {
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.function(start.arg);
+    return 0;
+}
+
+
+Status startThread(Thread* thread, ThreadFunction function, void* arg) {
+    ThreadStart* start = initThreadStart(function, arg);
+    if (!start) {
+        return STATUS_ERR;
+    }
+    HANDLE handle = CreateThread(NULL, 0, runThread, start, 0, NULL);
+    if (!handle) {
+        puts("Unable to start thread");
+        free(start);
+        return STATUS_ERR;
+    }
+    thread->handle = handle;
+    return STATUS_OK;
+}
+
+
+void joinThread(Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+}
+
+
+size_t getProcessorCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+Status initMutex(Mutex* mutex) {
+    CRITICAL_SECTION* handle = allocateMemory(sizeof(CRITICAL_SECTION));
+    if (!handle) {
+        return STATUS_ERR;
+    }
+    InitializeCriticalSection(handle);
+    mutex->handle = handle;
+    return STATUS_OK;
+}
+
+
+void freeMutex(Mutex* mutex) {
+    if (mutex->handle) {
+        DeleteCriticalSection(mutex->handle);
+        free(mutex->handle);
+        mutex->handle = NULL;
+    }
+}
+
+
+void lockMutex(Mutex* mutex) {
+    EnterCriticalSection(mutex->handle);
+}
+
+
+void unlockMutex(Mutex* mutex) {
+    LeaveCriticalSection(mutex->handle);
+}
+
+
+Status initConditionVariable(ConditionVariable* condition) {
+    CONDITION_VARIABLE* handle = allocateMemory(sizeof(CONDITION_VARIABLE));
+    if (!handle) {
+        return STATUS_ERR;
+    }
+    InitializeConditionVariable(handle);
+    condition->handle = handle;
+    return STATUS_OK;
+}
+
+
+void freeConditionVariable(ConditionVariable* condition) {
+    free(condition->handle);
+    condition->handle = NULL;
+}
+
+
+void waitConditionVariable(ConditionVariable* condition, Mutex* mutex) {
+    SleepConditionVariableCS(condition->handle, mutex->handle, INFINITE);
+}
+
+
+void wakeAllConditionVariable(ConditionVariable* condition) {
+    WakeAllConditionVariable(condition->handle);
+}
+
+
+void addAtomicCounter(AtomicCounter* counter, int64_t n) {
+    InterlockedExchangeAdd64((volatile LONG64*)&counter->value, n);
+}
+
+
+void storeAtomicCounter(AtomicCounter* counter, int64_t value) {
+    InterlockedExchange64((volatile LONG64*)&counter->value, value);
+}
+
+
+int64_t loadAtomicCounter(AtomicCounter* counter) {
+    return InterlockedCompareExchange64((volatile LONG64*)&counter->value, 0, 0);
+}
+
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+
+static void* runThread(void* param) {
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.function(start.arg);
+    return NULL;
+}
+
+
+Status startThread(Thread* thread, ThreadFunction function, void* arg) {
+    ThreadStart* start = initThreadStart(function, arg);
+    pthread_t* handle = allocateMemory(sizeof(pthread_t));
+    if (!start || !handle) {
+        free(start);
+        free(handle);
+        return STATUS_ERR;
+    }
+    if (pthread_create(handle, NULL, runThread, start) != 0) {
+        puts("Unable to start thread");
+        free(start);
+        free(handle);
+        return STATUS_ERR;
+    }
+    thread->handle = handle;
+    return STATUS_OK;
+}
+
+
+void joinThread(Thread* thread) {
+    pthread_join(*(pthread_t*)thread->handle, NULL);
+    free(thread->handle);
+    thread->handle = NULL;
+}
+
+
+size_t getProcessorCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+
+Status initMutex(Mutex* mutex) {
+    pthread_mutex_t* handle = allocateMemory(sizeof(pthread_mutex_t));
+    if (!handle || pthread_mutex_init(handle, NULL) != 0) {
+        free(handle);
+        return STATUS_ERR;
+    }
+    mutex->handle = handle;
+    return STATUS_OK;
+}
+
+
+void freeMutex(Mutex* mutex) {
+    if (mutex->handle) {
+        pthread_mutex_destroy(mutex->handle);
+        free(mutex->handle);
+        mutex->handle = NULL;
+    }
+}
+
+
+void lockMutex(Mutex* mutex) {
+    pthread_mutex_lock(mutex->handle);
+}
+
+
+void unlockMutex(Mutex* mutex) {
+    pthread_mutex_unlock(mutex->handle);
+}
+
+
+Status initConditionVariable(ConditionVariable* condition) {
+    pthread_cond_t* handle = allocateMemory(sizeof(pthread_cond_t));
+    if (!handle || pthread_cond_init(handle, NULL) != 0) {
+        free(handle);
+        return STATUS_ERR;
+    }
+    condition->handle = handle;
+    return STATUS_OK;
+}
+
+
+void freeConditionVariable(ConditionVariable* condition) {
+    if (condition->handle) {
+        pthread_cond_destroy(condition->handle);
+        free(condition->handle);
+        condition->handle = NULL;
+    }
+}
+
+
+void waitConditionVariable(ConditionVariable* condition, Mutex* mutex) {
+    pthread_cond_wait(condition->handle, mutex->handle);
+}
+
+
+void wakeAllConditionVariable(ConditionVariable* condition) {
+    pthread_cond_broadcast(condition->handle);
+}
+
+
+void addAtomicCounter(AtomicCounter* counter, int64_t n) {
+    __atomic_fetch_add(&counter->value, n, __ATOMIC_RELAXED);
+}
+
+
+void storeAtomicCounter(AtomicCounter* counter, int64_t value) {
+    __atomic_store_n(&counter->value, value, __ATOMIC_RELAXED);
+}
+
+
+int64_t loadAtomicCounter(AtomicCounter* counter) {
+    return __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <math.h>
+
+#include "top_face.h"
+#include "top_face_kernels.h"
+#include "cpu_features.h"
+
+
+// Baseline kernel built into this file, wider ones have their own files compiled with extra flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOP_FACE_SSE2
+#endif
+
+enum {
+    TOP_FACE_CHUNK = 64  // dice gathered per kernel call
+};
+
+
+// Argmax of dot(face normal, up) over faces of mesh, lowest face on ties
+static size_t findTopFace(const DiceMesh* mesh, float ux, float uy, float uz) {
+    size_t top = 0;
+    float top_dot = -INFINITY;
+    for (size_t f = 0; f < mesh->n_faces; ++f) {
+        float d = mesh->normal_x[f] * ux + mesh->normal_y[f] * uy + mesh->normal_z[f] * uz + mesh->normal_bias[f];
+        if (d > top_dot) {
+            top_dot = d;
+            top = f;
+        }
+    }
+    return top;
+}
+
+
+size_t getDiceTopFace(DiceType type, const versor orientation) {
+    // Model space up is the third row of the rotation matrix: rotate(q, n).z = dot(n, row).
+    // Written homogeneously, so it is only scaled by |q|^2 for non-normalized quaternions
+    float x = orientation[0], y = orientation[1], z = orientation[2], w = orientation[3];
+    float ux = 2.0f * (x * z - w * y);
+    float uy = 2.0f * (y * z + w * x);
+    float uz = w * w - x * x - y * y + z * z;
+    return findTopFace(&gDiceMeshes[type], ux, uy, uz);
+}
+
+
+int getDiceTopValue(DiceType type, const versor orientation) {
+    return gDiceMeshes[type].face_value[getDiceTopFace(type, orientation)];
+}
+
+
+#ifdef TOP_FACE_SSE2
+static void findTopFacesSse2(const DiceType* types, const float* orientations, size_t n, uint8_t* faces) {
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (size_t i = 0; i < n; i += 4) {
+        __m128 x = _mm_loadu_ps(orientations + 4 * i);
+        __m128 y = _mm_loadu_ps(orientations + 4 * i + 4);
+        __m128 z = _mm_loadu_ps(orientations + 4 * i + 8);
+        __m128 w = _mm_loadu_ps(orientations + 4 * i + 12);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        __m128 ux = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(x, z), _mm_mul_ps(w, y)));
+        __m128 uy = _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(y, z), _mm_mul_ps(w, x)));
+        __m128 uz = _mm_sub_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x));
+        uz = _mm_add_ps(_mm_sub_ps(uz, _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+        // No gather in SSE2, normals of each lane's type are loaded one by one
+        const DiceMesh* mesh[4];
+        size_t max_faces = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            mesh[lane] = &gDiceMeshes[types[i + lane]];
+            max_faces = mesh[lane]->n_faces > max_faces ? mesh[lane]->n_faces : max_faces;
+        }
+
+        __m128 best = _mm_set1_ps(-INFINITY);
+        __m128i best_index = _mm_setzero_si128();
+        for (size_t f = 0; f < max_faces; ++f) {
+            __m128 nx = _mm_setr_ps(mesh[0]->normal_x[f], mesh[1]->normal_x[f], mesh[2]->normal_x[f],
+                                    mesh[3]->normal_x[f]);
+            __m128 ny = _mm_setr_ps(mesh[0]->normal_y[f], mesh[1]->normal_y[f], mesh[2]->normal_y[f],
+                                    mesh[3]->normal_y[f]);
+            __m128 nz = _mm_setr_ps(mesh[0]->normal_z[f], mesh[1]->normal_z[f], mesh[2]->normal_z[f],
+                                    mesh[3]->normal_z[f]);
+            __m128 nb = _mm_setr_ps(mesh[0]->normal_bias[f], mesh[1]->normal_bias[f], mesh[2]->normal_bias[f],
+                                    mesh[3]->normal_bias[f]);
+            __m128 d = _mm_add_ps(_mm_mul_ps(nx, ux), _mm_mul_ps(ny, uy));
+            d = _mm_add_ps(_mm_add_ps(d, _mm_mul_ps(nz, uz)), nb);
+            // Strictly greater keeps the lowest face on ties. SSE2 has no blend, select with masks
+            __m128 greater = _mm_cmpgt_ps(d, best);
+            __m128i is_greater = _mm_castps_si128(greater);
+            best = _mm_or_ps(_mm_and_ps(greater, d), _mm_andnot_ps(greater, best));
+            best_index = _mm_or_si128(_mm_and_si128(is_greater, _mm_set1_epi32((int)f)),
+                                      _mm_andnot_si128(is_greater, best_index));
+        }
+
+        int32_t top[4];
+        _mm_storeu_si128((__m128i*)top, best_index);
+        for (int lane = 0; lane < 4; ++lane) {
+            faces[i + lane] = (uint8_t)top[lane];
+        }
+    }
+}
+
+
+const TopFaceKernels TOP_FACE_KERNELS_BASELINE = { 4, findTopFacesSse2 };
+#else
+const TopFaceKernels TOP_FACE_KERNELS_BASELINE = { 0 };
+#endif
+
+
+// Widest kernel supported by both the build and the CPU, width 0 if there is none
+static const TopFaceKernels* getTopFaceKernels(void) {
+    if (TOP_FACE_KERNELS_AVX512.width > 0 && hasCpuAvx512()) {
+        return &TOP_FACE_KERNELS_AVX512;
+    }
+    if (TOP_FACE_KERNELS_AVX2.width > 0 && hasCpuAvx2()) {
+        return &TOP_FACE_KERNELS_AVX2;
+    }
+    return &TOP_FACE_KERNELS_BASELINE;
+}
+
+
+void getDiceTopFaces(const DiceType* types, versor* orientations, size_t n, uint8_t* faces, int* values) {
+    const TopFaceKernels* kernels = getTopFaceKernels();
+    for (size_t first = 0; first < n; first += TOP_FACE_CHUNK) {
+        size_t count = n - first < TOP_FACE_CHUNK ? n - first : TOP_FACE_CHUNK;
+        size_t n_vector = kernels->width > 0 ? count - count % kernels->width : 0;
+        uint8_t chunk_faces[TOP_FACE_CHUNK];
+        if (n_vector > 0) {
+            kernels->findTopFaces(types + first, orientations[first], n_vector, chunk_faces);
+        }
+        for (size_t i = n_vector; i < count; ++i) {
+            chunk_faces[i] = (uint8_t)getDiceTopFace(types[first + i], orientations[first + i]);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (faces) {
+                faces[first + i] = chunk_faces[i];
+            }
+            if (values) {
+                values[first + i] = gDiceMeshes[types[first + i]].face_value[chunk_faces[i]];
+            }
+        }
+    }
+}
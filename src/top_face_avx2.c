@@ -0,0 +1,61 @@
+#include <math.h>
+
+#include "top_face_kernels.h"
+
+
+// Compiled with AVX2 enabled on x86 and only called after CPUID reports it
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static void findTopFacesAvx2(const DiceType* types, const float* orientations, size_t n, uint8_t* faces) {
+    const __m256i component_index = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    for (size_t i = 0; i < n; i += 8) {
+        const float* q = orientations + 4 * i;
+        __m256 x = _mm256_i32gather_ps(q + 0, component_index, 4);
+        __m256 y = _mm256_i32gather_ps(q + 1, component_index, 4);
+        __m256 z = _mm256_i32gather_ps(q + 2, component_index, 4);
+        __m256 w = _mm256_i32gather_ps(q + 3, component_index, 4);
+        __m256 ux = _mm256_mul_ps(two, _mm256_sub_ps(_mm256_mul_ps(x, z), _mm256_mul_ps(w, y)));
+        __m256 uy = _mm256_mul_ps(two, _mm256_add_ps(_mm256_mul_ps(y, z), _mm256_mul_ps(w, x)));
+        __m256 uz = _mm256_sub_ps(_mm256_mul_ps(w, w), _mm256_mul_ps(x, x));
+        uz = _mm256_add_ps(_mm256_sub_ps(uz, _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+
+        // Byte offsets of face tables of each lane's type, faces past the end of a type are padding
+        int32_t mesh_offset[8];
+        size_t max_faces = 0;
+        for (int lane = 0; lane < 8; ++lane) {
+            mesh_offset[lane] = (int32_t)(types[i + lane] * sizeof(DiceMesh));
+            size_t n_faces = gDiceMeshes[types[i + lane]].n_faces;
+            max_faces = n_faces > max_faces ? n_faces : max_faces;
+        }
+        __m256i offset = _mm256_loadu_si256((const __m256i*)mesh_offset);
+
+        __m256 best = _mm256_set1_ps(-INFINITY);
+        __m256 best_index = _mm256_setzero_ps();
+        for (size_t f = 0; f < max_faces; ++f) {
+            __m256i index = _mm256_add_epi32(offset, _mm256_set1_epi32((int)(f * sizeof(float))));
+            __m256 d = _mm256_mul_ps(_mm256_i32gather_ps(gDiceMeshes[0].normal_x, index, 1), ux);
+            d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_i32gather_ps(gDiceMeshes[0].normal_y, index, 1), uy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_i32gather_ps(gDiceMeshes[0].normal_z, index, 1), uz));
+            d = _mm256_add_ps(d, _mm256_i32gather_ps(gDiceMeshes[0].normal_bias, index, 1));
+            // Strictly greater keeps the lowest face on ties
+            __m256 greater = _mm256_cmp_ps(d, best, _CMP_GT_OQ);
+            best = _mm256_blendv_ps(best, d, greater);
+            best_index = _mm256_blendv_ps(best_index, _mm256_castsi256_ps(_mm256_set1_epi32((int)f)), greater);
+        }
+
+        int32_t top[8];
+        _mm256_storeu_si256((__m256i*)top, _mm256_castps_si256(best_index));
+        for (int lane = 0; lane < 8; ++lane) {
+            faces[i + lane] = (uint8_t)top[lane];
+        }
+    }
+}
+
+
+const TopFaceKernels TOP_FACE_KERNELS_AVX2 = { 8, findTopFacesAvx2 };
+
+#else
+const TopFaceKernels TOP_FACE_KERNELS_AVX2 = { 0 };
+#endif
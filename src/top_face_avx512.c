@@ -0,0 +1,56 @@
+#include <math.h>
+
+#include "top_face_kernels.h"
+
+
+// Compiled with AVX-512F enabled on x86 and only called after CPUID reports it
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+static void findTopFacesAvx512(const DiceType* types, const float* orientations, size_t n, uint8_t* faces) {
+    const __m512i component_index = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    for (size_t i = 0; i < n; i += 16) {
+        const float* q = orientations + 4 * i;
+        __m512 x = _mm512_i32gather_ps(component_index, q + 0, 4);
+        __m512 y = _mm512_i32gather_ps(component_index, q + 1, 4);
+        __m512 z = _mm512_i32gather_ps(component_index, q + 2, 4);
+        __m512 w = _mm512_i32gather_ps(component_index, q + 3, 4);
+        __m512 ux = _mm512_mul_ps(two, _mm512_sub_ps(_mm512_mul_ps(x, z), _mm512_mul_ps(w, y)));
+        __m512 uy = _mm512_mul_ps(two, _mm512_add_ps(_mm512_mul_ps(y, z), _mm512_mul_ps(w, x)));
+        __m512 uz = _mm512_sub_ps(_mm512_mul_ps(w, w), _mm512_mul_ps(x, x));
+        uz = _mm512_add_ps(_mm512_sub_ps(uz, _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+
+        // Byte offsets of face tables of each lane's type, faces past the end of a type are padding
+        int32_t mesh_offset[16];
+        size_t max_faces = 0;
+        for (int lane = 0; lane < 16; ++lane) {
+            mesh_offset[lane] = (int32_t)(types[i + lane] * sizeof(DiceMesh));
+            size_t n_faces = gDiceMeshes[types[i + lane]].n_faces;
+            max_faces = n_faces > max_faces ? n_faces : max_faces;
+        }
+        __m512i offset = _mm512_loadu_si512(mesh_offset);
+
+        __m512 best = _mm512_set1_ps(-INFINITY);
+        __m512i best_index = _mm512_setzero_si512();
+        for (size_t f = 0; f < max_faces; ++f) {
+            __m512i index = _mm512_add_epi32(offset, _mm512_set1_epi32((int)(f * sizeof(float))));
+            __m512 d = _mm512_mul_ps(_mm512_i32gather_ps(index, gDiceMeshes[0].normal_x, 1), ux);
+            d = _mm512_add_ps(d, _mm512_mul_ps(_mm512_i32gather_ps(index, gDiceMeshes[0].normal_y, 1), uy));
+            d = _mm512_add_ps(d, _mm512_mul_ps(_mm512_i32gather_ps(index, gDiceMeshes[0].normal_z, 1), uz));
+            d = _mm512_add_ps(d, _mm512_i32gather_ps(index, gDiceMeshes[0].normal_bias, 1));
+            // Strictly greater keeps the lowest face on ties
+            __mmask16 greater = _mm512_cmp_ps_mask(d, best, _CMP_GT_OQ);
+            best = _mm512_mask_blend_ps(greater, best, d);
+            best_index = _mm512_mask_blend_epi32(greater, best_index, _mm512_set1_epi32((int)f));
+        }
+        _mm_storeu_si128((__m128i*)(faces + i), _mm512_cvtepi32_epi8(best_index));
+    }
+}
+
+
+const TopFaceKernels TOP_FACE_KERNELS_AVX512 = { 16, findTopFacesAvx512 };
+
+#else
+const TopFaceKernels TOP_FACE_KERNELS_AVX512 = { 0 };
+#endif
@@ -0,0 +1,138 @@
+#include "transform.h"
+#include "quat_batch.h"
+
+
+void initCameraTransform(CameraTransform* camera) {
+    *camera = (CameraTransform) {
+        .fov_deg = 45.0f,
+        .near_z = 0.1f,
+        .far_z = 100.0f,
+        .aspect_ratio = 1.0f,
+        .light_direction = { 0.0f, 0.0f, 1.0f },
+        .dirty = CAMERA_DIRTY_VIEW | CAMERA_DIRTY_PROJECTION | CAMERA_DIRTY_LIGHT,
+    };
+}
+
+
+void setCameraPosition(CameraTransform* camera, vec3 position) {
+    if (!glm_vec3_eqv(camera->position, position)) {
+        glm_vec3_copy(position, camera->position);
+        camera->dirty |= CAMERA_DIRTY_VIEW;
+    }
+}
+
+
+void setCameraLens(CameraTransform* camera, float fov_deg, float near_z, float far_z) {
+    if (camera->fov_deg != fov_deg || camera->near_z != near_z || camera->far_z != far_z) {
+        camera->fov_deg = fov_deg;
+        camera->near_z = near_z;
+        camera->far_z = far_z;
+        camera->dirty |= CAMERA_DIRTY_PROJECTION;
+    }
+}
+
+
+void setCameraViewport(CameraTransform* camera, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    float aspect_ratio = (float)width / (float)height;
+    if (camera->aspect_ratio != aspect_ratio) {
+        camera->aspect_ratio = aspect_ratio;
+        camera->dirty |= CAMERA_DIRTY_PROJECTION;
+    }
+}
+
+
+void setCameraLightDirection(CameraTransform* camera, vec3 direction) {
+    if (!glm_vec3_eqv(camera->light_direction, direction)) {
+        glm_vec3_copy(direction, camera->light_direction);
+        camera->dirty |= CAMERA_DIRTY_LIGHT;
+    }
+}
+
+
+void updateCameraTransform(CameraTransform* camera) {
+    if (camera->dirty & CAMERA_DIRTY_VIEW) {
+        glm_translate_make(camera->view, camera->position);
+        camera->dirty |= CAMERA_DIRTY_LIGHT;  // light is kept in view space
+    }
+    if (camera->dirty & CAMERA_DIRTY_PROJECTION) {
+        glm_perspective(glm_rad(camera->fov_deg), camera->aspect_ratio, camera->near_z, camera->far_z,
+                        camera->projection);
+    }
+    if (camera->dirty & (CAMERA_DIRTY_VIEW | CAMERA_DIRTY_PROJECTION)) {
+        glm_mat4_mul(camera->projection, camera->view, camera->view_projection);
+    }
+    if (camera->dirty & CAMERA_DIRTY_LIGHT) {
+        computeViewLightDirection(camera->view, camera->light_direction, camera->view_light_direction);
+    }
+    camera->dirty = 0;
+}
+
+
+void computeViewLightDirection(mat4 view, vec3 direction, vec3 out_direction) {
+    mat3 view_matrix3;
+    glm_mat4_pick3(view, view_matrix3);
+    vec3 norm_direction;
+    glm_vec3_normalize_to(direction, norm_direction);
+    glm_mat3_mulv(view_matrix3, norm_direction, out_direction);
+}
+
+
+// Inverse transpose of view * s * R is view * R / s when view is a rotation, which is model / s^2
+void computeNormalMatrix(mat4 view, mat4 model, float scale, mat4 normal_matrix) {
+    float inv_scale2 = 1.0f / (scale * scale);
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            normal_matrix[c][r] = (view[0][r] * model[c][0] + view[1][r] * model[c][1] + view[2][r] * model[c][2])
+                                  * inv_scale2;
+        }
+        normal_matrix[c][3] = 0.0f;
+    }
+    glm_vec4_copy((vec4) { 0.0f, 0.0f, 0.0f, 1.0f }, normal_matrix[3]);
+}
+
+
+// Rotations of a chunk come from the batch kernel, model is translation * scale * rotation and normal
+// matrix is view * rotation / scale
+void computeDiceInstances(mat4 view, const DiceWorld* world, const uint32_t* dice, size_t n,
+                          DiceInstance* instances) {
+    float q[4][QUAT_BATCH_CHUNK], m[3][3][QUAT_BATCH_CHUNK];
+    QuatArrays quats = { q[0], q[1], q[2], q[3] };
+    Mat3Arrays rotation;
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            rotation.m[c][r] = m[c][r];
+        }
+    }
+
+    for (size_t first = 0; first < n; first += QUAT_BATCH_CHUNK) {
+        size_t n_chunk = n - first < QUAT_BATCH_CHUNK ? n - first : QUAT_BATCH_CHUNK;
+        for (size_t k = 0; k < n_chunk; ++k) {
+            for (int c = 0; c < 4; ++c) {
+                q[c][k] = world->orientation[dice[first + k]][c];
+            }
+        }
+        quatsToMat3(quats, rotation, n_chunk);
+
+        for (size_t k = 0; k < n_chunk; ++k) {
+            uint32_t i = dice[first + k];
+            DiceInstance* instance = &instances[first + k];
+            float scale = world->scale[i];
+            float inv_scale = 1.0f / scale;
+            for (int c = 0; c < 3; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    instance->model[c][r] = m[c][r][k] * scale;
+                    instance->normal_matrix[c][r] = (view[0][r] * m[c][0][k] + view[1][r] * m[c][1][k]
+                                                     + view[2][r] * m[c][2][k]) * inv_scale;
+                }
+                instance->model[c][3] = 0.0f;
+                instance->normal_matrix[c][3] = 0.0f;
+            }
+            const float* p = world->position[i];
+            glm_vec4_copy((vec4) { p[0], p[1], p[2], 1.0f }, instance->model[3]);
+            glm_vec4_copy((vec4) { 0.0f, 0.0f, 0.0f, 1.0f }, instance->normal_matrix[3]);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <stddef.h>
+
+#include "yuv.h"
+#include "yuv_kernels.h"
+#include "cpu_features.h"
+
+
+// Baseline kernel built into this file, the AVX2 one has its own file compiled with extra flags
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YUV_SSE2
+#endif
+
+
+// BT.601 limited range in 8-bit fixed point
+static unsigned char getLuma(int r, int g, int b) {
+    return (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+
+static unsigned char getChromaBlue(int r, int g, int b) {
+    return (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+
+static unsigned char getChromaRed(int r, int g, int b) {
+    return (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+
+// Convert pixels from column x of a row pair. Second luma row is NULL for the last row of odd height,
+// in which case row1 is row0
+static void convertRowPairScalar(const unsigned char* row0, const unsigned char* row1, int x, int width,
+                                 unsigned char* luma0, unsigned char* luma1, unsigned char* u, unsigned char* v) {
+    for (int i = x; i < width; ++i) {
+        luma0[i] = getLuma(row0[i * 4 + 0], row0[i * 4 + 1], row0[i * 4 + 2]);
+        if (luma1) {
+            luma1[i] = getLuma(row1[i * 4 + 0], row1[i * 4 + 1], row1[i * 4 + 2]);
+        }
+    }
+
+    for (int i = x; i < width; i += 2) {
+        int next = i + 1 < width ? i + 1 : i;
+        int sum[3];
+        for (int c = 0; c < 3; ++c) {
+            sum[c] = row0[i * 4 + c] + row0[next * 4 + c] + row1[i * 4 + c] + row1[next * 4 + c];
+            sum[c] = (sum[c] + 2) >> 2;
+        }
+        u[i / 2] = getChromaBlue(sum[0], sum[1], sum[2]);
+        v[i / 2] = getChromaRed(sum[0], sum[1], sum[2]);
+    }
+}
+
+
+#ifdef YUV_SSE2
+// One channel of 8 RGBA pixels as 16-bit lanes
+static __m128i getChannel(__m128i p0, __m128i p1, int shift) {
+    __m128i mask = _mm_set1_epi32(0xFF);
+    __m128i c0 = _mm_and_si128(_mm_srli_epi32(p0, shift), mask);
+    __m128i c1 = _mm_and_si128(_mm_srli_epi32(p1, shift), mask);
+    return _mm_packs_epi32(c0, c1);
+}
+
+
+// Sums wrap around 16 bits, which the logical shift reads as unsigned
+static __m128i getLumaLanes(__m128i r, __m128i g, __m128i b) {
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+
+static __m128i getChromaLanes(__m128i r, __m128i g, __m128i b, short wr, short wg, short wb) {
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(wr)), _mm_mullo_epi16(g, _mm_set1_epi16(wg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(wb)));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+    return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+
+// Horizontal pixel pairs of a channel in two rows summed into 32-bit lanes
+static __m128i sumPairs(__m128i c0, __m128i c1) {
+    __m128i sum = _mm_add_epi16(c0, c1);
+    return _mm_add_epi32(_mm_and_si128(sum, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(sum, 16));
+}
+
+
+// 2x2 averages of a channel over 16 pixels of a row pair
+static __m128i averageBlocks(const __m128i* c0, const __m128i* c1) {
+    __m128i sum = _mm_packs_epi32(sumPairs(c0[0], c1[0]), sumPairs(c0[1], c1[1]));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+
+// Convert blocks of 16 pixels
+static int convertRowPairSse2(const unsigned char* row0, const unsigned char* row1, int width,
+                              unsigned char* luma0, unsigned char* luma1, unsigned char* u, unsigned char* v) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        // Channels by row and by half of the block
+        __m128i r[2][2], g[2][2], b[2][2];
+        for (int row = 0; row < 2; ++row) {
+            const unsigned char* src = (row == 0 ? row0 : row1) + x * 4;
+            for (int half = 0; half < 2; ++half) {
+                __m128i p0 = _mm_loadu_si128((const __m128i*)(src + half * 32));
+                __m128i p1 = _mm_loadu_si128((const __m128i*)(src + half * 32 + 16));
+                r[row][half] = getChannel(p0, p1, 0);
+                g[row][half] = getChannel(p0, p1, 8);
+                b[row][half] = getChannel(p0, p1, 16);
+            }
+        }
+
+        _mm_storeu_si128((__m128i*)(luma0 + x), _mm_packus_epi16(getLumaLanes(r[0][0], g[0][0], b[0][0]),
+                                                                 getLumaLanes(r[0][1], g[0][1], b[0][1])));
+        if (luma1) {
+            _mm_storeu_si128((__m128i*)(luma1 + x), _mm_packus_epi16(getLumaLanes(r[1][0], g[1][0], b[1][0]),
+                                                                     getLumaLanes(r[1][1], g[1][1], b[1][1])));
+        }
+
+        __m128i ar = averageBlocks(r[0], r[1]);
+        __m128i ag = averageBlocks(g[0], g[1]);
+        __m128i ab = averageBlocks(b[0], b[1]);
+        __m128i cb = getChromaLanes(ar, ag, ab, -38, -74, 112);
+        __m128i cr = getChromaLanes(ar, ag, ab, 112, -94, -18);
+        _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(cb, cb));
+        _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(cr, cr));
+    }
+    return x;
+}
+
+
+const YuvKernels YUV_KERNELS_BASELINE = { 16, convertRowPairSse2 };
+#else
+const YuvKernels YUV_KERNELS_BASELINE = { 0 };
+#endif
+
+
+// Widest kernel supported by both the build and the CPU, width 0 if there is none
+static const YuvKernels* getYuvKernels(void) {
+    if (YUV_KERNELS_AVX2.width > 0 && hasCpuAvx2()) {
+        return &YUV_KERNELS_AVX2;
+    }
+    return &YUV_KERNELS_BASELINE;
+}
+
+
+void convertRgbaToYuv420(const unsigned char* rgba, int width, int height, bool is_bottom_up,
+                         unsigned char* y_plane, unsigned char* u_plane, unsigned char* v_plane) {
+    size_t row_size = (size_t)width * 4;
+    size_t chroma_width = (size_t)(width + 1) / 2;
+    const YuvKernels* kernels = getYuvKernels();
+    for (int y = 0; y < height; y += 2) {
+        int y_next = y + 1 < height ? y + 1 : y;
+        const unsigned char* row0 = rgba + (size_t)(is_bottom_up ? height - 1 - y : y) * row_size;
+        const unsigned char* row1 = rgba + (size_t)(is_bottom_up ? height - 1 - y_next : y_next) * row_size;
+        unsigned char* luma0 = y_plane + (size_t)y * width;
+        unsigned char* luma1 = y_next != y ? y_plane + (size_t)y_next * width : NULL;
+        unsigned char* u = u_plane + (size_t)(y / 2) * chroma_width;
+        unsigned char* v = v_plane + (size_t)(y / 2) * chroma_width;
+
+        int x = kernels->width > 0 ? kernels->convertRowPair(row0, row1, width, luma0, luma1, u, v) : 0;
+        convertRowPairScalar(row0, row1, x, width, luma0, luma1, u, v);
+    }
+}
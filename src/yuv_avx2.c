@@ -0,0 +1,99 @@
+#include "yuv_kernels.h"
+
+
+// Compiled with AVX2 enabled on x86 and only called after CPUID reports it. Kernels work on 16-bit
+// integer lanes, so 256-bit vectors need AVX2 rather than AVX
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// One channel of 16 RGBA pixels as 16-bit lanes. Packing works within 128-bit halves, the permute
+// restores pixel order
+static __m256i getChannel(__m256i p0, __m256i p1, int shift) {
+    __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i c0 = _mm256_and_si256(_mm256_srli_epi32(p0, shift), mask);
+    __m256i c1 = _mm256_and_si256(_mm256_srli_epi32(p1, shift), mask);
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(c0, c1), 0xD8);
+}
+
+
+// Sums wrap around 16 bits, which the logical shift reads as unsigned
+static __m256i getLumaLanes(__m256i r, __m256i g, __m256i b) {
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                                   _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+    sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+    sum = _mm256_add_epi16(sum, _mm256_set1_epi16(128));
+    return _mm256_add_epi16(_mm256_srli_epi16(sum, 8), _mm256_set1_epi16(16));
+}
+
+
+static __m256i getChromaLanes(__m256i r, __m256i g, __m256i b, short wr, short wg, short wb) {
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(wr)),
+                                   _mm256_mullo_epi16(g, _mm256_set1_epi16(wg)));
+    sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(b, _mm256_set1_epi16(wb)));
+    sum = _mm256_add_epi16(sum, _mm256_set1_epi16(128));
+    return _mm256_add_epi16(_mm256_srai_epi16(sum, 8), _mm256_set1_epi16(128));
+}
+
+
+// Horizontal pixel pairs of a channel in two rows summed into 32-bit lanes
+static __m256i sumPairs(__m256i c0, __m256i c1) {
+    __m256i sum = _mm256_add_epi16(c0, c1);
+    return _mm256_add_epi32(_mm256_and_si256(sum, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(sum, 16));
+}
+
+
+// 2x2 averages of a channel over 32 pixels of a row pair
+static __m256i averageBlocks(const __m256i* c0, const __m256i* c1) {
+    __m256i sum = _mm256_packs_epi32(sumPairs(c0[0], c1[0]), sumPairs(c0[1], c1[1]));
+    sum = _mm256_permute4x64_epi64(sum, 0xD8);
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+
+static __m256i packBytes(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+
+// Convert blocks of 32 pixels
+static int convertRowPairAvx2(const unsigned char* row0, const unsigned char* row1, int width,
+                             unsigned char* luma0, unsigned char* luma1, unsigned char* u, unsigned char* v) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        // Channels by row and by half of the block
+        __m256i r[2][2], g[2][2], b[2][2];
+        for (int row = 0; row < 2; ++row) {
+            const unsigned char* src = (row == 0 ? row0 : row1) + x * 4;
+            for (int half = 0; half < 2; ++half) {
+                __m256i p0 = _mm256_loadu_si256((const __m256i*)(src + half * 64));
+                __m256i p1 = _mm256_loadu_si256((const __m256i*)(src + half * 64 + 32));
+                r[row][half] = getChannel(p0, p1, 0);
+                g[row][half] = getChannel(p0, p1, 8);
+                b[row][half] = getChannel(p0, p1, 16);
+            }
+        }
+
+        _mm256_storeu_si256((__m256i*)(luma0 + x), packBytes(getLumaLanes(r[0][0], g[0][0], b[0][0]),
+                                                             getLumaLanes(r[0][1], g[0][1], b[0][1])));
+        if (luma1) {
+            _mm256_storeu_si256((__m256i*)(luma1 + x), packBytes(getLumaLanes(r[1][0], g[1][0], b[1][0]),
+                                                                 getLumaLanes(r[1][1], g[1][1], b[1][1])));
+        }
+
+        __m256i ar = averageBlocks(r[0], r[1]);
+        __m256i ag = averageBlocks(g[0], g[1]);
+        __m256i ab = averageBlocks(b[0], b[1]);
+        __m256i cb = getChromaLanes(ar, ag, ab, -38, -74, 112);
+        __m256i cr = getChromaLanes(ar, ag, ab, 112, -94, -18);
+        _mm_storeu_si128((__m128i*)(u + x / 2), _mm256_castsi256_si128(packBytes(cb, cb)));
+        _mm_storeu_si128((__m128i*)(v + x / 2), _mm256_castsi256_si128(packBytes(cr, cr)));
+    }
+    return x;
+}
+
+
+const YuvKernels YUV_KERNELS_AVX2 = { 32, convertRowPairAvx2 };
+
+#else
+const YuvKernels YUV_KERNELS_AVX2 = { 0 };
+#endif
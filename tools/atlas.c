@@ -0,0 +1,54 @@
+/*
+* Text atlas generator: renders signed distance field atlas of a font for the resource pack.
+*
+* Usage: d20_atlas font.ttf output.sdf
+*/
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "text_atlas.h"
+#include "mapped_file.h"
+
+
+static Status writeAtlas(const char* path, const TextAtlasHeader* header, const unsigned char* pixels) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("Unable to open output file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    Status status = STATUS_OK;
+    if (fwrite(header, sizeof(*header), 1, file) != 1
+        || fwrite(pixels, (size_t)header->width * header->height, 1, file) != 1) {
+        puts("Unable to write text atlas");
+        status = STATUS_ERR;
+    }
+    fclose(file);
+    if (status != STATUS_OK) {
+        remove(path);
+    }
+    return status;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        puts("Usage: d20_atlas font.ttf output.sdf");
+        return 1;
+    }
+
+    MappedFile font;
+    if (mapFile(argv[1], &font) != STATUS_OK) {
+        return 1;
+    }
+
+    TextAtlasHeader header;
+    unsigned char* pixels;
+    Status status = generateTextAtlas(font.data, font.size, &header, &pixels);
+    if (status == STATUS_OK) {
+        status = writeAtlas(argv[2], &header, pixels);
+        free(pixels);
+    }
+    unmapFile(&font);
+    return status == STATUS_OK ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/*
+* Culling kernel check: runs the culling kernel of each instruction set supported on this machine over
+* random spheres around a frustum and checks that its compacted visible list equals the scalar reference.
+* Counts that are not a multiple of kernel width leave padding spheres in the last group, and part of the
+* spheres touch frustum planes, so lanes on both sides of the visibility test end up in one group.
+*
+* Usage: d20_culling_check [--seed S]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include <cglm/cglm.h>
+
+#include "culling_kernels.h"
+#include "cpu_features.h"
+#include "allocation.h"
+#include "rng.h"
+
+
+static const size_t SPHERE_COUNTS[] = { 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1001, 4099 };
+enum { N_SPHERE_COUNTS = sizeof(SPHERE_COUNTS) / sizeof(SPHERE_COUNTS[0]) };
+
+
+typedef struct {
+    const char* name;
+    const CullKernels* kernels;
+    bool is_supported;
+} CullIsa;
+
+
+typedef struct {
+    size_t n;
+    size_t n_padded;
+    float* x;
+    float* y;
+    float* z;
+    float* radius;
+} Spheres;
+
+
+// Same operations in the same order as the kernels: visible unless entirely behind one of the planes
+static size_t cullSpheresReference(const Spheres* spheres, const vec4* planes, uint32_t* visible) {
+    size_t n_visible = 0;
+    for (size_t i = 0; i < spheres->n_padded; ++i) {
+        bool inside = true;
+        for (int p = 0; p < CULL_N_PLANES; ++p) {
+            float d = spheres->x[i] * planes[p][0] + planes[p][3];
+            d = spheres->y[i] * planes[p][1] + d;
+            d = spheres->z[i] * planes[p][2] + d;
+            inside &= d >= -spheres->radius[i];
+        }
+        if (inside) {
+            visible[n_visible++] = (uint32_t)i;
+        }
+    }
+    return n_visible;
+}
+
+
+// Spheres scattered around the frustum, every third one moved to touch a random plane from outside,
+// where rounding of plane distance puts it on either side of the test
+static void fillSpheres(Spheres* spheres, const vec4* planes, Rng* rng) {
+    for (size_t i = 0; i < spheres->n; ++i) {
+        vec3 center = {
+            (nextRngFloat(rng) * 2.0f - 1.0f) * 60.0f,
+            (nextRngFloat(rng) * 2.0f - 1.0f) * 60.0f,
+            -nextRngFloat(rng) * 120.0f + 10.0f
+        };
+        float radius = nextRngFloat(rng) * 4.0f;
+        if (i % 3 == 0) {
+            const float* plane = planes[nextRngBounded(rng, CULL_N_PLANES)];
+            float distance = glm_vec3_dot(center, (float*)plane) + plane[3];
+            for (int c = 0; c < 3; ++c) {
+                center[c] -= (distance + radius) * plane[c];
+            }
+        }
+        spheres->x[i] = center[0];
+        spheres->y[i] = center[1];
+        spheres->z[i] = center[2];
+        spheres->radius[i] = radius;
+    }
+
+    // Padding as written by the culler: negative infinite radius is always outside
+    for (size_t i = spheres->n; i < spheres->n_padded; ++i) {
+        spheres->x[i] = spheres->y[i] = spheres->z[i] = 0.0f;
+        spheres->radius[i] = -INFINITY;
+    }
+}
+
+
+int main(int argc, char** argv) {
+    uint64_t seed = 32;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_culling_check [--seed S]");
+            return 1;
+        }
+    }
+
+    const CullIsa isas[] = {
+        { "baseline", &CULL_KERNELS_BASELINE, true },
+        { "AVX2", &CULL_KERNELS_AVX2, CULL_KERNELS_AVX2.width > 0 && hasCpuAvx2() },
+        { "AVX-512", &CULL_KERNELS_AVX512, CULL_KERNELS_AVX512.width > 0 && hasCpuAvx512() }
+    };
+    const size_t n_isas = sizeof(isas) / sizeof(isas[0]);
+
+    size_t capacity = (SPHERE_COUNTS[N_SPHERE_COUNTS - 1] + CULL_MAX_WIDTH - 1) / CULL_MAX_WIDTH * CULL_MAX_WIDTH;
+    float* bounds = allocateMemory(4 * capacity * sizeof(float));
+    uint32_t* reference = allocateMemory(capacity * sizeof(uint32_t));
+    uint32_t* visible = allocateMemory(capacity * sizeof(uint32_t));
+    if (!bounds || !reference || !visible) {
+        puts("Unable to allocate spheres");
+        free(bounds);
+        free(reference);
+        free(visible);
+        return 1;
+    }
+    Spheres spheres = { .x = bounds, .y = bounds + capacity, .z = bounds + 2 * capacity,
+                        .radius = bounds + 3 * capacity };
+
+    // Camera of the scene: looking down -Z from above the table
+    mat4 projection, view, view_projection;
+    glm_perspective(glm_rad(45.0f), 16.0f / 9.0f, 0.1f, 100.0f, projection);
+    glm_lookat((vec3) { 0.0f, 0.0f, 10.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, view);
+    glm_mat4_mul(projection, view, view_projection);
+    vec4 planes[CULL_N_PLANES];
+    glm_frustum_planes(view_projection, planes);
+
+    Rng rng;
+    initRng(&rng, seed, 0);
+    printf("Checking %d sphere counts, seed %llu\n", (int)N_SPHERE_COUNTS, (unsigned long long)seed);
+    printf("%-8s %8s", "spheres", "visible");
+    for (size_t k = 0; k < n_isas; ++k) {
+        if (isas[k].is_supported) {
+            printf(" %8s", isas[k].name);
+        }
+    }
+    printf("\n");
+
+    bool passed = true;
+    for (size_t c = 0; c < N_SPHERE_COUNTS; ++c) {
+        spheres.n = SPHERE_COUNTS[c];
+        spheres.n_padded = (spheres.n + CULL_MAX_WIDTH - 1) / CULL_MAX_WIDTH * CULL_MAX_WIDTH;
+        fillSpheres(&spheres, planes, &rng);
+        size_t n_reference = cullSpheresReference(&spheres, planes, reference);
+        printf("%-8zu %8zu", spheres.n, n_reference);
+
+        for (size_t k = 0; k < n_isas; ++k) {
+            if (!isas[k].is_supported) {
+                continue;
+            }
+            memset(visible, 0xFF, capacity * sizeof(uint32_t));
+            size_t n_visible = isas[k].kernels->cull(spheres.x, spheres.y, spheres.z, spheres.radius,
+                                                     spheres.n_padded, planes, visible);
+            bool is_identical = n_visible == n_reference
+                && memcmp(visible, reference, n_visible * sizeof(uint32_t)) == 0;
+            passed &= is_identical;
+            printf(" %8s", is_identical ? "ok" : "DIFFERS");
+        }
+        printf("\n");
+    }
+    printf("%s\n", passed ? "All kernels match" : "Check FAILED");
+
+    free(bounds);
+    free(reference);
+    free(visible);
+    return passed ? 0 : 1;
+}
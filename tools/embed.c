@@ -0,0 +1,59 @@
+/*
+* Converts resource pack into C source with a constant array, used when compiler lacks #embed.
+*
+* Usage: d20_embed input.pak output.c
+*/
+#include <stdio.h>
+
+#include "status.h"
+
+
+static Status writeEmbeddedSource(FILE* in, FILE* out) {
+    fputs("/* Generated by d20_embed, do not edit */\n"
+          "#include <stddef.h>\n\n"
+          "_Alignas(64) const unsigned char gEmbeddedResourcePack[] = {\n", out);
+
+    unsigned char buf[1 << 16];
+    size_t n_read, n_written = 0;
+    while ((n_read = fread(buf, 1, sizeof(buf), in)) > 0) {
+        for (size_t i = 0; i < n_read; ++i, ++n_written) {
+            fprintf(out, "%u,%s", buf[i], (n_written % 32 == 31) ? "\n" : "");
+        }
+    }
+    if (n_written == 0) {
+        puts("Resource pack is empty");
+        return STATUS_ERR;
+    }
+
+    fputs("\n};\n\n"
+          "const size_t gEmbeddedResourcePackSize = sizeof(gEmbeddedResourcePack);\n", out);
+    return ferror(in) || ferror(out) ? STATUS_ERR : STATUS_OK;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        puts("Usage: d20_embed input.pak output.c");
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        printf("Unable to read file: %s\n", argv[1]);
+        return 1;
+    }
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        printf("Unable to open output file: %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    Status status = writeEmbeddedSource(in, out);
+    fclose(in);
+    fclose(out);
+    if (status != STATUS_OK) {
+        remove(argv[2]);
+    }
+    return status == STATUS_OK ? 0 : 1;
+}
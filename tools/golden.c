@@ -0,0 +1,431 @@
+/*
+* Golden image test: renders fixed frames offscreen (every final face of the d20, one die of every type,
+* wire mode and text overlay), reads them back and compares them with reference PNGs. Pixels are compared
+* by perceptual color difference (YIQ), a frame fails when too many of them differ. Comparison runs on
+* worker threads, failed frames get the actual image and a diff image (differing pixels in red) next
+* to the reference. Run from a directory with resources.pak or the resources directory.
+*
+* References are written with --update from a known-good build with the real cglm, GLFW and FreeType
+* submodules, see the d20_golden test in CMakeLists.txt.
+*
+* Usage: d20_golden [--update] [--dir DIR] [--threshold T] [--max-diff F] [--threads N]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <cglm/cglm.h>
+
+#include "stb_image.h"
+
+#include "scene.h"
+#include "text.h"
+#include "dice_world.h"
+#include "resource.h"
+#include "png_write.h"
+#include "thread.h"
+#include "gl_state.h"
+
+
+enum {
+    IMAGE_SIZE = 256,  // pixels, square
+    N_CHANNELS = 3,
+    MAX_CASES = 32,
+    MAX_THREADS = 256,
+    MAX_PATH_LENGTH = 512
+};
+
+// Maximum YIQ difference of two colors (black and white)
+static const float MAX_COLOR_DELTA = 35215.0f;
+// Scene camera distance to the table, frames with all dice types step back to fit them
+static const float CAMERA_DISTANCE = 5.0f;
+static const float ALL_TYPES_CAMERA_DISTANCE = 9.0f;
+
+#ifndef D20_GOLDEN_DIR
+#define D20_GOLDEN_DIR "resources/golden"
+#endif
+
+static const char RESOURCE_PACK_PATH[] = "resources.pak";
+static const char* const HELP_LINES[] = { "Press Esc to exit", "Press L for wire mode", "Press Space to roll" };
+
+// Scene settings of the application, without GPU animation: dice are posed directly
+static const SceneSettings SCENE_SETTINGS = {
+    .scale = 0.7f,
+    .fov_deg = 45.0f,
+    .camera_near_z = 0.1f,
+    .camera_far_z = 100.0f,
+    .light_direction = { 1.0f, 1.0f, 2.0f },
+    .direct_brightness = 1.0f,
+    .specular_brightness = 0.5f,
+    .ambient_brightness = 0.2f,
+    .camera_position = { 0.0f, 0.0f, -5.0f },
+    .impostor_size_px = 12.0f,
+    .gpu_animation = false,
+};
+
+static const AnimationSettings ANIMATION_SETTINGS = {
+    .idle_rot_speed = 50.0f,
+    .n_rotations = 5,
+    .n_points = 50,
+    .max_rot_speed = 450.0f,
+    .min_rot_speed = 100.0f,
+    .deaceleration = 150.0f,
+};
+
+static const TextSettings TEXT_SETTINGS = {
+    .text_color = { 0.5f, 0.1f, 0.8f },
+    .text_size = 24.0f,
+};
+
+
+typedef struct {
+    char name[64];
+    DiceType type;  // DICE_N_TYPES places one die of every type, each showing its highest value
+    int value;
+    bool is_wire_mode;
+    bool has_text;
+
+    unsigned char* pixels;  // rendered frame, RGB rows top to bottom
+
+    // Results
+    bool has_reference;
+    bool passed;
+    size_t n_differing;  // pixels
+} GoldenCase;
+
+
+typedef struct {
+    const char* dir;
+    float threshold;  // per pixel, relative to MAX_COLOR_DELTA
+    float max_diff;  // fraction of differing pixels a frame may have
+    bool update;  // write references instead of comparing
+} GoldenOptions;
+
+
+typedef struct {
+    GoldenCase* cases;
+    size_t n_cases;
+    size_t first;  // cases first, first + stride, ...
+    size_t stride;
+    const GoldenOptions* options;
+} GoldenWorker;
+
+
+static size_t initCases(GoldenCase* cases) {
+    size_t n = 0;
+    for (int value = 1; value <= 20; ++value) {
+        cases[n++] = (GoldenCase) { .type = DICE_D20, .value = value };
+        sprintf(cases[n - 1].name, "d20_face_%02d", value);
+    }
+    cases[n++] = (GoldenCase) { .name = "all_types", .type = DICE_N_TYPES };
+    cases[n++] = (GoldenCase) { .name = "wire_mode", .type = DICE_D20, .value = 20, .is_wire_mode = true };
+    cases[n++] = (GoldenCase) { .name = "text_overlay", .type = DICE_D20, .value = 20, .has_text = true };
+    return n;
+}
+
+
+/* Rendering */
+
+static Status initContext(GLFWwindow** out_window) {
+    if (!glfwInit()) {
+        puts("Unable to initialize GLFW");
+        return STATUS_ERR;
+    }
+    // Window is only needed for the context, frames are rendered offscreen
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(IMAGE_SIZE, IMAGE_SIZE, "d20_golden", NULL, NULL);
+    if (!window) {
+        puts("Unable to create OpenGL context");
+        glfwTerminate();
+        return STATUS_ERR;
+    }
+    glfwMakeContextCurrent(window);
+    gladLoadGL(glfwGetProcAddress);
+
+    // Same state as the application
+    setGlCapability(GL_DEPTH_TEST, true);
+    setGlCapability(GL_CULL_FACE, true);
+    setGlCapability(GL_BLEND, true);
+    setGlBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    *out_window = window;
+    return STATUS_OK;
+}
+
+
+// Remove dice of previous case and pose dice of this one
+static Status poseDice(DiceWorld* world, DiceHandle* handles, size_t* n_handles, const GoldenCase* golden) {
+    for (size_t h = 0; h < *n_handles; ++h) {
+        destroyDice(world, handles[h]);
+    }
+    *n_handles = 0;
+
+    size_t n_dice = golden->type == DICE_N_TYPES ? DICE_N_TYPES : 1;
+    for (size_t d = 0; d < n_dice; ++d) {
+        DiceType type = golden->type == DICE_N_TYPES ? (DiceType)d : golden->type;
+        int value = golden->type == DICE_N_TYPES ? (int)getDiceFaceCount(type) : golden->value;
+        // Grid of 3 columns centered at the origin
+        vec3 position = { 0.0f, 0.0f, 0.0f };
+        if (n_dice > 1) {
+            position[0] = (d % 3) * 2.5f - 2.5f;
+            position[1] = (d / 3) * 2.5f - 1.25f;
+        }
+
+        DiceHandle handle;
+        if (createDice(world, type, position, SCENE_SETTINGS.scale, 0, &handle) != STATUS_OK) {
+            return STATUS_ERR;
+        }
+        handles[(*n_handles)++] = handle;
+        size_t i = getDiceDenseIndex(world, handle);
+        getDiceRollQuaternion(type, value, world->orientation[i]);
+        world->state[i] = DICE_STATE_SETTLED;
+        world->result[i] = value;
+    }
+    return STATUS_OK;
+}
+
+
+static void renderCase(GoldenCase* golden, SceneRenderer* scene, TextRenderer* text, DiceWorld* world) {
+    SceneSettings scene_settings = SCENE_SETTINGS;
+    scene_settings.camera_position[2] = golden->type == DICE_N_TYPES ? -ALL_TYPES_CAMERA_DISTANCE : -CAMERA_DISTANCE;
+    TextSettings text_settings = TEXT_SETTINGS;
+
+    glViewport(0, 0, IMAGE_SIZE, IMAGE_SIZE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderScene(scene, &scene_settings, &ANIMATION_SETTINGS, world, IMAGE_SIZE, IMAGE_SIZE, golden->is_wire_mode);
+    if (golden->has_text) {
+        for (size_t line = 0; line < sizeof(HELP_LINES) / sizeof(HELP_LINES[0]); ++line) {
+            renderText(text, HELP_LINES[line], &text_settings, 10.0f, 10.0f + 27.0f * line, IMAGE_SIZE, IMAGE_SIZE);
+        }
+    }
+
+    // OpenGL rows go bottom to top
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    size_t row_size = IMAGE_SIZE * N_CHANNELS;
+    for (int y = 0; y < IMAGE_SIZE; ++y) {
+        glReadPixels(0, IMAGE_SIZE - 1 - y, IMAGE_SIZE, 1, GL_RGB, GL_UNSIGNED_BYTE, golden->pixels + y * row_size);
+    }
+}
+
+
+static Status renderCases(GoldenCase* cases, size_t n_cases) {
+    GLFWwindow* window;
+    if (initContext(&window) != STATUS_OK) {
+        return STATUS_ERR;
+    }
+
+    GLuint framebuffer, renderbuffers[2];
+    glCreateFramebuffers(1, &framebuffer);
+    glCreateRenderbuffers(2, renderbuffers);
+    glNamedRenderbufferStorage(renderbuffers[0], GL_RGBA8, IMAGE_SIZE, IMAGE_SIZE);
+    glNamedRenderbufferStorage(renderbuffers[1], GL_DEPTH_COMPONENT24, IMAGE_SIZE, IMAGE_SIZE);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    Status status = STATUS_ERR;
+    DiceWorld world;
+    SceneRenderer scene;
+    TextRenderer text;
+    DiceHandle handles[DICE_N_TYPES];
+    size_t n_handles = 0;
+    if (initDiceWorld(&world, DICE_N_TYPES, &ANIMATION_SETTINGS) == STATUS_OK) {
+        if (initSceneRenderer(&scene, &world) == STATUS_OK) {
+            if (initTextRenderer(&text) == STATUS_OK) {
+                status = STATUS_OK;
+                for (size_t c = 0; c < n_cases && status == STATUS_OK; ++c) {
+                    status = poseDice(&world, handles, &n_handles, &cases[c]);
+                    if (status == STATUS_OK) {
+                        renderCase(&cases[c], &scene, &text, &world);
+                    }
+                }
+                freeTextRenderer(&text);
+            }
+            freeSceneRenderer(&scene);
+        }
+        freeDiceWorld(&world);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return status;
+}
+
+
+/* Comparison */
+
+static float getColorDelta(const unsigned char* a, const unsigned char* b) {
+    float dr = (float)a[0] - b[0], dg = (float)a[1] - b[1], db = (float)a[2] - b[2];
+    float y = dr * 0.29889531f + dg * 0.58662247f + db * 0.11448223f;
+    float i = dr * 0.59597799f - dg * 0.27417610f - db * 0.32180189f;
+    float q = dr * 0.21147017f - dg * 0.52261711f + db * 0.31114694f;
+    return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+}
+
+
+// Count differing pixels and fill diff image: faded reference with differing pixels in red
+static size_t diffImages(const unsigned char* actual, const unsigned char* reference, float threshold,
+                         unsigned char* diff) {
+    float max_delta = MAX_COLOR_DELTA * threshold * threshold;
+    size_t n_differing = 0;
+    for (size_t p = 0; p < (size_t)IMAGE_SIZE * IMAGE_SIZE; ++p) {
+        const unsigned char* a = actual + p * N_CHANNELS;
+        const unsigned char* r = reference + p * N_CHANNELS;
+        unsigned char* d = diff + p * N_CHANNELS;
+        if (getColorDelta(a, r) > max_delta) {
+            d[0] = 255;
+            d[1] = d[2] = 0;
+            ++n_differing;
+        } else {
+            float luma = r[0] * 0.299f + r[1] * 0.587f + r[2] * 0.114f;
+            d[0] = d[1] = d[2] = (unsigned char)(255.0f - 0.1f * (255.0f - luma));
+        }
+    }
+    return n_differing;
+}
+
+
+static void getCasePath(const GoldenOptions* options, const GoldenCase* golden, const char* suffix, char* path) {
+    snprintf(path, MAX_PATH_LENGTH, "%s/%s%s.png", options->dir, golden->name, suffix);
+}
+
+
+static void compareCase(GoldenCase* golden, const GoldenOptions* options) {
+    char path[MAX_PATH_LENGTH];
+    getCasePath(options, golden, "", path);
+    if (options->update) {
+        golden->passed = writePng(path, golden->pixels, IMAGE_SIZE, IMAGE_SIZE, N_CHANNELS) == STATUS_OK;
+        return;
+    }
+
+    int width, height, n_channels;
+    unsigned char* reference = stbi_load(path, &width, &height, &n_channels, N_CHANNELS);
+    golden->has_reference = reference && width == IMAGE_SIZE && height == IMAGE_SIZE;
+    if (!golden->has_reference) {
+        stbi_image_free(reference);
+        return;
+    }
+
+    unsigned char* diff = malloc((size_t)IMAGE_SIZE * IMAGE_SIZE * N_CHANNELS);
+    if (diff) {
+        golden->n_differing = diffImages(golden->pixels, reference, options->threshold, diff);
+        golden->passed = golden->n_differing <= options->max_diff * IMAGE_SIZE * IMAGE_SIZE;
+        if (!golden->passed) {
+            getCasePath(options, golden, "_actual", path);
+            writePng(path, golden->pixels, IMAGE_SIZE, IMAGE_SIZE, N_CHANNELS);
+            getCasePath(options, golden, "_diff", path);
+            writePng(path, diff, IMAGE_SIZE, IMAGE_SIZE, N_CHANNELS);
+        }
+    }
+    free(diff);
+    stbi_image_free(reference);
+}
+
+
+static void runWorker(void* arg) {
+    GoldenWorker* worker = arg;
+    for (size_t c = worker->first; c < worker->n_cases; c += worker->stride) {
+        compareCase(&worker->cases[c], worker->options);
+    }
+}
+
+
+static void compareCases(GoldenCase* cases, size_t n_cases, const GoldenOptions* options, size_t n_threads) {
+    // Calling thread is the first worker
+    Thread threads[MAX_THREADS];
+    GoldenWorker workers[MAX_THREADS];
+    size_t n_started = 1;
+    for (size_t t = 0; t < n_threads; ++t) {
+        workers[t] = (GoldenWorker) {
+            .cases = cases, .n_cases = n_cases, .first = t, .stride = n_threads, .options = options
+        };
+    }
+    for (size_t t = 1; t < n_threads; ++t) {
+        if (startThread(&threads[t], runWorker, &workers[t]) != STATUS_OK) {
+            break;
+        }
+        ++n_started;
+    }
+    // Cases of workers that failed to start are done here
+    for (size_t t = n_started; t < n_threads; ++t) {
+        runWorker(&workers[t]);
+    }
+    runWorker(&workers[0]);
+    for (size_t t = 1; t < n_started; ++t) {
+        joinThread(&threads[t]);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    GoldenOptions options = { .dir = D20_GOLDEN_DIR, .threshold = 0.1f, .max_diff = 0.001f, .update = false };
+    size_t n_threads = getProcessorCount();
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--update") == 0) {
+            options.update = true;
+        } else if (strcmp(argv[arg], "--dir") == 0 && arg + 1 < argc) {
+            options.dir = argv[++arg];
+        } else if (strcmp(argv[arg], "--threshold") == 0 && arg + 1 < argc) {
+            options.threshold = strtof(argv[++arg], NULL);
+        } else if (strcmp(argv[arg], "--max-diff") == 0 && arg + 1 < argc) {
+            options.max_diff = strtof(argv[++arg], NULL);
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            n_threads = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_golden [--update] [--dir DIR] [--threshold T] [--max-diff F] [--threads N]");
+            return 1;
+        }
+    }
+    n_threads = n_threads < 1 ? 1 : n_threads > MAX_THREADS ? MAX_THREADS : n_threads;
+
+    GoldenCase cases[MAX_CASES];
+    size_t n_cases = initCases(cases);
+    for (size_t c = 0; c < n_cases; ++c) {
+        cases[c].pixels = malloc((size_t)IMAGE_SIZE * IMAGE_SIZE * N_CHANNELS);
+        if (!cases[c].pixels) {
+            puts("Unable to allocate frames");
+            return 1;
+        }
+    }
+
+    if (openResourcePack(RESOURCE_PACK_PATH) != STATUS_OK) {
+        puts("Resource pack is not available, using resource files");
+    }
+    Status status = renderCases(cases, n_cases);
+    closeResourcePack();
+    if (status != STATUS_OK) {
+        puts("Unable to render frames");
+        return 1;
+    }
+
+    compareCases(cases, n_cases, &options, n_threads);
+
+    size_t n_failed = 0;
+    for (size_t c = 0; c < n_cases; ++c) {
+        const GoldenCase* golden = &cases[c];
+        if (options.update) {
+            printf("%s: %s\n", golden->name, golden->passed ? "updated" : "FAILED to write");
+        } else if (!golden->has_reference) {
+            printf("%s: no reference in %s\n", golden->name, options.dir);
+        } else {
+            printf("%s: %zu pixels differ (%.3f%%) %s\n", golden->name, golden->n_differing,
+                   100.0 * golden->n_differing / (IMAGE_SIZE * IMAGE_SIZE), golden->passed ? "OK" : "FAILED");
+        }
+        n_failed += !golden->passed;
+        free(cases[c].pixels);
+    }
+
+    if (options.update) {
+        printf("Wrote %zu references to %s\n", n_cases - n_failed, options.dir);
+    } else {
+        printf("%s: %zu of %zu frames differ from references\n", n_failed == 0 ? "All frames match" : "FAILED",
+               n_failed, n_cases);
+    }
+    return n_failed == 0 ? 0 : 1;
+}
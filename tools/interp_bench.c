@@ -0,0 +1,315 @@
+/*
+* Interpolation benchmark: collects the orientation pairs and weights the application interpolates
+* during real rolls of every dice type, then reports for each interpolation method the angular error
+* against exact slerp (in double precision) and the time per quaternion. Two distributions are
+* measured: filling roll queues (start to final orientation, large angles) and frames at 60 Hz between
+* neighbouring keyframes. Times are the fastest of several runs. The cheapest method within the error
+* budget is printed last, together with methods it cannot be told apart from within timing noise.
+*
+* Usage: d20_interp_bench [--rolls N] [--seed S] [--budget DEG]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "status.h"
+#include "polyhedron.h"
+#include "animation.h"
+#include "quat_batch.h"
+#include "allocation.h"
+#include "rng.h"
+
+
+// Roll queue settings of the application
+static const AnimationSettings ANIMATION_SETTINGS = {
+    .idle_rot_speed = 50.0f,
+    .n_rotations = 5,
+    .n_points = 50,
+    .max_rot_speed = 450.0f,
+    .min_rot_speed = 100.0f,
+    .deaceleration = 150.0f,
+    .interpolation = QUAT_SLERP,
+};
+
+static const float FRAME_DELTA = 1.0f / 60.0f;
+// Work done by each timed run, in quaternions
+static const size_t N_TIMED_QUATS = 1 << 22;
+static const int N_TIMED_RUNS = 9;
+// Smallest relative time difference taken as real, the measured spread of runs may widen it
+static const double MIN_TIME_DIFFERENCE = 0.02;
+
+
+// Interpolated pairs and weights, component arrays of a, b and t
+typedef struct {
+    size_t n;
+    size_t capacity;
+    float* a[4];
+    float* b[4];
+    float* t;
+    float* out[4];
+} Samples;
+
+
+typedef struct {
+    double max_error_deg;
+    double mean_error_deg;
+    double ns_per_quat;  // fastest run
+    double time_noise;  // relative difference between median and fastest run
+} MethodResult;
+
+
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+static void getRandomOrientation(Rng* rng, versor q_out) {
+    // Uniform on the sphere of unit quaternions (Shoemake)
+    float u1 = nextRngFloat(rng), u2 = nextRngFloat(rng) * 2.0f * GLM_PIf, u3 = nextRngFloat(rng) * 2.0f * GLM_PIf;
+    float a = sqrtf(1.0f - u1), b = sqrtf(u1);
+    q_out[0] = a * sinf(u2);
+    q_out[1] = a * cosf(u2);
+    q_out[2] = b * sinf(u3);
+    q_out[3] = b * cosf(u3);
+}
+
+
+static Status initSamples(Samples* samples, size_t capacity) {
+    *samples = (Samples) { .capacity = capacity };
+    float* data = allocateMemory(13 * capacity * sizeof(float));
+    if (!data) {
+        puts("Unable to allocate samples");
+        return STATUS_ERR;
+    }
+    for (int c = 0; c < 4; ++c) {
+        samples->a[c] = data + c * capacity;
+        samples->b[c] = data + (4 + c) * capacity;
+        samples->out[c] = data + (8 + c) * capacity;
+    }
+    samples->t = data + 12 * capacity;
+    return STATUS_OK;
+}
+
+
+static void freeSamples(Samples* samples) {
+    free(samples->a[0]);
+    memset(samples, 0, sizeof(*samples));
+}
+
+
+static void addSample(Samples* samples, const float* a, const float* b, float t) {
+    size_t i = samples->n++;
+    for (int c = 0; c < 4; ++c) {
+        samples->a[c][i] = a[c];
+        samples->b[c][i] = b[c];
+    }
+    samples->t[i] = t;
+}
+
+
+// Frames of one roll at the application frame rate, with the same speed profile
+static size_t getRollFrameCount(const RollSpeedProfile* profile, size_t n_points) {
+    size_t n_frames = 0;
+    while (getRollAnimationPosition(profile, (n_frames + 1) * FRAME_DELTA) < n_points) {
+        ++n_frames;
+    }
+    return n_frames;
+}
+
+
+// Pairs of the queue path and of every frame of rolls from random orientations to random values
+static void collectSamples(size_t n_rolls, uint64_t seed, Samples* queue, Samples* frames) {
+    const size_t n_points = ANIMATION_SETTINGS.n_points;
+    RollSpeedProfile profile = getRollSpeedProfile(&ANIMATION_SETTINGS);
+    RollAnimationState state = initRollAnimationState(n_points);
+    Rng rng;
+    initRng(&rng, seed, 0);
+
+    for (size_t r = 0; r < n_rolls; ++r) {
+        DiceType type = (DiceType)(r % DICE_N_TYPES);
+        int value = (int)nextRngBounded(&rng, (uint32_t)getDiceFaceCount(type)) + 1;
+        versor initial;
+        getRandomOrientation(&rng, initial);
+        fillRollAnimationQueue(&state, initial, &ANIMATION_SETTINGS, type, (size_t)value);
+
+        for (size_t n = 0; n < n_points - 1 && queue->n < queue->capacity; ++n) {
+            addSample(queue, state.q_start, state.q_arr[n_points - 1], (float)n / (n_points - 1));
+        }
+        for (size_t f = 1; frames->n < frames->capacity; ++f) {
+            float position = getRollAnimationPosition(&profile, f * FRAME_DELTA);
+            if (position >= n_points) {
+                break;
+            }
+            size_t n = (size_t)position;
+            addSample(frames, n == 0 ? state.q_start : state.q_arr[n - 1], state.q_arr[n], position - n);
+        }
+    }
+    deleteRollAnimationState(&state);
+}
+
+
+// Angle between result and exact slerp along the shorter arc, in degrees
+static double getAngularError(const Samples* samples, size_t i) {
+    double a[4], b[4], dot = 0.0;
+    for (int c = 0; c < 4; ++c) {
+        a[c] = samples->a[c][i];
+        b[c] = samples->b[c][i];
+        dot += a[c] * b[c];
+    }
+    double sign = dot < 0.0 ? -1.0 : 1.0;
+    double cos_theta = fmin(dot * sign, 1.0);
+    double theta = acos(cos_theta), sin_theta = sin(theta);
+    double t = samples->t[i];
+    double wa = sin_theta > 1e-12 ? sin((1.0 - t) * theta) / sin_theta : 1.0 - t;
+    double wb = sin_theta > 1e-12 ? sin(t * theta) / sin_theta : t;
+
+    double exact[4], out[4], exact_norm = 0.0, out_norm = 0.0, result_dot = 0.0;
+    for (int c = 0; c < 4; ++c) {
+        exact[c] = a[c] * wa * sign + b[c] * wb;
+        out[c] = samples->out[c][i];
+        exact_norm += exact[c] * exact[c];
+        out_norm += out[c] * out[c];
+        result_dot += exact[c] * out[c];
+    }
+    // Chord between unit quaternions rather than acos of their dot, which turns the float rounding
+    // of the result length into errors of hundredths of a degree
+    double out_sign = result_dot < 0.0 ? -1.0 : 1.0, chord = 0.0;
+    for (int c = 0; c < 4; ++c) {
+        double d = exact[c] / sqrt(exact_norm) - out[c] * out_sign / sqrt(out_norm);
+        chord += d * d;
+    }
+    return 4.0 * asin(fmin(sqrt(chord) * 0.5, 1.0)) * 180.0 / GLM_PI;
+}
+
+
+static void runMethod(QuatInterpolation method, Samples* samples) {
+    QuatArrays a = { samples->a[0], samples->a[1], samples->a[2], samples->a[3] };
+    QuatArrays b = { samples->b[0], samples->b[1], samples->b[2], samples->b[3] };
+    QuatArrays out = { samples->out[0], samples->out[1], samples->out[2], samples->out[3] };
+    interpolateQuats(method, a, b, samples->t, out, samples->n);
+}
+
+
+static MethodResult measureMethod(QuatInterpolation method, Samples* samples) {
+    MethodResult result = { 0 };
+    runMethod(method, samples);
+    for (size_t i = 0; i < samples->n; ++i) {
+        double error = getAngularError(samples, i);
+        result.max_error_deg = fmax(result.max_error_deg, error);
+        result.mean_error_deg += error / samples->n;
+    }
+
+    // Other processes and frequency changes only ever slow a run down, so the fastest run is the closest
+    // to the cost of the method and the spread of runs shows how far single timings can be trusted
+    size_t n_runs = N_TIMED_QUATS / samples->n + 1;
+    double ns_per_quat[N_TIMED_RUNS];
+    for (int timed_run = 0; timed_run < N_TIMED_RUNS; ++timed_run) {
+        double start_time = getTimeSeconds();
+        for (size_t r = 0; r < n_runs; ++r) {
+            runMethod(method, samples);
+        }
+        ns_per_quat[timed_run] = (getTimeSeconds() - start_time) * 1e9 / ((double)n_runs * samples->n);
+    }
+    qsort(ns_per_quat, N_TIMED_RUNS, sizeof(double), compareDoubles);
+    result.ns_per_quat = ns_per_quat[0];
+    result.time_noise = ns_per_quat[N_TIMED_RUNS / 2] / ns_per_quat[0] - 1.0;
+    return result;
+}
+
+
+int main(int argc, char** argv) {
+    size_t n_rolls = 1 << 12;
+    uint64_t seed = 20;
+    double budget_deg = 0.05;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--rolls") == 0 && arg + 1 < argc) {
+            n_rolls = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--budget") == 0 && arg + 1 < argc) {
+            budget_deg = strtod(argv[++arg], NULL);
+        } else {
+            puts("Usage: d20_interp_bench [--rolls N] [--seed S] [--budget DEG]");
+            return 1;
+        }
+    }
+    if (n_rolls == 0) {
+        puts("Number of rolls should be positive");
+        return 1;
+    }
+
+    initDiceMeshes();
+
+    RollSpeedProfile profile = getRollSpeedProfile(&ANIMATION_SETTINGS);
+    size_t n_frames = getRollFrameCount(&profile, ANIMATION_SETTINGS.n_points);
+    Samples queue, frames;
+    if (initSamples(&queue, n_rolls * (ANIMATION_SETTINGS.n_points - 1)) != STATUS_OK) {
+        return 1;
+    }
+    if (initSamples(&frames, n_rolls * n_frames) != STATUS_OK) {
+        freeSamples(&queue);
+        return 1;
+    }
+    collectSamples(n_rolls, seed, &queue, &frames);
+
+    printf("%zu rolls, seed %llu: %zu queue samples, %zu frame samples (%zu frames per roll), %s kernels\n",
+           n_rolls, (unsigned long long)seed, queue.n, frames.n, n_frames, getQuatIsaName(getQuatIsa()));
+    printf("%-11s %33s %33s\n", "", "queue fill", "frames");
+    printf("%-11s %9s %9s %6s %6s %9s %9s %6s %6s\n", "method", "max deg", "mean deg", "ns", "noise", "max deg",
+           "mean deg", "ns", "noise");
+
+    // Frames are the hot path, the queue is filled once per roll
+    MethodResult frame_results[QUAT_N_INTERPOLATIONS];
+    bool is_within_budget[QUAT_N_INTERPOLATIONS];
+    int cheapest = -1;
+    for (int method = 0; method < QUAT_N_INTERPOLATIONS; ++method) {
+        MethodResult queue_result = measureMethod((QuatInterpolation)method, &queue);
+        MethodResult frame_result = measureMethod((QuatInterpolation)method, &frames);
+        printf("%-11s %9.2e %9.2e %6.2f %5.1f%% %9.2e %9.2e %6.2f %5.1f%%\n",
+               getQuatInterpolationName((QuatInterpolation)method), queue_result.max_error_deg,
+               queue_result.mean_error_deg, queue_result.ns_per_quat, queue_result.time_noise * 100.0,
+               frame_result.max_error_deg, frame_result.mean_error_deg, frame_result.ns_per_quat,
+               frame_result.time_noise * 100.0);
+
+        frame_results[method] = frame_result;
+        is_within_budget[method] = queue_result.max_error_deg <= budget_deg && frame_result.max_error_deg <= budget_deg;
+        if (is_within_budget[method]
+            && (cheapest < 0 || frame_result.ns_per_quat < frame_results[cheapest].ns_per_quat)) {
+            cheapest = method;
+        }
+    }
+    if (cheapest < 0) {
+        printf("No method within %.3g deg\n", budget_deg);
+    } else {
+        printf("Cheapest within %.3g deg: %s", budget_deg, getQuatInterpolationName((QuatInterpolation)cheapest));
+        // Methods slower by less than the noise of either timing are reported as a tie
+        const MethodResult* best = &frame_results[cheapest];
+        bool is_tie = false;
+        for (int method = 0; method < QUAT_N_INTERPOLATIONS; ++method) {
+            const MethodResult* other = &frame_results[method];
+            double noise = fmax(MIN_TIME_DIFFERENCE, fmax(best->time_noise, other->time_noise));
+            bool is_close = other->ns_per_quat <= best->ns_per_quat * (1.0 + noise);
+            if (method != cheapest && is_within_budget[method] && is_close) {
+                printf("%s %s", is_tie ? "," : ", tied within timing noise with",
+                       getQuatInterpolationName((QuatInterpolation)method));
+                is_tie = true;
+            }
+        }
+        printf("\n");
+    }
+
+    freeSamples(&queue);
+    freeSamples(&frames);
+    return 0;
+}
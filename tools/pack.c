@@ -0,0 +1,158 @@
+/*
+* Resource pack builder: bundles resource files into a single .pak with an index.
+*
+* Usage: d20_pack output.pak name1 path1 [name2 path2 ...]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "resource.h"
+
+
+typedef struct {
+    ResourcePackEntry entry;
+    const char* path;
+} PackItem;
+
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + RESOURCE_PACK_ALIGNMENT - 1) & ~(uint64_t)(RESOURCE_PACK_ALIGNMENT - 1);
+}
+
+
+static int compareItems(const void* a, const void* b) {
+    return strcmp(((const PackItem*)a)->entry.name, ((const PackItem*)b)->entry.name);
+}
+
+
+static long getFileSize(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fclose(file);
+    return length;
+}
+
+
+static Status copyFile(FILE* out, const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        printf("Unable to read file: %s\n", path);
+        return STATUS_ERR;
+    }
+
+    char buf[1 << 16];
+    size_t n_read;
+    Status status = STATUS_OK;
+    while ((n_read = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n_read, out) != n_read) {
+            puts("Unable to write resource pack");
+            status = STATUS_ERR;
+            break;
+        }
+    }
+    fclose(in);
+    return status;
+}
+
+
+static Status buildPack(const char* output_path, PackItem* items, size_t n_items) {
+    // Sorted index allows binary search at runtime
+    qsort(items, n_items, sizeof(PackItem), compareItems);
+
+    uint64_t offset = alignOffset(sizeof(ResourcePackHeader) + n_items * sizeof(ResourcePackEntry));
+    for (size_t i = 0; i < n_items; ++i) {
+        if (i > 0 && strcmp(items[i - 1].entry.name, items[i].entry.name) == 0) {
+            printf("Duplicate resource name: %s\n", items[i].entry.name);
+            return STATUS_ERR;
+        }
+        items[i].entry.offset = offset;
+        offset = alignOffset(offset + items[i].entry.size);
+    }
+
+    FILE* file = fopen(output_path, "wb");
+    if (!file) {
+        printf("Unable to open output file: %s\n", output_path);
+        return STATUS_ERR;
+    }
+
+    ResourcePackHeader header = {
+        .magic = RESOURCE_PACK_MAGIC,
+        .version = RESOURCE_PACK_VERSION,
+        .n_entries = (uint32_t)n_items,
+    };
+    Status status = STATUS_OK;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        status = STATUS_ERR;
+    }
+    for (size_t i = 0; i < n_items && status == STATUS_OK; ++i) {
+        if (fwrite(&items[i].entry, sizeof(ResourcePackEntry), 1, file) != 1) {
+            status = STATUS_ERR;
+        }
+    }
+    for (size_t i = 0; i < n_items && status == STATUS_OK; ++i) {
+        if (fseek(file, (long)items[i].entry.offset, SEEK_SET) != 0) {
+            status = STATUS_ERR;
+            break;
+        }
+        status = copyFile(file, items[i].path);
+    }
+
+    // Pad the last blob so that the pack size is aligned as well
+    if (status == STATUS_OK && n_items > 0) {
+        ResourcePackEntry* last = &items[n_items - 1].entry;
+        uint64_t end = last->offset + last->size;
+        for (uint64_t i = end; i < alignOffset(end); ++i) {
+            fputc(0, file);
+        }
+    }
+
+    if (status != STATUS_OK) {
+        puts("Unable to write resource pack");
+    }
+    fclose(file);
+    return status;
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (argc - 2) % 2 != 0) {
+        puts("Usage: d20_pack output.pak name1 path1 [name2 path2 ...]");
+        return 1;
+    }
+
+    size_t n_items = (argc - 2) / 2;
+    PackItem* items = calloc(n_items > 0 ? n_items : 1, sizeof(PackItem));
+    if (!items) {
+        puts("Unable to allocate resource index");
+        return 1;
+    }
+
+    Status status = STATUS_OK;
+    for (size_t i = 0; i < n_items && status == STATUS_OK; ++i) {
+        const char* name = argv[2 + 2 * i];
+        const char* path = argv[3 + 2 * i];
+        long size = getFileSize(path);
+        if (strlen(name) >= RESOURCE_NAME_LENGTH) {
+            printf("Resource name is too long: %s\n", name);
+            status = STATUS_ERR;
+        } else if (size < 0) {
+            printf("Unable to read file: %s\n", path);
+            status = STATUS_ERR;
+        } else {
+            strcpy(items[i].entry.name, name);
+            items[i].entry.size = (uint64_t)size;
+            items[i].path = path;
+        }
+    }
+
+    if (status == STATUS_OK) {
+        status = buildPack(argv[1], items, n_items);
+    }
+    free(items);
+    return status == STATUS_OK ? 0 : 1;
+}
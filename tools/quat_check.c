@@ -0,0 +1,315 @@
+/*
+* Quaternion kernel check: runs every batch kernel of each instruction set supported on this machine
+* over random quaternions, checks that results are bit-identical to the scalar reference, reports the
+* largest difference from cglm and the time per quaternion. Counts that are not a multiple of vector
+* width also exercise the scalar tails.
+*
+* Usage: d20_quat_check [--count N] [--seed S]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <cglm/cglm.h>
+
+#include "quat_batch.h"
+#include "allocation.h"
+#include "rng.h"
+
+
+typedef enum {
+    KERNEL_NORMALIZE,
+    KERNEL_MULTIPLY,
+    KERNEL_NLERP,
+    KERNEL_SLERP,
+    KERNEL_FAST_SLERP,
+    KERNEL_TO_MAT3,
+    KERNEL_TO_MAT4,
+    KERNEL_ROTATE,
+    N_KERNELS
+} Kernel;
+
+
+static const char* const KERNEL_NAMES[N_KERNELS] = {
+    "normalize", "multiply", "nlerp", "slerp", "fast_slerp", "to_mat3", "to_mat4", "rotate"
+};
+// Output floats per quaternion
+static const size_t KERNEL_N_OUTPUTS[N_KERNELS] = { 4, 4, 4, 4, 4, 9, 16, 3 };
+// Largest allowed difference from cglm in any component, fast slerp only approximates slerp
+static const float KERNEL_TOLERANCES[N_KERNELS] = { 1e-6f, 1e-6f, 1e-6f, 2e-6f, 1e-3f, 1e-6f, 1e-6f, 4e-6f };
+
+// Work done by each timed kernel run, in quaternions
+static const size_t N_TIMED_QUATS = 1 << 22;
+
+
+typedef struct {
+    size_t n;
+    float* a[4];
+    float* b[4];
+    float* t;
+    float* v[3];
+} CheckInput;
+
+
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static void getRandomOrientation(Rng* rng, versor q_out) {
+    // Uniform on the sphere of unit quaternions (Shoemake)
+    float u1 = nextRngFloat(rng), u2 = nextRngFloat(rng) * 2.0f * GLM_PIf, u3 = nextRngFloat(rng) * 2.0f * GLM_PIf;
+    float a = sqrtf(1.0f - u1), b = sqrtf(u1);
+    q_out[0] = a * sinf(u2);
+    q_out[1] = a * cosf(u2);
+    q_out[2] = b * sinf(u3);
+    q_out[3] = b * cosf(u3);
+}
+
+
+// Random pairs, every fourth one nearly equal to test the close quaternion path of slerp
+static void fillInput(CheckInput* input, uint64_t seed) {
+    Rng rng;
+    initRng(&rng, seed, 0);
+    for (size_t i = 0; i < input->n; ++i) {
+        versor a, b;
+        getRandomOrientation(&rng, a);
+        if (i % 4 == 0) {
+            for (int c = 0; c < 4; ++c) {
+                b[c] = a[c] + (nextRngFloat(&rng) - 0.5f) * 1e-4f;
+            }
+            glm_quat_normalize(b);
+        } else {
+            getRandomOrientation(&rng, b);
+        }
+        for (int c = 0; c < 4; ++c) {
+            input->a[c][i] = a[c];
+            input->b[c][i] = b[c];
+        }
+        input->t[i] = nextRngFloat(&rng);
+        for (int c = 0; c < 3; ++c) {
+            input->v[c][i] = nextRngFloat(&rng) * 2.0f - 1.0f;
+        }
+    }
+}
+
+
+static void runKernel(Kernel kernel, const CheckInput* input, float* out, size_t n) {
+    QuatArrays a = { input->a[0], input->a[1], input->a[2], input->a[3] };
+    QuatArrays b = { input->b[0], input->b[1], input->b[2], input->b[3] };
+    QuatArrays q_out = { out, out + input->n, out + 2 * input->n, out + 3 * input->n };
+    Vec3Arrays v = { input->v[0], input->v[1], input->v[2] };
+    Vec3Arrays v_out = { out, out + input->n, out + 2 * input->n };
+    Mat3Arrays m_out;
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            m_out.m[c][r] = out + (c * 3 + r) * input->n;
+        }
+    }
+
+    switch (kernel) {
+    case KERNEL_NORMALIZE:
+        normalizeQuats(a, q_out, n);
+        break;
+    case KERNEL_MULTIPLY:
+        multiplyQuats(a, b, q_out, n);
+        break;
+    case KERNEL_NLERP:
+        nlerpQuats(a, b, input->t, q_out, n);
+        break;
+    case KERNEL_SLERP:
+        slerpQuats(a, b, input->t, q_out, n);
+        break;
+    case KERNEL_FAST_SLERP:
+        fastSlerpQuats(a, b, input->t, q_out, n);
+        break;
+    case KERNEL_TO_MAT3:
+        quatsToMat3(a, m_out, n);
+        break;
+    case KERNEL_TO_MAT4:
+        quatsToMat4(a, (mat4*)out, n);
+        break;
+    case KERNEL_ROTATE:
+        rotateVec3s(a, v, v_out, n);
+        break;
+    default:
+        break;
+    }
+}
+
+
+// Largest difference of values, or of negated values when either sign is the same rotation
+static float getDifference(const float* expected, const float* actual, size_t n, bool is_sign_free) {
+    float error = 0.0f, negated_error = 0.0f;
+    for (size_t k = 0; k < n; ++k) {
+        error = glm_max(error, fabsf(expected[k] - actual[k]));
+        negated_error = glm_max(negated_error, fabsf(expected[k] + actual[k]));
+    }
+    return is_sign_free ? glm_min(error, negated_error) : error;
+}
+
+
+// Largest difference between kernel output and cglm over all quaternions
+static float getCglmError(Kernel kernel, const CheckInput* input, const float* out) {
+    float max_error = 0.0f;
+    size_t n = input->n;
+    for (size_t i = 0; i < n; ++i) {
+        versor a = { input->a[0][i], input->a[1][i], input->a[2][i], input->a[3][i] };
+        versor b = { input->b[0][i], input->b[1][i], input->b[2][i], input->b[3][i] };
+        vec3 v = { input->v[0][i], input->v[1][i], input->v[2][i] };
+        float expected[16], actual[16];
+        bool is_sign_free = false;
+
+        switch (kernel) {
+        case KERNEL_NORMALIZE:
+            glm_quat_normalize_to(a, expected);
+            break;
+        case KERNEL_MULTIPLY:
+            glm_quat_mul(a, b, expected);
+            break;
+        case KERNEL_NLERP:
+            glm_quat_nlerp(a, b, input->t[i], expected);
+            is_sign_free = true;
+            break;
+        case KERNEL_SLERP:
+        case KERNEL_FAST_SLERP:
+            // cglm returns the first quaternion once dot product rounds to 1, and leaves results of
+            // its close quaternion path unnormalized
+            if (fabsf(glm_vec4_dot(a, b)) >= 1.0f) {
+                glm_quat_nlerp(a, b, input->t[i], expected);
+            } else {
+                glm_quat_slerp(a, b, input->t[i], expected);
+                glm_quat_normalize(expected);
+            }
+            is_sign_free = true;
+            break;
+        case KERNEL_TO_MAT3: {
+            mat3 m;
+            glm_quat_mat3(a, m);
+            memcpy(expected, m, sizeof(m));
+            break;
+        }
+        case KERNEL_TO_MAT4: {
+            mat4 m;
+            glm_quat_mat4(a, m);
+            memcpy(expected, m, sizeof(m));
+            break;
+        }
+        case KERNEL_ROTATE:
+            glm_quat_rotatev(a, v, expected);
+            break;
+        default:
+            break;
+        }
+
+        size_t n_outputs = KERNEL_N_OUTPUTS[kernel];
+        if (kernel == KERNEL_TO_MAT4) {
+            memcpy(actual, out + i * 16, sizeof(mat4));
+        } else {
+            for (size_t k = 0; k < n_outputs; ++k) {
+                actual[k] = out[k * n + i];
+            }
+        }
+        max_error = glm_max(max_error, getDifference(expected, actual, n_outputs, is_sign_free));
+    }
+    return max_error;
+}
+
+
+static double getNsPerQuat(Kernel kernel, const CheckInput* input, float* out) {
+    size_t n_runs = N_TIMED_QUATS / input->n + 1;
+    double start_time = getTimeSeconds();
+    for (size_t r = 0; r < n_runs; ++r) {
+        runKernel(kernel, input, out, input->n);
+    }
+    return (getTimeSeconds() - start_time) * 1e9 / ((double)n_runs * input->n);
+}
+
+
+int main(int argc, char** argv) {
+    size_t n = 4099;
+    uint64_t seed = 20;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--count") == 0 && arg + 1 < argc) {
+            n = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_quat_check [--count N] [--seed S]");
+            return 1;
+        }
+    }
+    if (n == 0) {
+        puts("Count should be positive");
+        return 1;
+    }
+
+    CheckInput input = { .n = n };
+    float* inputs = allocateMemory(12 * n * sizeof(float));
+    float* reference = allocateMemory(16 * n * sizeof(float));
+    float* out = allocateMemory(16 * n * sizeof(float));
+    if (!inputs || !reference || !out) {
+        puts("Unable to allocate quaternions");
+        free(inputs);
+        free(reference);
+        free(out);
+        return 1;
+    }
+    for (int c = 0; c < 4; ++c) {
+        input.a[c] = inputs + c * n;
+        input.b[c] = inputs + (4 + c) * n;
+    }
+    input.t = inputs + 8 * n;
+    for (int c = 0; c < 3; ++c) {
+        input.v[c] = inputs + (9 + c) * n;
+    }
+    fillInput(&input, seed);
+
+    QuatIsa best_isa = getBestQuatIsa();
+    printf("Checking %zu quaternions, seed %llu, selected %s\n", n, (unsigned long long)seed,
+           getQuatIsaName(best_isa));
+    printf("%-10s %11s", "kernel", "cglm error");
+    for (int isa = 0; isa < QUAT_N_ISAS; ++isa) {
+        if (isQuatIsaSupported((QuatIsa)isa)) {
+            printf(" %10s", getQuatIsaName((QuatIsa)isa));
+        }
+    }
+    printf("  (ns per quaternion)\n");
+
+    bool passed = true;
+    for (int kernel = 0; kernel < N_KERNELS; ++kernel) {
+        size_t n_bytes = KERNEL_N_OUTPUTS[kernel] * n * sizeof(float);
+        setQuatIsa(QUAT_ISA_SCALAR);
+        runKernel(kernel, &input, reference, n);
+        float error = getCglmError(kernel, &input, reference);
+        bool is_accurate = error <= KERNEL_TOLERANCES[kernel];
+        passed &= is_accurate;
+        printf("%-10s %9.2e%s", KERNEL_NAMES[kernel], error, is_accurate ? "  " : " !");
+
+        for (int isa = 0; isa < QUAT_N_ISAS; ++isa) {
+            if (!isQuatIsaSupported((QuatIsa)isa)) {
+                continue;
+            }
+            setQuatIsa((QuatIsa)isa);
+            memset(out, 0, n_bytes);
+            runKernel(kernel, &input, out, n);
+            bool is_identical = memcmp(out, reference, n_bytes) == 0;
+            passed &= is_identical;
+            printf(" %9.3f%s", getNsPerQuat(kernel, &input, out), is_identical ? " " : "!");
+        }
+        printf("\n");
+    }
+    setQuatIsa(best_isa);
+    printf("%s\n", passed ? "All kernels match" : "Check FAILED (! marks kernels over tolerance or differing "
+                                                  "from scalar reference)");
+
+    free(inputs);
+    free(reference);
+    free(out);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+/*
+* Frame report merge: combines JSON frame reports of many d20 instances (written with --report) into one
+* report with the histograms and hitch counts of all of them, and prints its frame time percentiles.
+* Percentiles of the merged report are computed from merged buckets, not averaged.
+*
+* Usage: d20_report_merge output.json input1.json [input2.json ...]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "frame_report.h"
+
+
+// Reports are large, keep them out of the stack
+static FrameReport g_merged;
+static FrameReport g_input;
+
+
+static void printSummary(const FrameReport* report) {
+    const Histogram* frames = &report->stages[FRAME_STAGE_FRAME];
+    printf("%llu instances, %llu frames, hitches over 33/50/100 ms: %llu/%llu/%llu\n",
+           (unsigned long long)report->n_instances, (unsigned long long)frames->n_values,
+           (unsigned long long)report->n_hitches[0], (unsigned long long)report->n_hitches[1],
+           (unsigned long long)report->n_hitches[2]);
+    printf("%-8s %10s %10s %10s %10s %10s\n", "stage", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (int stage = 0; stage < FRAME_N_STAGES; ++stage) {
+        const Histogram* histogram = &report->stages[stage];
+        printf("%-8s %10.3f %10.3f %10.3f %10.3f %10.3f\n", getFrameStageName(stage),
+               getHistogramPercentile(histogram, 50.0) * 1e-3, getHistogramPercentile(histogram, 90.0) * 1e-3,
+               getHistogramPercentile(histogram, 99.0) * 1e-3, getHistogramPercentile(histogram, 99.9) * 1e-3,
+               histogram->max * 1e-3);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        puts("Usage: d20_report_merge output.json input1.json [input2.json ...]");
+        return 1;
+    }
+
+    for (int arg = 2; arg < argc; ++arg) {
+        FrameReport* report = arg == 2 ? &g_merged : &g_input;
+        if (readFrameReport(report, argv[arg]) != STATUS_OK) {
+            printf("Unable to merge %s\n", argv[arg]);
+            return 1;
+        }
+        if (report != &g_merged) {
+            mergeFrameReport(&g_merged, report);
+        }
+    }
+
+    if (writeFrameReport(&g_merged, argv[1]) != STATUS_OK) {
+        return 1;
+    }
+    printSummary(&g_merged);
+    return 0;
+}
@@ -0,0 +1,279 @@
+/*
+* Offline texture converter: PNG -> .d20tex container with full pre-filtered mip chain.
+*
+* Usage: d20_texconv [--bc1] input.png output.d20tex
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "texture_container.h"
+
+
+enum {
+    N_CHANNELS = 3,
+    BC1_BLOCK_SIZE = 8
+};
+
+
+typedef struct {
+    unsigned char* pixels;  // RGB8
+    uint32_t width;
+    uint32_t height;
+} Image;
+
+
+static uint32_t minU32(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+
+static uint32_t alignOffset(uint32_t offset) {
+    return (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) & ~(uint32_t)(TEXTURE_CONTAINER_ALIGNMENT - 1);
+}
+
+
+static const unsigned char* getPixel(const Image* image, uint32_t x, uint32_t y) {
+    return &image->pixels[((size_t)y * image->width + x) * N_CHANNELS];
+}
+
+
+// Box filter level down to half size
+static Status downsampleImage(const Image* src, Image* dst) {
+    dst->width = src->width > 1 ? src->width / 2 : 1;
+    dst->height = src->height > 1 ? src->height / 2 : 1;
+    dst->pixels = malloc((size_t)dst->width * dst->height * N_CHANNELS);
+    if (!dst->pixels) {
+        puts("Unable to allocate mip level");
+        return STATUS_ERR;
+    }
+
+    for (uint32_t y = 0; y < dst->height; ++y) {
+        for (uint32_t x = 0; x < dst->width; ++x) {
+            // Clamp for odd and 1-pixel dimensions
+            uint32_t x0 = 2 * x, x1 = minU32(2 * x + 1, src->width - 1);
+            uint32_t y0 = 2 * y, y1 = minU32(2 * y + 1, src->height - 1);
+            unsigned char* out = &dst->pixels[((size_t)y * dst->width + x) * N_CHANNELS];
+            for (int c = 0; c < N_CHANNELS; ++c) {
+                unsigned int sum = getPixel(src, x0, y0)[c] + getPixel(src, x1, y0)[c]
+                                 + getPixel(src, x0, y1)[c] + getPixel(src, x1, y1)[c];
+                out[c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return STATUS_OK;
+}
+
+
+/* BC1 (DXT1) encoding */
+
+static uint16_t packRgb565(const int color[3]) {
+    return (uint16_t)(((color[0] * 31 + 127) / 255) << 11
+                    | ((color[1] * 63 + 127) / 255) << 5
+                    | ((color[2] * 31 + 127) / 255));
+}
+
+
+static void unpackRgb565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+
+// Endpoints are the corners of the block color bounding box, inset to reduce error
+static void encodeBc1Block(const unsigned char block[16][N_CHANNELS], unsigned char* out) {
+    int min_color[3] = { 255, 255, 255 }, max_color[3] = { 0, 0, 0 };
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < N_CHANNELS; ++c) {
+            if (block[p][c] < min_color[c]) min_color[c] = block[p][c];
+            if (block[p][c] > max_color[c]) max_color[c] = block[p][c];
+        }
+    }
+    for (int c = 0; c < N_CHANNELS; ++c) {
+        int inset = (max_color[c] - min_color[c]) / 16;
+        min_color[c] += inset;
+        max_color[c] -= inset;
+    }
+
+    uint16_t c0 = packRgb565(max_color), c1 = packRgb565(min_color);
+    if (c0 < c1) {
+        uint16_t tmp = c0;
+        c0 = c1;
+        c1 = tmp;
+    }
+
+    // c0 > c1 selects 4-color mode, c0 == c1 is a solid block with all indices 0
+    int palette[4][3];
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int c = 0; c < N_CHANNELS; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int p = 0; p < 16; ++p) {
+            int best_index = 0, best_distance = -1;
+            for (int i = 0; i < 4; ++i) {
+                int distance = 0;
+                for (int c = 0; c < N_CHANNELS; ++c) {
+                    int d = block[p][c] - palette[i][c];
+                    distance += d * d;
+                }
+                if (best_distance < 0 || distance < best_distance) {
+                    best_distance = distance;
+                    best_index = i;
+                }
+            }
+            indices |= (uint32_t)best_index << (2 * p);
+        }
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+
+static uint32_t getLevelSize(const Image* image, TextureContainerFormat format) {
+    return (uint32_t)getTextureLevelSize(format, image->width, image->height);
+}
+
+
+static void encodeBc1Image(const Image* image, unsigned char* out) {
+    unsigned char block[16][N_CHANNELS];
+    for (uint32_t by = 0; by < image->height; by += 4) {
+        for (uint32_t bx = 0; bx < image->width; bx += 4) {
+            // Levels smaller than a block repeat their edge pixels
+            for (uint32_t p = 0; p < 16; ++p) {
+                uint32_t x = minU32(bx + p % 4, image->width - 1);
+                uint32_t y = minU32(by + p / 4, image->height - 1);
+                memcpy(block[p], getPixel(image, x, y), N_CHANNELS);
+            }
+            encodeBc1Block(block, out);
+            out += BC1_BLOCK_SIZE;
+        }
+    }
+}
+
+
+static Status writeLevel(FILE* file, const Image* image, TextureContainerFormat format,
+                         const TextureContainerLevel* level) {
+    unsigned char* data = (unsigned char*)image->pixels;
+    if (format == TEXTURE_FORMAT_BC1) {
+        data = malloc(level->size);
+        if (!data) {
+            puts("Unable to allocate compressed level");
+            return STATUS_ERR;
+        }
+        encodeBc1Image(image, data);
+    }
+
+    Status status = STATUS_OK;
+    if (fseek(file, level->offset, SEEK_SET) != 0 || fwrite(data, 1, level->size, file) != level->size) {
+        puts("Unable to write texture level");
+        status = STATUS_ERR;
+    }
+
+    if (data != image->pixels) {
+        free(data);
+    }
+    return status;
+}
+
+
+static Status convertTexture(const char* input_path, const char* output_path, TextureContainerFormat format) {
+    int width, height, n_channels;
+    Image levels[TEXTURE_CONTAINER_MAX_LEVELS] = { 0 };
+    levels[0].pixels = stbi_load(input_path, &width, &height, &n_channels, N_CHANNELS);
+    if (!levels[0].pixels) {
+        printf("Unable to load image: %s\n", input_path);
+        return STATUS_ERR;
+    }
+    levels[0].width = width;
+    levels[0].height = height;
+
+    TextureContainerHeader header = {
+        .magic = TEXTURE_CONTAINER_MAGIC,
+        .version = TEXTURE_CONTAINER_VERSION,
+        .format = format,
+        .width = width,
+        .height = height,
+        .n_levels = getTextureMipLevelCount(width, height),
+    };
+
+    Status status = STATUS_OK;
+    if (header.n_levels > TEXTURE_CONTAINER_MAX_LEVELS) {
+        puts("Image is too large");
+        status = STATUS_ERR;
+    }
+
+    // Each level is filtered from the previous one
+    for (uint32_t i = 1; i < header.n_levels && status == STATUS_OK; ++i) {
+        status = downsampleImage(&levels[i - 1], &levels[i]);
+    }
+
+    FILE* file = NULL;
+    if (status == STATUS_OK) {
+        file = fopen(output_path, "wb");
+        if (!file) {
+            printf("Unable to open output file: %s\n", output_path);
+            status = STATUS_ERR;
+        }
+    }
+
+    if (status == STATUS_OK) {
+        uint32_t offset = alignOffset(sizeof(header));
+        for (uint32_t i = 0; i < header.n_levels; ++i) {
+            header.levels[i] = (TextureContainerLevel) {
+                .offset = offset,
+                .size = getLevelSize(&levels[i], format),
+                .width = levels[i].width,
+                .height = levels[i].height,
+            };
+            offset = alignOffset(offset + header.levels[i].size);
+        }
+
+        if (fwrite(&header, sizeof(header), 1, file) != 1) {
+            puts("Unable to write texture header");
+            status = STATUS_ERR;
+        }
+        for (uint32_t i = 0; i < header.n_levels && status == STATUS_OK; ++i) {
+            status = writeLevel(file, &levels[i], format, &header.levels[i]);
+        }
+        fclose(file);
+    }
+
+    stbi_image_free(levels[0].pixels);
+    for (uint32_t i = 1; i < TEXTURE_CONTAINER_MAX_LEVELS; ++i) {
+        free(levels[i].pixels);
+    }
+    return status;
+}
+
+
+int main(int argc, char** argv) {
+    TextureContainerFormat format = TEXTURE_FORMAT_RGB8;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--bc1") == 0) {
+        format = TEXTURE_FORMAT_BC1;
+        ++arg;
+    }
+    if (argc - arg != 2) {
+        puts("Usage: d20_texconv [--bc1] input.png output.d20tex");
+        return 1;
+    }
+
+    return convertTexture(argv[arg], argv[arg + 1], format) == STATUS_OK ? 0 : 1;
+}
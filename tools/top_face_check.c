@@ -0,0 +1,155 @@
+/*
+* Top face kernel check: runs the top face kernel of each instruction set supported on this machine over
+* random orientations of every dice type and checks that the faces equal getDiceTopFace(). Face tables of
+* d4 and d10 are mostly padding for wide kernels. Axis-aligned orientations put several faces at the same
+* height, so ties have to go to the same face. Batches of getDiceTopFaces() with counts that are not a
+* multiple of kernel width also exercise the scalar tails.
+*
+* Usage: d20_top_face_check [--seed S]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "top_face.h"
+#include "top_face_kernels.h"
+#include "cpu_features.h"
+#include "allocation.h"
+#include "rng.h"
+
+
+static const char* const DICE_TYPE_NAMES[DICE_N_TYPES] = { "d4", "d6", "d8", "d10", "d12", "d20" };
+// Dice per kernel run, a multiple of every kernel width
+static const size_t N_KERNEL_DICE = 4096;
+static const size_t BATCH_COUNTS[] = { 1, 3, 7, 9, 15, 17, 63, 65, 1001 };
+enum { N_BATCH_COUNTS = sizeof(BATCH_COUNTS) / sizeof(BATCH_COUNTS[0]) };
+
+
+typedef struct {
+    const char* name;
+    const TopFaceKernels* kernels;
+    bool is_supported;
+} TopFaceIsa;
+
+
+// Random quaternions of any length, every fourth one axis-aligned with components of -1, 0 or 1
+static void fillOrientations(versor* orientations, size_t n, Rng* rng) {
+    for (size_t i = 0; i < n; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            orientations[i][c] = i % 4 == 0
+                ? (float)nextRngBounded(rng, 3) - 1.0f
+                : (nextRngFloat(rng) * 2.0f - 1.0f) * 3.0f;
+        }
+    }
+}
+
+
+static size_t countMismatches(const DiceType* types, versor* orientations, size_t n, const uint8_t* faces,
+                              const int* values) {
+    size_t n_mismatches = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bool is_same = faces[i] == getDiceTopFace(types[i], orientations[i]);
+        if (values) {
+            is_same &= values[i] == getDiceTopValue(types[i], orientations[i]);
+        }
+        n_mismatches += !is_same;
+    }
+    return n_mismatches;
+}
+
+
+int main(int argc, char** argv) {
+    uint64_t seed = 38;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_top_face_check [--seed S]");
+            return 1;
+        }
+    }
+
+    const TopFaceIsa isas[] = {
+        { "baseline", &TOP_FACE_KERNELS_BASELINE, TOP_FACE_KERNELS_BASELINE.width > 0 },
+        { "AVX2", &TOP_FACE_KERNELS_AVX2, TOP_FACE_KERNELS_AVX2.width > 0 && hasCpuAvx2() },
+        { "AVX-512", &TOP_FACE_KERNELS_AVX512, TOP_FACE_KERNELS_AVX512.width > 0 && hasCpuAvx512() }
+    };
+    const size_t n_isas = sizeof(isas) / sizeof(isas[0]);
+
+    DiceType* types = allocateMemory(N_KERNEL_DICE * sizeof(DiceType));
+    versor* orientations = allocateMemory(N_KERNEL_DICE * sizeof(versor));
+    uint8_t* faces = allocateMemory(N_KERNEL_DICE * sizeof(uint8_t));
+    int* values = allocateMemory(N_KERNEL_DICE * sizeof(int));
+    if (!types || !orientations || !faces || !values) {
+        puts("Unable to allocate dice");
+        free(types);
+        free(orientations);
+        free(faces);
+        free(values);
+        return 1;
+    }
+    initDiceMeshes();
+
+    Rng rng;
+    initRng(&rng, seed, 0);
+    printf("Checking %zu dice of every type, seed %llu\n", N_KERNEL_DICE, (unsigned long long)seed);
+    printf("%-6s %5s", "type", "faces");
+    for (size_t k = 0; k < n_isas; ++k) {
+        if (isas[k].is_supported) {
+            printf(" %8s", isas[k].name);
+        }
+    }
+    printf("  (mismatches)\n");
+
+    // Single type runs, then one of mixed types
+    bool passed = true;
+    for (int type = 0; type <= DICE_N_TYPES; ++type) {
+        for (size_t i = 0; i < N_KERNEL_DICE; ++i) {
+            types[i] = type < DICE_N_TYPES ? (DiceType)type : (DiceType)nextRngBounded(&rng, DICE_N_TYPES);
+        }
+        fillOrientations(orientations, N_KERNEL_DICE, &rng);
+        if (type < DICE_N_TYPES) {
+            printf("%-6s %5zu", DICE_TYPE_NAMES[type], getDiceFaceCount((DiceType)type));
+        } else {
+            printf("%-6s %5s", "mixed", "");
+        }
+
+        for (size_t k = 0; k < n_isas; ++k) {
+            if (!isas[k].is_supported) {
+                continue;
+            }
+            memset(faces, 0xFF, N_KERNEL_DICE * sizeof(uint8_t));
+            isas[k].kernels->findTopFaces(types, orientations[0], N_KERNEL_DICE, faces);
+            size_t n_mismatches = countMismatches(types, orientations, N_KERNEL_DICE, faces, NULL);
+            passed &= n_mismatches == 0;
+            printf(" %8zu", n_mismatches);
+        }
+        printf("\n");
+    }
+
+    // Dispatched batches of mixed types, faces and values
+    size_t n_batch_mismatches = 0;
+    for (size_t c = 0; c < N_BATCH_COUNTS; ++c) {
+        size_t n = BATCH_COUNTS[c];
+        for (size_t i = 0; i < n; ++i) {
+            types[i] = (DiceType)nextRngBounded(&rng, DICE_N_TYPES);
+        }
+        fillOrientations(orientations, n, &rng);
+        memset(faces, 0xFF, n * sizeof(uint8_t));
+        memset(values, 0, n * sizeof(int));
+        getDiceTopFaces(types, orientations, n, faces, values);
+        n_batch_mismatches += countMismatches(types, orientations, n, faces, values);
+    }
+    passed &= n_batch_mismatches == 0;
+    printf("getDiceTopFaces() batches of %d sizes: %zu mismatches\n", (int)N_BATCH_COUNTS, n_batch_mismatches);
+    printf("%s\n", passed ? "All kernels match" : "Check FAILED");
+
+    free(types);
+    free(orientations);
+    free(faces);
+    free(values);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+* Roll verification: runs rolls of every dice type through the same path as the application
+* (RNG -> value -> face -> target orientation -> roll animation queue) and checks that the last
+* keyframe shows the requested value on top with the number upright. Also tests that values
+* drawn by the RNG are uniform (chi-square).
+*
+* Usage: d20_verify [--rolls N] [--threads N] [--seed S]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "polyhedron.h"
+#include "animation.h"
+#include "top_face.h"
+#include "rng.h"
+#include "thread.h"
+
+
+enum {
+    N_CHUNKS_PER_TYPE = 64,  // work items do not depend on number of threads, so results do not either
+    MAX_THREADS = 256
+};
+
+// Tolerance of dot products with target axes
+static const float ORIENTATION_EPSILON = 1e-4f;
+// Standard normal quantile of chi-square test significance level 0.001
+static const double CHI_SQUARE_Z = 3.090;
+
+// Roll queue settings of the application
+static const AnimationSettings ANIMATION_SETTINGS = {
+    .idle_rot_speed = 50.0f,
+    .n_rotations = 5,
+    .n_points = 50,
+    .max_rot_speed = 450.0f,
+    .min_rot_speed = 100.0f,
+    .deaceleration = 150.0f,
+};
+
+
+typedef struct {
+    DiceType type;
+    size_t chunk;
+    size_t n_rolls;
+    uint64_t seed;
+
+    // Results
+    uint64_t value_count[DICE_MAX_FACES + 1];
+    uint64_t n_failures;
+    float max_normal_error;
+    float max_up_error;
+} VerifyChunk;
+
+
+typedef struct {
+    VerifyChunk* chunks;
+    size_t n_chunks;
+    size_t first;  // chunks first, first + stride, ...
+    size_t stride;
+} VerifyWorker;
+
+
+static void getRandomOrientation(Rng* rng, versor q_out) {
+    // Uniform on the sphere of unit quaternions (Shoemake)
+    float u1 = nextRngFloat(rng), u2 = nextRngFloat(rng) * 2.0f * GLM_PIf, u3 = nextRngFloat(rng) * 2.0f * GLM_PIf;
+    float a = sqrtf(1.0f - u1), b = sqrtf(u1);
+    q_out[0] = a * sinf(u2);
+    q_out[1] = a * cosf(u2);
+    q_out[2] = b * sinf(u3);
+    q_out[3] = b * cosf(u3);
+}
+
+
+static void verifyChunk(VerifyChunk* chunk, RollAnimationState* state) {
+    const DiceMesh* mesh = &gDiceMeshes[chunk->type];
+    size_t n_faces = getDiceFaceCount(chunk->type);
+    size_t n_points = ANIMATION_SETTINGS.n_points;
+
+    Rng rng;
+    initRng(&rng, chunk->seed, (uint64_t)chunk->type * N_CHUNKS_PER_TYPE + chunk->chunk);
+
+    for (size_t r = 0; r < chunk->n_rolls; ++r) {
+        int value = (int)nextRngBounded(&rng, (uint32_t)n_faces) + 1;
+        chunk->value_count[value]++;
+
+        versor initial;
+        getRandomOrientation(&rng, initial);
+        fillRollAnimationQueue(state, initial, &ANIMATION_SETTINGS, chunk->type, (size_t)value);
+        float* q = state->q_arr[n_points - 1];
+
+        size_t face_idx = getDiceFaceIndex(chunk->type, value);
+        vec3 normal, up;
+        glm_quat_rotatev(q, (float*)mesh->face_normal[face_idx], normal);
+        glm_quat_rotatev(q, (float*)mesh->face_up[face_idx], up);
+        float normal_error = 1.0f - normal[2];
+        float up_error = 1.0f - up[1];
+        chunk->max_normal_error = glm_max(chunk->max_normal_error, normal_error);
+        chunk->max_up_error = glm_max(chunk->max_up_error, up_error);
+
+        if (mesh->face_value[face_idx] != value || normal_error > ORIENTATION_EPSILON
+            || up_error > ORIENTATION_EPSILON || getDiceTopFace(chunk->type, q) != face_idx) {
+            chunk->n_failures++;
+        }
+    }
+}
+
+
+static void runWorker(void* arg) {
+    VerifyWorker* worker = arg;
+    RollAnimationState state = initRollAnimationState(ANIMATION_SETTINGS.n_points);
+    for (size_t c = worker->first; c < worker->n_chunks; c += worker->stride) {
+        verifyChunk(&worker->chunks[c], &state);
+    }
+    deleteRollAnimationState(&state);
+}
+
+
+// Critical chi-square value for df degrees of freedom (Wilson-Hilferty approximation)
+static double getChiSquareCritical(double df) {
+    double k = 2.0 / (9.0 * df);
+    double x = 1.0 - k + CHI_SQUARE_Z * sqrt(k);
+    return df * x * x * x;
+}
+
+
+// Merge chunks of one type, print report and return whether the type passed
+static bool reportType(DiceType type, const VerifyChunk* chunks) {
+    size_t n_faces = getDiceFaceCount(type);
+    uint64_t value_count[DICE_MAX_FACES + 1] = { 0 };
+    uint64_t n_rolls = 0, n_failures = 0;
+    float max_normal_error = 0.0f, max_up_error = 0.0f;
+    for (size_t c = 0; c < N_CHUNKS_PER_TYPE; ++c) {
+        for (size_t v = 1; v <= n_faces; ++v) {
+            value_count[v] += chunks[c].value_count[v];
+        }
+        n_rolls += chunks[c].n_rolls;
+        n_failures += chunks[c].n_failures;
+        max_normal_error = glm_max(max_normal_error, chunks[c].max_normal_error);
+        max_up_error = glm_max(max_up_error, chunks[c].max_up_error);
+    }
+
+    double expected = (double)n_rolls / n_faces;
+    double chi_square = 0.0;
+    for (size_t v = 1; v <= n_faces; ++v) {
+        double d = value_count[v] - expected;
+        chi_square += d * d / expected;
+    }
+    double critical = getChiSquareCritical((double)(n_faces - 1));
+    bool passed = n_failures == 0 && chi_square <= critical;
+
+    printf("d%zu: %llu rolls, %llu failures, max normal error %.2e, max up error %.2e, "
+           "chi-square %.2f (critical %.2f) %s\n",
+           n_faces, (unsigned long long)n_rolls, (unsigned long long)n_failures,
+           max_normal_error, max_up_error, chi_square, critical, passed ? "OK" : "FAILED");
+    printf("   ");
+    for (size_t v = 1; v <= n_faces; ++v) {
+        printf(" %zu:%llu", v, (unsigned long long)value_count[v]);
+    }
+    printf("\n");
+    return passed;
+}
+
+
+static double getTimeSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char** argv) {
+    size_t n_rolls = 1 << 20;
+    size_t n_threads = getProcessorCount();
+    uint64_t seed = 20;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--rolls") == 0 && arg + 1 < argc) {
+            n_rolls = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            n_threads = strtoull(argv[++arg], NULL, 10);
+        } else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_verify [--rolls N] [--threads N] [--seed S]");
+            return 1;
+        }
+    }
+    n_threads = n_threads < 1 ? 1 : n_threads > MAX_THREADS ? MAX_THREADS : n_threads;
+
+    initDiceMeshes();
+
+    // Rolls are split evenly between types, then between chunks of a type
+    size_t n_chunks = DICE_N_TYPES * N_CHUNKS_PER_TYPE;
+    size_t rolls_per_type = n_rolls / DICE_N_TYPES;
+    VerifyChunk* chunks = calloc(n_chunks, sizeof(VerifyChunk));
+    if (!chunks) {
+        puts("Unable to allocate chunks");
+        return 1;
+    }
+    for (size_t c = 0; c < n_chunks; ++c) {
+        size_t chunk = c % N_CHUNKS_PER_TYPE;
+        chunks[c].type = c / N_CHUNKS_PER_TYPE;
+        chunks[c].chunk = chunk;
+        chunks[c].n_rolls = rolls_per_type / N_CHUNKS_PER_TYPE + (chunk < rolls_per_type % N_CHUNKS_PER_TYPE);
+        chunks[c].seed = seed;
+    }
+
+    printf("Verifying %zu rolls on %zu threads, seed %llu\n", rolls_per_type * DICE_N_TYPES, n_threads,
+           (unsigned long long)seed);
+    double start_time = getTimeSeconds();
+
+    // Calling thread is the first worker
+    Thread threads[MAX_THREADS];
+    VerifyWorker workers[MAX_THREADS];
+    size_t n_started = 1;
+    for (size_t t = 0; t < n_threads; ++t) {
+        workers[t] = (VerifyWorker) { .chunks = chunks, .n_chunks = n_chunks, .first = t, .stride = n_threads };
+    }
+    for (size_t t = 1; t < n_threads; ++t) {
+        if (startThread(&threads[t], runWorker, &workers[t]) != STATUS_OK) {
+            break;
+        }
+        ++n_started;
+    }
+    // Chunks of workers that failed to start are done here
+    for (size_t t = n_started; t < n_threads; ++t) {
+        runWorker(&workers[t]);
+    }
+    runWorker(&workers[0]);
+    for (size_t t = 1; t < n_started; ++t) {
+        joinThread(&threads[t]);
+    }
+
+    bool passed = true;
+    for (int type = 0; type < DICE_N_TYPES; ++type) {
+        passed &= reportType(type, &chunks[type * N_CHUNKS_PER_TYPE]);
+    }
+    printf("%s in %.2f s\n", passed ? "All rolls verified" : "Verification FAILED", getTimeSeconds() - start_time);
+
+    free(chunks);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+* YUV conversion check: converts random RGBA frames of odd and even sizes, top down and bottom up, and
+* checks Y, U and V planes byte for byte against a per-pixel reference. Every row pair kernel supported on
+* this machine is also run on its own, including the last row of odd height, and the columns it converted
+* are compared with the reference. Channels are often 0 or 255 to reach the ends of fixed point ranges.
+*
+* Usage: d20_yuv_check [--seed S]
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "yuv.h"
+#include "yuv_kernels.h"
+#include "cpu_features.h"
+#include "allocation.h"
+#include "rng.h"
+
+
+static const int FRAME_WIDTHS[] = { 1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 100, 641 };
+static const int FRAME_HEIGHTS[] = { 1, 2, 3, 5, 8 };
+enum {
+    N_FRAME_WIDTHS = sizeof(FRAME_WIDTHS) / sizeof(FRAME_WIDTHS[0]),
+    N_FRAME_HEIGHTS = sizeof(FRAME_HEIGHTS) / sizeof(FRAME_HEIGHTS[0]),
+    MAX_FRAME_WIDTH = 641,
+    MAX_FRAME_HEIGHT = 8
+};
+
+
+typedef struct {
+    const char* name;
+    const YuvKernels* kernels;
+    bool is_supported;
+} YuvIsa;
+
+
+typedef struct {
+    unsigned char* y;
+    unsigned char* u;
+    unsigned char* v;
+} YuvPlanes;
+
+
+static unsigned char getReferenceLuma(const unsigned char* p) {
+    return (unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+}
+
+
+// Chroma of the rounded average of a 2x2 block, given as four pixels
+static void getReferenceChroma(const unsigned char* const block[4], unsigned char* u, unsigned char* v) {
+    int avg[3];
+    for (int c = 0; c < 3; ++c) {
+        avg[c] = (block[0][c] + block[1][c] + block[2][c] + block[3][c] + 2) >> 2;
+    }
+    *u = (unsigned char)(((-38 * avg[0] - 74 * avg[1] + 112 * avg[2] + 128) >> 8) + 128);
+    *v = (unsigned char)(((112 * avg[0] - 94 * avg[1] - 18 * avg[2] + 128) >> 8) + 128);
+}
+
+
+// Pixel x of image row y, rows of the output go top to bottom
+static const unsigned char* getPixel(const unsigned char* rgba, int width, int height, bool is_bottom_up,
+                                     int x, int y) {
+    int row = is_bottom_up ? height - 1 - y : y;
+    return rgba + ((size_t)row * width + x) * 4;
+}
+
+
+static void convertReference(const unsigned char* rgba, int width, int height, bool is_bottom_up,
+                             YuvPlanes out) {
+    int chroma_width = (width + 1) / 2;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            out.y[(size_t)y * width + x] = getReferenceLuma(getPixel(rgba, width, height, is_bottom_up, x, y));
+        }
+    }
+    // Odd edges repeat the last row or column
+    for (int y = 0; y < height; y += 2) {
+        int y1 = y + 1 < height ? y + 1 : y;
+        for (int x = 0; x < width; x += 2) {
+            int x1 = x + 1 < width ? x + 1 : x;
+            const unsigned char* const block[4] = {
+                getPixel(rgba, width, height, is_bottom_up, x, y), getPixel(rgba, width, height, is_bottom_up, x1, y),
+                getPixel(rgba, width, height, is_bottom_up, x, y1), getPixel(rgba, width, height, is_bottom_up, x1, y1)
+            };
+            size_t k = (size_t)(y / 2) * chroma_width + x / 2;
+            getReferenceChroma(block, &out.u[k], &out.v[k]);
+        }
+    }
+}
+
+
+static void fillFrame(unsigned char* rgba, size_t n_bytes, Rng* rng) {
+    for (size_t i = 0; i < n_bytes; ++i) {
+        int kind = nextRngBounded(rng, 8);
+        rgba[i] = kind == 0 ? 0 : kind == 1 ? 255 : (unsigned char)nextRngBounded(rng, 256);
+    }
+}
+
+
+// Run kernel over every row pair of a frame, returns number of bytes differing from the reference
+static size_t checkKernel(const YuvKernels* kernels, const unsigned char* rgba, int width, int height,
+                          YuvPlanes reference, YuvPlanes out) {
+    size_t row_size = (size_t)width * 4;
+    size_t chroma_width = (size_t)(width + 1) / 2;
+    size_t n_mismatches = 0;
+    for (int y = 0; y < height; y += 2) {
+        int y_next = y + 1 < height ? y + 1 : y;
+        unsigned char* luma1 = y_next != y ? out.y + (size_t)y_next * width : NULL;
+        size_t k = (size_t)(y / 2) * chroma_width;
+        int x = kernels->convertRowPair(rgba + (size_t)y * row_size, rgba + (size_t)y_next * row_size, width,
+                                        out.y + (size_t)y * width, luma1, out.u + k, out.v + k);
+
+        // Kernel leaves whole chroma blocks to scalar code
+        for (int i = 0; i < x; ++i) {
+            n_mismatches += out.y[(size_t)y * width + i] != reference.y[(size_t)y * width + i];
+            if (luma1) {
+                n_mismatches += luma1[i] != reference.y[(size_t)y_next * width + i];
+            }
+        }
+        for (int i = 0; i < x / 2; ++i) {
+            n_mismatches += out.u[k + i] != reference.u[k + i];
+            n_mismatches += out.v[k + i] != reference.v[k + i];
+        }
+    }
+    return n_mismatches;
+}
+
+
+static size_t countPlaneMismatches(YuvPlanes a, YuvPlanes b, int width, int height) {
+    size_t n_luma = (size_t)width * height;
+    size_t n_chroma = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+    size_t n_mismatches = 0;
+    for (size_t i = 0; i < n_luma; ++i) {
+        n_mismatches += a.y[i] != b.y[i];
+    }
+    for (size_t i = 0; i < n_chroma; ++i) {
+        n_mismatches += (a.u[i] != b.u[i]) + (a.v[i] != b.v[i]);
+    }
+    return n_mismatches;
+}
+
+
+int main(int argc, char** argv) {
+    uint64_t seed = 42;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+            seed = strtoull(argv[++arg], NULL, 10);
+        } else {
+            puts("Usage: d20_yuv_check [--seed S]");
+            return 1;
+        }
+    }
+
+    const YuvIsa isas[] = {
+        { "baseline", &YUV_KERNELS_BASELINE, YUV_KERNELS_BASELINE.width > 0 },
+        { "AVX2", &YUV_KERNELS_AVX2, YUV_KERNELS_AVX2.width > 0 && hasCpuAvx2() }
+    };
+    const size_t n_isas = sizeof(isas) / sizeof(isas[0]);
+
+    size_t n_pixels = (size_t)MAX_FRAME_WIDTH * MAX_FRAME_HEIGHT;
+    size_t n_chroma = (size_t)(MAX_FRAME_WIDTH + 1) / 2 * ((MAX_FRAME_HEIGHT + 1) / 2);
+    unsigned char* rgba = allocateMemory(n_pixels * 4);
+    unsigned char* planes = allocateMemory(2 * (n_pixels + 2 * n_chroma));
+    if (!rgba || !planes) {
+        puts("Unable to allocate frames");
+        free(rgba);
+        free(planes);
+        return 1;
+    }
+    YuvPlanes reference = { planes, planes + n_pixels, planes + n_pixels + n_chroma };
+    unsigned char* second = planes + n_pixels + 2 * n_chroma;
+    YuvPlanes out = { second, second + n_pixels, second + n_pixels + n_chroma };
+
+    Rng rng;
+    initRng(&rng, seed, 0);
+    printf("Checking %d frame sizes top down and bottom up, seed %llu\n", N_FRAME_WIDTHS * N_FRAME_HEIGHTS,
+           (unsigned long long)seed);
+
+    size_t n_frame_mismatches = 0;
+    size_t n_kernel_mismatches[sizeof(isas) / sizeof(isas[0])] = { 0 };
+    for (int w = 0; w < N_FRAME_WIDTHS; ++w) {
+        for (int h = 0; h < N_FRAME_HEIGHTS; ++h) {
+            int width = FRAME_WIDTHS[w], height = FRAME_HEIGHTS[h];
+            fillFrame(rgba, (size_t)width * height * 4, &rng);
+
+            for (int is_bottom_up = 0; is_bottom_up < 2; ++is_bottom_up) {
+                convertReference(rgba, width, height, is_bottom_up, reference);
+                memset(second, 0, n_pixels + 2 * n_chroma);
+                convertRgbaToYuv420(rgba, width, height, is_bottom_up, out.y, out.u, out.v);
+                n_frame_mismatches += countPlaneMismatches(reference, out, width, height);
+            }
+
+            // Kernels take rows in memory order, as the top down conversion does
+            convertReference(rgba, width, height, false, reference);
+            for (size_t k = 0; k < n_isas; ++k) {
+                if (isas[k].is_supported) {
+                    memset(second, 0, n_pixels + 2 * n_chroma);
+                    n_kernel_mismatches[k] += checkKernel(isas[k].kernels, rgba, width, height, reference, out);
+                }
+            }
+        }
+    }
+
+    bool passed = n_frame_mismatches == 0;
+    printf("convertRgbaToYuv420(): %zu bytes differ\n", n_frame_mismatches);
+    for (size_t k = 0; k < n_isas; ++k) {
+        if (isas[k].is_supported) {
+            printf("%-8s kernel:      %zu bytes differ\n", isas[k].name, n_kernel_mismatches[k]);
+            passed &= n_kernel_mismatches[k] == 0;
+        }
+    }
+    printf("%s\n", passed ? "All conversions match" : "Check FAILED");
+
+    free(rgba);
+    free(planes);
+    return passed ? 0 : 1;
+}